@@ -14,6 +14,9 @@
 //  You should have received a copy of the GNU Lesser General Public License
 //  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#ifndef _POLYFILL_FUNCTION_TUPLE_ARGS
+#define _POLYFILL_FUNCTION_TUPLE_ARGS
+
 // C++11: https://web.archive.org/web/20210426180530/https://stackoverflow.com/q
 //        uestions/10766112/c11-i-can-go-from-multiple-args-to-tuple-but-can-i-g
 //        o-from-tuple-to-multiple?noredirect=1&lq=1
@@ -24,7 +27,7 @@ namespace detail
     template <typename F, typename Tuple, bool Done, int Total, int... N>
     struct call_impl
     {
-        static typename F::result_type call(F f, Tuple && t)
+        static typename F::result_type call(const F& f, Tuple && t)
         {
             return call_impl<F, Tuple, Total == 1 + sizeof...(N), Total, N..., sizeof...(N)>::call(f, std::forward<Tuple>(t));
         }
@@ -33,7 +36,7 @@ namespace detail
     template <typename F, typename Tuple, int Total, int... N>
     struct call_impl<F, Tuple, true, Total, N...>
     {
-        static typename F::result_type call(F f, Tuple && t)
+        static typename F::result_type call(const F& f, Tuple && t)
         {
             return f(std::get<N>(std::forward<Tuple>(t))...);
         }
@@ -42,8 +45,10 @@ namespace detail
 
 // user invokes this
 template <typename F, typename Tuple>
-typename F::result_type call(F f, Tuple && t)
+typename F::result_type call(const F& f, Tuple && t)
 {
     typedef typename std::decay<Tuple>::type ttype;
     return detail::call_impl<F, Tuple, 0 == std::tuple_size<ttype>::value, std::tuple_size<ttype>::value>::call(f, std::forward<Tuple>(t));
 }
+
+#endif
@@ -17,7 +17,12 @@
 #ifdef EMSCRIPTEN
 #include <emscripten.h>
 #endif
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <sstream>
+
+#include "make_unique.hpp"
 
 #include "SDL.h"
 #include "SDL_image.h"
@@ -25,11 +30,18 @@
 #include "SDL_ttf.h"
 
 #include "ui/textbox.hpp"
+#include "util/archive.hpp"
 #include "util/color.hpp"
+#include "util/file_watcher.hpp"
 #include "util/log.hpp"
 #include "util/rect.hpp"
+#include "util/stage_timer.hpp"
+#include "util/thread_pool.hpp"
 #include "util/vector.hpp"
 #include "video/drawing_context.hpp"
+#include "video/font.hpp"
+#include "video/frame_capture.hpp"
+#include "video/preloader.hpp"
 #include "video/sdl/sdl_window.hpp"
 
 #ifndef DATA_ROOT
@@ -38,6 +50,15 @@
 
 static std::unique_ptr<Window> w = nullptr;
 static Textbox g_textbox{100, Rect(10, 200, 310, 230), {}, nullptr};
+static Font::Handle g_font;
+
+// Frame capture, enabled with `--capture <file> [frames]`
+static std::unique_ptr<FrameCapture> g_capture = nullptr;
+static std::string g_capture_file;
+static size_t g_capture_frames = 60;
+
+// Asset hot reload, enabled with `--hot-reload`
+static std::unique_ptr<FileWatcher> g_watcher = nullptr;
 
 extern "C"
 #ifdef EMSCRIPTEN
@@ -66,30 +87,63 @@ loop()
       }
     }
 
+    if (g_watcher)
+    {
+      for (const auto& file : g_watcher->poll_changes())
+      {
+        bool texture = w->reload_texture(file);
+        bool font = Font::reload_fonts(file);
+
+        if (texture || font)
+          log_info << "Reloading " << file << std::endl;
+      }
+
+      Font::finish_reloads();
+    }
+
     auto& r = w->get_renderer();
     DrawingContext dc(r);
-    auto& t = w->load_texture(DATA_ROOT "/images/missing.png");
+    auto t = w->load_texture(DATA_ROOT "/images/missing.png");
     dc.draw_filled_rect(Rect(20, 10, 100, 300), Color(0.5f, 0.25f, 0.125f),
                         Renderer::Blend::BLEND, 5);
     dc.draw_filled_rect(Rect(10, 5, 400, 50), Color(0.5f, 0.25f, 1.f),
                         Renderer::Blend::BLEND, 1);
 
-    Rect t_rect(Vector(), t.get_size());
+    Rect t_rect(Vector(), t->get_size());
     dc.draw_texture(t, t_rect, t_rect, 0.f, Color(1.f, 1.f, 1.f),
                     Renderer::Blend::BLEND, 3);
 
     auto canvas = w->create_texture(Size(50.f, 75.f));
     dc.render(canvas.get());
+    if (g_capture)
+      g_capture->record(dc, canvas.get());
 
     dc.draw_texture(*canvas, Rect(Vector(), canvas->get_size()),
                     Rect(Vector(300, 100), Size(100.f, 150.f)), 25.f,
                     Color(1.f, 1.f, 1.f), Renderer::Blend::ADD, 10);
+    if (!g_font.is_valid())
+      g_font = Font::get_handle(DATA_ROOT "/fonts/SuperTux-Medium.ttf", 16);
+
     dc.draw_text("Hello, world!", Vector(10, 10), Renderer::TextAlign::TOP_LEFT,
-                 DATA_ROOT "/fonts/SuperTux-Medium.ttf", 16, Color(1.f, 1.f, 1.f),
-                 Renderer::Blend::BLEND, 11);
+                 g_font, Color(1.f, 1.f, 1.f), Renderer::Blend::BLEND, 11);
 
     g_textbox.draw(dc);
     dc.render();
+
+    if (g_capture)
+    {
+      g_capture->record(dc);
+      g_capture->end_frame();
+
+      if (g_capture->get_frame_count() >= g_capture_frames)
+      {
+        g_capture->save(g_capture_file);
+        log_info << "Saved " << g_capture_frames << " frames to "
+                 << g_capture_file << std::endl;
+        g_capture.reset();
+      }
+    }
+
     dc.clear();
   }
   catch(std::exception& e)
@@ -107,8 +161,31 @@ loop()
 }
 
 extern "C"
-int main(int /* argc */, char** /* argv */)
+int main(int argc, char** argv)
 {
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--capture") && i + 1 < argc)
+    {
+      g_capture = std::make_unique<FrameCapture>();
+      g_capture_file = argv[++i];
+
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        g_capture_frames = static_cast<size_t>(std::atoi(argv[++i]));
+    }
+    else if (!std::strcmp(argv[i], "--hot-reload"))
+    {
+      try
+      {
+        g_watcher = std::make_unique<FileWatcher>(DATA_ROOT);
+      }
+      catch (const std::exception& e)
+      {
+        log_warn << "Hot reload disabled: " << e.what() << std::endl;
+      }
+    }
+  }
+
   std::ifstream file(DATA_ROOT "/images/missing.png");
   if(!file.is_open())
   {
@@ -122,6 +199,28 @@ int main(int /* argc */, char** /* argv */)
   Log::s_level = Log::Level::ALL;
   log_info << "Data root: " << DATA_ROOT << std::endl;
 
+  // A packed data directory (see harbor_pack) is preferred to loose files,
+  // except when hot reloading them: the archive would shadow the edits
+  if (g_watcher)
+  {
+    log_info << "Using loose asset files (hot reload)" << std::endl;
+  }
+  else
+  {
+    try
+    {
+      Archive::mount(DATA_ROOT ".hpak", DATA_ROOT);
+      log_info << "Using asset archive " << DATA_ROOT ".hpak" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+      log_info << "Using loose asset files (" << e.what() << ")" << std::endl;
+    }
+  }
+
+  StageTimer startup;
+  startup.begin("open audio");
+
   int audio_rate = 44100;
   Uint16 audio_format = AUDIO_S16SYS;
   int audio_channels = 2;
@@ -133,12 +232,6 @@ int main(int /* argc */, char** /* argv */)
     return 1;
   }
 
-  Mix_Chunk *sound = Mix_LoadWAV(DATA_ROOT "/music/chipdisko.wav");
-  if(!sound)
-  {
-    log_fatal << "Unable to load WAV file: " << Mix_GetError() << std::endl;
-    return 1;
-  }
 /*
   int channel = Mix_PlayChannel(-1, sound, 0);
   if (channel == -1)
@@ -148,14 +241,66 @@ int main(int /* argc */, char** /* argv */)
 */
   try
   {
+    startup.begin("init SDL, SDL_image, SDL_ttf");
     SDL_Init(SDL_INIT_VIDEO);
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
     IMG_Init(IMG_INIT_PNG);
     TTF_Init();
 
+#ifndef EMSCRIPTEN
+    // Keep rasterizing new glyphs from stalling frames
+    Font::set_rasterizer(&ThreadPool::get_default());
+#endif
+
+    // Assets are decoded on the workers while the window is being created
+    startup.begin("preload: start");
+    std::vector<Preloader::Entry> manifest;
+    try
+    {
+      manifest = Preloader::parse_manifest(DATA_ROOT "/preload.txt");
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Not preloading assets: " << e.what() << std::endl;
+    }
+
+#ifdef EMSCRIPTEN
+    ThreadPool preload_pool(0);
+#else
+    ThreadPool& preload_pool = ThreadPool::get_default();
+#endif
+    auto preloader = std::make_unique<Preloader>(manifest, preload_pool);
+
+    startup.begin("create window");
     w = Window::create_window(Window::VideoSystem::SDL);
     w->set_title("Hello, world!");
 
+    preloader->finish(*w, startup);
+    startup.begin("load remaining assets");
+    w->set_placeholder_texture(DATA_ROOT "/images/missing.png");
+
+    // The manifest is only an optimisation; load the sound now if it didn't
+    std::unique_ptr<Mix_Chunk, void(*)(Mix_Chunk*)> loaded_sound(nullptr,
+                                                                 Mix_FreeChunk);
+    Mix_Chunk* sound = preloader->get_sound(DATA_ROOT "/music/chipdisko.wav");
+    if (!sound)
+    {
+      loaded_sound.reset(Mix_LoadWAV_RW(Archive::open_rw(DATA_ROOT
+                                                  "/music/chipdisko.wav"), 1));
+      sound = loaded_sound.get();
+    }
+
+    if (!sound)
+    {
+      log_fatal << "Unable to load WAV file: " << Mix_GetError() << std::endl;
+      return 1;
+    }
+
+    startup.end();
+    std::ostringstream timings;
+    startup.print(timings);
+    log_debug << "Startup timings:" << std::endl << timings.str();
+
     g_textbox.get_theme().active.font = DATA_ROOT "/fonts/SuperTux-Medium.ttf";
     g_textbox.get_theme().active.bg_color = Color(.8f, .8f, .8f);
     g_textbox.get_theme().active.fontsize = 16;
@@ -177,7 +322,8 @@ int main(int /* argc */, char** /* argv */)
 #endif
 
     Mix_PlayChannel(-1, nullptr, 0);
-    Mix_FreeChunk(sound);
+    loaded_sound.reset();
+    preloader.reset();
     Mix_CloseAudio();
   }
   catch(std::exception& e)
@@ -0,0 +1,228 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_SCRIPTING_LUA_LUATHUNK_HPP
+
+#include "scripting/lua/lua_thunk.hpp"
+
+#include <type_traits>
+
+#include "scripting/lua/lua_virtual_machine.hpp"
+
+static_assert(std::is_same<LuaThunk::Function, lua_CFunction>::value,
+              "LuaThunk::Function doesn't match lua_CFunction");
+
+LuaThunk::ProfileScope::ProfileScope(lua_State* vm) :
+  m_profiler(nullptr)
+{
+  auto lvm = LuaVirtualMachine::get_vm(vm);
+
+  if (!lvm || !lvm->is_profiling())
+    return;
+
+  // Lua only knows the name the function was called by
+  lua_Debug ar;
+  const char* name = nullptr;
+  if (lua_getstack(vm, 0, &ar) && lua_getinfo(vm, "n", &ar))
+    name = ar.name;
+
+  m_profiler = &lvm->get_profiler();
+  m_profiler->enter(name, "native");
+}
+
+LuaThunk::ProfileScope::~ProfileScope()
+{
+  if (m_profiler)
+    m_profiler->leave();
+}
+
+void
+LuaThunk::get(lua_State* vm, int idx, size_t pos, bool& value)
+{
+  if (lua_type(vm, idx) != LUA_TBOOLEAN)
+    throw arg_error(vm, idx, pos, "boolean");
+
+  value = static_cast<bool>(lua_toboolean(vm, idx));
+}
+
+void
+LuaThunk::get(lua_State* vm, int idx, size_t pos, int& value)
+{
+  if (lua_type(vm, idx) != LUA_TNUMBER)
+    throw arg_error(vm, idx, pos, "integer");
+
+  value = static_cast<int>(lua_tonumber(vm, idx));
+}
+
+void
+LuaThunk::get(lua_State* vm, int idx, size_t pos, float& value)
+{
+  if (lua_type(vm, idx) != LUA_TNUMBER)
+    throw arg_error(vm, idx, pos, "float");
+
+  value = static_cast<float>(lua_tonumber(vm, idx));
+}
+
+void
+LuaThunk::get(lua_State* /* vm */, int /* idx */, size_t pos,
+              Scriptable*& /* value */)
+{
+  // TODO: Implement this
+  throw std::runtime_error("Can't handle objects when calling native function "
+                           "from Lua (argument " + std::to_string(pos + 1)
+                           + ")");
+}
+
+void
+LuaThunk::get(lua_State* vm, int idx, size_t pos, std::string& value)
+{
+  if (lua_type(vm, idx) != LUA_TSTRING)
+    throw arg_error(vm, idx, pos, "string");
+
+  size_t len;
+  const char* str = lua_tolstring(vm, idx, &len);
+  value.assign(str, len);
+}
+
+void
+LuaThunk::push(lua_State* vm, bool value)
+{
+  lua_pushboolean(vm, static_cast<int>(value));
+}
+
+void
+LuaThunk::push(lua_State* vm, int value)
+{
+  lua_pushinteger(vm, static_cast<lua_Integer>(value));
+}
+
+void
+LuaThunk::push(lua_State* vm, float value)
+{
+  lua_pushnumber(vm, static_cast<lua_Number>(value));
+}
+
+void
+LuaThunk::push(lua_State* /* vm */, Scriptable* /* value */)
+{
+  // TODO: Implement this
+  throw std::runtime_error("Can't return objects from native functions to "
+                           "Lua");
+}
+
+void
+LuaThunk::push(lua_State* vm, const std::string& value)
+{
+  lua_pushlstring(vm, value.c_str(), value.size());
+}
+
+void*
+LuaThunk::get_callable(lua_State* vm)
+{
+  // The bound function is the closure's only upvalue
+  return lua_touserdata(vm, lua_upvalueindex(1));
+}
+
+int
+LuaThunk::get_top(lua_State* vm)
+{
+  return lua_gettop(vm);
+}
+
+int
+LuaThunk::throw_error(lua_State* vm, const char* message)
+{
+  return luaL_error(vm, "%s", message);
+}
+
+void
+LuaThunk::check_arg_count(lua_State* vm, int nargs)
+{
+  if (lua_gettop(vm) < nargs)
+  {
+    throw std::runtime_error("Not enough args to call native function "
+                             "(expected " + std::to_string(nargs) + ", got "
+                             + std::to_string(lua_gettop(vm)) + ")");
+  }
+}
+
+std::runtime_error
+LuaThunk::arg_error(lua_State* vm, int idx, size_t pos, const char* type)
+{
+  // FIXME: Print the actual type names
+  return std::runtime_error("Native function couldn't parse "
+                            + std::string(type) + " at position "
+                            + std::to_string(pos + 1) + " (Lua reports: "
+                            + std::to_string(lua_type(vm, idx)) + ")");
+}
+
+#else
+
+#include "function_tuple_args.hpp"
+
+template<typename R, typename... A>
+int
+LuaThunk::call(lua_State* vm)
+{
+  ProfileScope profile(vm);
+
+  void* callable = get_callable(vm);
+  if (!callable)
+    return throw_error(vm, "Native closure has no bound function");
+
+  const auto& func = *static_cast<std::function<R(A...)>*>(callable);
+  const int nargs = static_cast<int>(sizeof...(A));
+
+  check_arg_count(vm, nargs);
+
+  // The arguments are the last values on the stack
+  std::tuple<A...> args;
+  FetchArg<0, sizeof...(A), A...>::fetch(vm, get_top(vm) - nargs + 1, args);
+
+  return ReturnVal<R, A...>::exec(vm, func, std::move(args));
+}
+
+template<std::size_t Current, std::size_t End, typename... Args>
+void
+LuaThunk::FetchArg<Current, End, Args...>::fetch(lua_State* vm, int first,
+                                                 std::tuple<Args...>& tuple)
+{
+  get(vm, first + static_cast<int>(Current), Current,
+      std::get<Current>(tuple));
+
+  FetchArg<Current + 1, End, Args...>::fetch(vm, first, tuple);
+}
+
+template<typename R, typename... A>
+int
+LuaThunk::ReturnVal<R, A...>::exec(lua_State* vm,
+                                   const std::function<R(A...)>& func,
+                                   std::tuple<A...>&& args)
+{
+  push(vm, ::call(func, std::move(args)));
+  return 1;
+}
+
+template<typename... A>
+int
+LuaThunk::ReturnVal<void, A...>::exec(lua_State* /* vm */,
+                                      const std::function<void(A...)>& func,
+                                      std::tuple<A...>&& args)
+{
+  ::call(func, std::move(args));
+  return 0;
+}
+
+#endif
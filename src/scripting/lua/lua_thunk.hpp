@@ -0,0 +1,133 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_SCRIPTING_LUA_LUATHUNK_HPP
+#define _HEADER_HARBOR_SCRIPTING_LUA_LUATHUNK_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+class Scriptable;
+class ScriptProfiler;
+struct lua_State;
+
+/**
+ * C functions generated by VirtualMachine::bind() for Lua.
+ *
+ * Each C closure carries a pointer to the bound `std::function` as its only
+ * upvalue, and converts its arguments and return value directly between the
+ * Lua stack and C++.
+ *
+ * Only the Lua state type is forward-declared here, so that the thunks can be
+ * generated from virtual_machine.hpp without including lua.h; the templates
+ * only call the functions declared below, which are compiled with the Lua VM.
+ */
+class LuaThunk final
+{
+public:
+  /** lua_CFunction. */
+  typedef int (*Function)(lua_State* vm);
+
+public:
+  template<typename R, typename... A>
+  static int call(lua_State* vm);
+
+private:
+  // ========================================================================
+  // FETCH_ARG
+
+  template<std::size_t Current, std::size_t End, typename... Args>
+  class FetchArg;
+
+  template<std::size_t End, typename... Args>
+  class FetchArg<End, End, Args...>
+  {
+  public:
+    static void fetch(lua_State* /* vm */, int /* first */,
+                      std::tuple<Args...>& /* tuple */) {}
+  };
+
+  template<std::size_t Current, std::size_t End, typename... Args>
+  class FetchArg
+  {
+  public:
+    static void fetch(lua_State* vm, int first, std::tuple<Args...>& tuple);
+  };
+
+  // ========================================================================
+  // RETURN_VAL
+
+  template<typename R, typename... A>
+  class ReturnVal
+  {
+  public:
+    static int exec(lua_State* vm, const std::function<R(A...)>& func,
+                    std::tuple<A...>&& args);
+  };
+
+  template<typename... A>
+  class ReturnVal<void, A...>
+  {
+  public:
+    static int exec(lua_State* vm, const std::function<void(A...)>& func,
+                    std::tuple<A...>&& args);
+  };
+
+  /** Records the native call in the VM's profiler, if it is on. */
+  class ProfileScope final
+  {
+  public:
+    ProfileScope(lua_State* vm);
+    ~ProfileScope();
+
+  private:
+    ScriptProfiler* m_profiler;
+
+  private:
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+  };
+
+private:
+  static void get(lua_State* vm, int idx, size_t pos, bool& value);
+  static void get(lua_State* vm, int idx, size_t pos, int& value);
+  static void get(lua_State* vm, int idx, size_t pos, float& value);
+  static void get(lua_State* vm, int idx, size_t pos, Scriptable*& value);
+  static void get(lua_State* vm, int idx, size_t pos, std::string& value);
+
+  static void push(lua_State* vm, bool value);
+  static void push(lua_State* vm, int value);
+  static void push(lua_State* vm, float value);
+  static void push(lua_State* vm, Scriptable* value);
+  static void push(lua_State* vm, const std::string& value);
+
+  /** @returns The bound function, or nullptr if the closure has none. */
+  static void* get_callable(lua_State* vm);
+  static int get_top(lua_State* vm);
+  /** Raises @p message as a script error; return the result from the thunk. */
+  static int throw_error(lua_State* vm, const char* message);
+  static void check_arg_count(lua_State* vm, int nargs);
+  static std::runtime_error arg_error(lua_State* vm, int idx, size_t pos,
+                                      const char* type);
+
+private:
+  LuaThunk() = delete;
+};
+
+#include "scripting/lua/lua_thunk.cpp"
+
+#endif
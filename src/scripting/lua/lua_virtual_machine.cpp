@@ -16,223 +16,107 @@
 
 #include "scripting/lua/lua_virtual_machine.hpp"
 
-#include <iostream>
+#include <cstring>
 #include <sstream>
 
-#include "util/log.hpp"
-
-int
-LuaVirtualMachine::call_lua(lua_State* vm)
-{
-  auto sqvm = get_vm(vm);
-
-  if (!sqvm)
-    return 0;
-
-  std::string func_name = get_vm(vm)->m_last_function_name;
-
-  const auto* func = sqvm->get_function_by_name(func_name);
-
-  if (!func)
-    return 0;
-
-  // Parse arguments
-  std::vector<std::unique_ptr<Type>> args;
-
-  int nargs = static_cast<int>(func->m_arg_types.size());
-
-  if (lua_gettop(vm) < nargs)
-  {
-    throw std::runtime_error("Not enough args to call '" + func_name + "'");
-  }
-
-  for (int i = 0; i < nargs; i++)
-  {
-    auto t = func->m_arg_types[static_cast<size_t>(i)];
-    int argn = i - nargs;
-    switch(t)
-    {
-      case Types::BOOLEAN:
-      {
-        if (lua_type(vm, argn) != LUA_TBOOLEAN)
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + func_name + "' couldn't parse"
-                                  + " boolean at position " + std::to_string(i
-                                  + 1) + " (Lua reports: " + std::to_string(
-                                    lua_type(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Boolean>(static_cast<bool>(lua_tonumber(vm, argn))));
-        break;
-      }
-
-      case Types::INTEGER:
-      {
-        if (lua_type(vm, argn) != LUA_TNUMBER)
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + func_name + "' couldn't parse"
-                                  + " integer at position " + std::to_string(i
-                                  + 1) + " (Lua reports: " + std::to_string(
-                                    lua_type(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Integer>(static_cast<int>(lua_tonumber(vm, argn))));
-        break;
-      }
-
-      case Types::FLOAT:
-      {
-        if (lua_type(vm, argn) != LUA_TNUMBER)
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + func_name + "' couldn't parse"
-                                  + " float at position " + std::to_string(i
-                                  + 1) + " (Lua reports: " + std::to_string(
-                                    lua_type(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Float>(static_cast<float>(lua_tonumber(vm, argn))));
-        break;
-      }
-
-      case Types::OBJECT:
-      {
-        // TODO: Implement this
-        std::cerr << "Not implemented yet! " << __FILE__ << ":" << __LINE__ << std::endl;
-        exit(1);
-      }
+#include "make_unique.hpp"
 
-      case Types::STRING:
-      {
-        if (lua_type(vm, argn) != LUA_TSTRING)
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + func_name + "' couldn't parse"
-                                  + " string at position " + std::to_string(i
-                                  + 1) + " (Lua reports: " + std::to_string(
-                                    lua_type(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::String>(std::string(lua_tostring(vm, argn))));
-        break;
-      }
-    }
-  }
+#include "util/log.hpp"
+#include "util/mapped_file.hpp"
 
-  // Call function
-  auto ret = func->m_function(args);
+namespace {
 
-  // Parse return value
-  if (auto b = dynamic_cast<VirtualMachine::Boolean*>(ret.get()))
-  {
-    lua_pushboolean(vm, static_cast<int>(b->m_value));
-    return 1;
-  }
-  else if (auto i = dynamic_cast<VirtualMachine::Integer*>(ret.get()))
-  {
-    lua_pushinteger(vm, static_cast<lua_Integer>(i->m_value));
-    return 1;
-  }
-  else if (auto f = dynamic_cast<VirtualMachine::Float*>(ret.get()))
-  {
-    lua_pushnumber(vm, static_cast<lua_Number>(f->m_value));
-    return 1;
-  }
-  else if (/* auto r = */ dynamic_cast<VirtualMachine::Object*>(ret.get()))
-  {
-    // TODO: Implement this
-    std::cerr << "Not implemented yet! " << __FILE__ << ":" << __LINE__ << std::endl;
-    exit(1);
-    //r->m_value->expose_object(*this);
-    //return 1;
-  }
-  else if (auto s = dynamic_cast<VirtualMachine::String*>(ret.get()))
-  {
-    lua_pushstring(vm, s->m_value.c_str());
-    return 1;
-  }
+/** Registry key of the owning object, where Lua has no extra space. */
+char g_vm_key;
 
+int
+write_bytecode(lua_State* /* vm */, const void* buffer, size_t size, void* out)
+{
+  static_cast<std::string*>(out)->append(static_cast<const char*>(buffer),
+                                         size);
   return 0;
 }
 
+} // namespace
+
 LuaVirtualMachine*
-LuaVirtualMachine::get_vm(const lua_State * vm)
+LuaVirtualMachine::get_vm(lua_State* vm)
 {
-  for (auto* lvm : s_vms)
-  {
-    if (lvm->m_vm == vm)
-    {
-      return lvm;
-    }
-  }
-
-  return nullptr;
+  // The constructor stores the owning object in the state's extra space, which
+  // Lua copies into every thread created from it
+#if LUA_VERSION_NUM > 502
+  return *static_cast<LuaVirtualMachine**>(lua_getextraspace(vm));
+#else
+  lua_pushlightuserdata(vm, &g_vm_key);
+  lua_rawget(vm, LUA_REGISTRYINDEX);
+  auto* lvm = static_cast<LuaVirtualMachine*>(lua_touserdata(vm, -1));
+  lua_pop(vm, 1);
+  return lvm;
+#endif
 }
 
 void
-LuaVirtualMachine::clear_vms()
+LuaVirtualMachine::profile_hook(lua_State* vm, lua_Debug* /* ar */)
 {
-  for (auto it = s_vms.begin(); it != s_vms.end();)
+  auto lvm = get_vm(vm);
+
+  if (!lvm || !lvm->is_profiling())
+    return;
+
+  auto& stack = lvm->m_sample_stack;
+  size_t depth = 0;
+
+  lua_Debug ar;
+  for (int level = 0; lua_getstack(vm, level, &ar); level++)
   {
-    if ((*it)->m_dead)
+    lua_getinfo(vm, "Sn", &ar);
+
+    // Native functions are recorded exactly by their thunks
+    if (strcmp(ar.what, "C") == 0)
+      continue;
+
+    if (depth == stack.size())
+      stack.emplace_back();
+
+    std::string& name = stack[depth++];
+    if (ar.name)
     {
-      it = s_vms.erase(it);
+      name.assign(ar.name);
     }
     else
     {
-      it++;
+      name.assign(strcmp(ar.what, "main") == 0 ? "<main>" : "<anonymous>");
     }
+    name.append(" (").append(ar.short_src).append(")");
   }
-}
-
-void
-LuaVirtualMachine::debugHook(lua_State * const ls, lua_Debug * const ar)
-{
-  // This will be called for both user-defined functions and C functions
-  // We want only the latter
-  if (ar->event == LUA_HOOKCALL)
-  {
-    auto vm = get_vm(ls);
 
-    if (vm)
-    {
-      lua_getinfo(ls, "f", ar);
-      auto e = lua_getupvalue(ls, -1, 1);
-      if (e && std::string(e) != "_ENV") {
-        const char* fn_name = lua_tostring(ls, -1);
-        if (fn_name != nullptr)
-        {
-          vm->m_last_function_name = std::string(fn_name);
-        }
-      }
-      lua_pop(ls, 3);
-    }
-  }
+  stack.resize(depth);
+  lvm->get_profiler().add_sample(stack);
 }
 
-std::vector<LuaVirtualMachine*> LuaVirtualMachine::s_vms;
-
 LuaVirtualMachine::LuaVirtualMachine() :
   m_vm(luaL_newstate()),
-  m_last_function_name(),
   m_functions(),
-  m_dead(false)
+  m_sample_stack()
 {
   if (!m_vm)
   {
     throw std::runtime_error("Could not create Lua VM");
   }
 
-  luaL_openlibs(m_vm);
-  lua_sethook(m_vm, debugHook, LUA_MASKCALL, 0);
+#if LUA_VERSION_NUM > 502
+  *static_cast<LuaVirtualMachine**>(lua_getextraspace(m_vm)) = this;
+#else
+  lua_pushlightuserdata(m_vm, &g_vm_key);
+  lua_pushlightuserdata(m_vm, this);
+  lua_rawset(m_vm, LUA_REGISTRYINDEX);
+#endif
 
-  s_vms.push_back(this);
+  luaL_openlibs(m_vm);
 }
 
 LuaVirtualMachine::~LuaVirtualMachine()
 {
-  m_dead = true;
-
-  clear_vms();
-
   if (m_vm)
   {
     lua_close(m_vm);
@@ -242,15 +126,34 @@ LuaVirtualMachine::~LuaVirtualMachine()
 void
 LuaVirtualMachine::run_code(std::string code, std::string source)
 {
-  if (luaL_loadbuffer(m_vm, code.c_str(), code.size(), source.c_str()))
+  std::string cache_file = get_cache_file(code, source, "luac");
+
+  if (cache_file.empty() || !load_bytecode(cache_file, source))
   {
-    std::string error_message(lua_tostring(m_vm, -1));
-    lua_pop(m_vm, 1);
-    throw std::runtime_error("Could not load Lua code from '" + source + "': "
-                             + error_message);
+    if (luaL_loadbuffer(m_vm, code.c_str(), code.size(), source.c_str()))
+    {
+      std::string error_message(lua_tostring(m_vm, -1));
+      lua_pop(m_vm, 1);
+      throw std::runtime_error("Could not load Lua code from '" + source
+                               + "': " + error_message);
+    }
+
+    if (!cache_file.empty())
+    {
+      std::string bytecode;
+#if LUA_VERSION_NUM > 502
+      int r = lua_dump(m_vm, write_bytecode, &bytecode, 0);
+#else
+      int r = lua_dump(m_vm, write_bytecode, &bytecode);
+#endif
+      if (r == 0)
+      {
+        write_cache_file(cache_file, bytecode);
+      }
+    }
   }
 
-  if (lua_pcall(m_vm, 0, 0, 0))
+  if (pcall(0, 0))
   {
     std::string error_message(lua_tostring(m_vm, -1));
     lua_pop(m_vm, 1);
@@ -274,8 +177,8 @@ LuaVirtualMachine::expose_class(std::string name,
     m2.m_name = name + "::" + m.m_name;
     m_functions.push_back(m2);
 
-    lua_pushstring(m_vm, (name + "::" + m.m_name).c_str());
-    lua_pushcclosure(m_vm, call_lua, 1);
+    lua_pushlightuserdata(m_vm, m2.m_binding.m_callable.get());
+    lua_pushcclosure(m_vm, m2.m_binding.m_lua_thunk, 1);
     lua_setfield(m_vm, -2, m.m_name.c_str());
   }
 
@@ -308,8 +211,8 @@ LuaVirtualMachine::expose_function(ExposableFunction func)
 #if LUA_VERSION_NUM > 501
   lua_pushglobaltable(m_vm);
 #endif
-  lua_pushstring(m_vm, func.m_name.c_str());
-  lua_pushcclosure(m_vm, call_lua, 1);
+  lua_pushlightuserdata(m_vm, func.m_binding.m_callable.get());
+  lua_pushcclosure(m_vm, func.m_binding.m_lua_thunk, 1);
 #if LUA_VERSION_NUM > 501
   lua_setfield(m_vm, -2, func.m_name.c_str());
   lua_pop(m_vm, 1);
@@ -414,54 +317,74 @@ LuaVirtualMachine::expose_string(std::string name, std::string val)
 #endif
 }
 
-std::vector<std::unique_ptr<VirtualMachine::Type>>
+std::vector<VirtualMachine::Value>
 LuaVirtualMachine::call_function(std::string func_name,
-                                 std::vector<std::unique_ptr<Type>> args,
+                                 std::vector<Value> args,
                                  Scriptable* /* obj */,
                                  bool /* func_relative */)
 {
   int top = lua_gettop(m_vm);
 
-  resolve_name(func_name, true);
+  push_function(func_name);
 
-  if (lua_type(m_vm, -1) != LUA_TFUNCTION)
+  return call_pushed_function(args, top, func_name);
+}
+
+std::unique_ptr<VirtualMachine::Callable>
+LuaVirtualMachine::get_callable(std::string name, Scriptable* /* obj */,
+                                bool /* func_relative */)
+{
+  push_function(name);
+
+  // Pops the function
+  int ref = luaL_ref(m_vm, LUA_REGISTRYINDEX);
+
+  std::unique_ptr<Callable> callable =
+    std::make_unique<LuaCallable>(*this, name, ref);
+
+  return callable;
+}
+
+void
+LuaVirtualMachine::push_function(std::string func_name)
+{
+  int top = lua_gettop(m_vm);
+
+#if LUA_VERSION_NUM > 501
+  lua_pushglobaltable(m_vm);
+#else
+  lua_pushnil(m_vm);
+#endif
+
+  try
   {
-    throw std::runtime_error("Lua: " + func_name + " is not a function");
+    resolve_name(func_name, true);
+  }
+  catch (...)
+  {
+    // On Lua 5.1, the nil pushed above is still there
+    lua_settop(m_vm, top);
+    throw;
   }
 
-  for (const auto& arg : args)
+  // On Lua 5.1, resolve_name() leaves the nil pushed above
+  while (lua_gettop(m_vm) - top > 1)
+    lua_remove(m_vm, -2);
+
+  if (lua_type(m_vm, -1) != LUA_TFUNCTION)
   {
-    if (auto arg_bool = dynamic_cast<const Boolean*>(arg.get()))
-    {
-      lua_pushboolean(m_vm, static_cast<int>(arg_bool->m_value));
-    }
-    else if (auto arg_int = dynamic_cast<const Integer*>(arg.get()))
-    {
-      lua_pushinteger(m_vm, static_cast<lua_Integer>(arg_int->m_value));
-    }
-    else if (auto arg_float = dynamic_cast<const Float*>(arg.get()))
-    {
-      lua_pushnumber(m_vm, static_cast<lua_Number>(arg_float->m_value));
-    }
-    else if (auto arg_string = dynamic_cast<const String*>(arg.get()))
-    {
-      lua_pushstring(m_vm, arg_string->m_value.c_str());
-    }
-    else if (/* auto arg_object = */ dynamic_cast<const Object*>(arg.get()))
-    {
-      lua_settop(m_vm, top);
-      throw std::runtime_error("Can't handle objects when calling Lua function "
-                               "from native");
-    }
-    else
-    {
-      lua_settop(m_vm, top);
-      throw std::runtime_error("Unknown argument type when calling Lua function"
-                               " from native");
-    }
+    lua_settop(m_vm, top);
+    throw std::runtime_error("Lua: " + func_name + " is not a function");
   }
+}
 
-  if (lua_pcall(m_vm, args.size(), LUA_MULTRET, 0))
+std::vector<VirtualMachine::Value>
+LuaVirtualMachine::call_pushed_function(const Arguments& args, int top,
+                                        const std::string& func_name)
+{
+  push_arguments(args, top);
+
+  if (pcall(static_cast<int>(args.size()), LUA_MULTRET))
   {
     std::string error_message(lua_tostring(m_vm, -1));
     lua_settop(m_vm, top);
@@ -471,50 +394,175 @@ LuaVirtualMachine::call_function(std::string func_name,
 
   int nret = lua_gettop(m_vm) - top;
 
-  std::vector<std::unique_ptr<Type>> ret;
+  std::vector<Value> ret;
 
   for (int i = top + 1; i <= top + nret; i++)
   {
-    std::cout << i << " of " << (top + nret) << ": " << nret << std::endl;
-    switch(lua_type(m_vm, i))
+    ret.push_back(get_return_value(i, top));
+  }
+
+  lua_settop(m_vm, top);
+
+  return ret;
+}
+
+void
+LuaVirtualMachine::push_arguments(const Arguments& args, int top)
+{
+  for (const auto& arg : args)
+  {
+    switch (arg.get_type())
     {
-      case LUA_TBOOLEAN:
-      {
-        bool b = static_cast<bool>(lua_toboolean(m_vm, i));
-        ret.push_back(std::make_unique<Boolean>(b));
+      case Types::BOOLEAN:
+        lua_pushboolean(m_vm, static_cast<int>(arg.get_bool()));
         break;
-      }
 
-      case LUA_TNUMBER:
-      {
-        float f = static_cast<float>(lua_tonumber(m_vm, i));
-        ret.push_back(std::make_unique<Float>(f));
+      case Types::INTEGER:
+        lua_pushinteger(m_vm, static_cast<lua_Integer>(arg.get_int()));
         break;
-      }
 
-      case LUA_TSTRING:
-      {
-        std::string s(lua_tostring(m_vm, i));
-        ret.push_back(std::make_unique<String>(s));
+      case Types::FLOAT:
+        lua_pushnumber(m_vm, static_cast<lua_Number>(arg.get_float()));
         break;
-      }
 
-      default:
-      {
-        std::string msg("Unknown return type " +
-                        std::to_string(lua_type(m_vm, i)) + " when calling Lua "
-                        "function from native: " + std::to_string(i - top));
+      case Types::STRING:
+        lua_pushlstring(m_vm, arg.get_string(), arg.get_string_size());
+        break;
+
+      case Types::OBJECT:
         lua_settop(m_vm, top);
-        throw std::runtime_error(msg);
-      }
+        throw std::runtime_error("Can't handle objects when calling Lua "
+                                 "function from native");
+
+      case Types::NONE:
+        lua_settop(m_vm, top);
+        throw std::runtime_error("Unknown argument type when calling Lua "
+                                 "function from native");
     }
   }
+}
 
-  lua_settop(m_vm, top);
+VirtualMachine::Value
+LuaVirtualMachine::get_return_value(int index, int top)
+{
+  Value ret;
+
+  switch(lua_type(m_vm, index))
+  {
+    case LUA_TBOOLEAN:
+    {
+      bool b = static_cast<bool>(lua_toboolean(m_vm, index));
+      ret = Value(b);
+      break;
+    }
+
+    case LUA_TNUMBER:
+    {
+      float f = static_cast<float>(lua_tonumber(m_vm, index));
+      ret = Value(f);
+      break;
+    }
+
+    case LUA_TSTRING:
+    {
+      // The string is popped by the caller, so the value must own a copy
+      size_t len;
+      const char* s = lua_tolstring(m_vm, index, &len);
+      ret = Value(s, len);
+      break;
+    }
+
+    default:
+    {
+      std::string msg("Unknown return type " +
+                      std::to_string(lua_type(m_vm, index)) + " when calling "
+                      "Lua function from native: "
+                      + std::to_string(index - top));
+      lua_settop(m_vm, top);
+      throw std::runtime_error(msg);
+    }
+  }
 
   return ret;
 }
 
+LuaVirtualMachine::LuaCallable::LuaCallable(LuaVirtualMachine& vm,
+                                            const std::string& name,
+                                            int ref) :
+  m_vm(vm),
+  m_name(name),
+  m_ref(ref)
+{
+}
+
+LuaVirtualMachine::LuaCallable::~LuaCallable()
+{
+  luaL_unref(m_vm.m_vm, LUA_REGISTRYINDEX, m_ref);
+}
+
+std::vector<VirtualMachine::Value>
+LuaVirtualMachine::LuaCallable::call(const Arguments& args)
+{
+  int top = lua_gettop(m_vm.m_vm);
+
+  lua_rawgeti(m_vm.m_vm, LUA_REGISTRYINDEX, m_ref);
+
+  return m_vm.call_pushed_function(args, top, m_name);
+}
+
+void
+LuaVirtualMachine::LuaCallable::call_batch(
+    const std::vector<Scriptable*>& receivers,
+    const std::vector<Arguments>& args, std::vector<Value>& results)
+{
+  check_batch(receivers, args);
+
+  lua_State* vm = m_vm.m_vm;
+  int top = lua_gettop(vm);
+
+  results.resize(receivers.size());
+
+  // pcall() pops the function, so each call gets a copy of this one
+  lua_rawgeti(vm, LUA_REGISTRYINDEX, m_ref);
+
+  for (size_t i = 0; i < receivers.size(); i++)
+  {
+    if (receivers[i])
+    {
+      lua_settop(vm, top);
+      throw std::runtime_error("Can't handle objects when calling Lua "
+                               "function from native");
+    }
+
+    lua_pushvalue(vm, top + 1);
+
+    Arguments call_args = args.empty() ? Arguments(nullptr, 0) : args[i];
+    m_vm.push_arguments(call_args, top);
+
+    if (m_vm.pcall(static_cast<int>(call_args.size()), 1))
+    {
+      std::string error_message(lua_tostring(vm, -1));
+      lua_settop(vm, top);
+      throw std::runtime_error("Could not run Lua function '" + m_name + "': "
+                                + error_message);
+    }
+
+    // Only the first return value is kept; a missing one is nil
+    if (lua_type(vm, -1) == LUA_TNIL)
+    {
+      results[i] = Value();
+    }
+    else
+    {
+      results[i] = m_vm.get_return_value(lua_gettop(vm), top);
+    }
+
+    lua_pop(vm, 1);
+  }
+
+  lua_settop(vm, top);
+}
+
 void
 LuaVirtualMachine::remove_entry(std::string name)
 {
@@ -525,6 +573,7 @@ LuaVirtualMachine::remove_entry(std::string name)
   lua_pushnil(m_vm);
 #if LUA_VERSION_NUM > 501
   lua_setfield(m_vm, -2, varname.c_str());
+  lua_pop(m_vm, 1);
 #else
   if (varname == name)
   {
@@ -538,18 +587,73 @@ LuaVirtualMachine::remove_entry(std::string name)
 #endif
 }
 
-const VirtualMachine::ExposableFunction*
-LuaVirtualMachine::get_function_by_name(const std::string& name) const
+bool
+LuaVirtualMachine::load_bytecode(const std::string& file,
+                                 const std::string& source)
 {
-  for (const auto& f : m_functions)
+  std::unique_ptr<MappedFile> data;
+
+  try
   {
-    if (f.m_name == name)
-    {
-      return &f;
-    }
+    data = std::make_unique<MappedFile>(file);
+  }
+  catch (std::exception&)
+  {
+    // Not cached yet
+    return false;
+  }
+
+  const char* bytecode = reinterpret_cast<const char*>(data->get_data());
+
+  // Only accept binary chunks, so that a corrupted cache can't run as source
+#if LUA_VERSION_NUM > 501
+  int r = luaL_loadbufferx(m_vm, bytecode, data->get_size(), source.c_str(),
+                           "b");
+#else
+  int r = (data->get_size() > 0 && bytecode[0] == LUA_SIGNATURE[0])
+            ? luaL_loadbuffer(m_vm, bytecode, data->get_size(), source.c_str())
+            : LUA_ERRSYNTAX;
+#endif
+
+  if (r)
+  {
+    lua_pop(m_vm, 1);
+    log_warn << "Ignoring invalid Lua script cache '" << file << "'"
+             << std::endl;
+    return false;
   }
 
-  return nullptr;
+  return true;
+}
+
+int
+LuaVirtualMachine::pcall(int nargs, int nresults)
+{
+  // Samples are only taken while Lua code runs, so the time spent outside of
+  // Lua must not be charged to the first sample of the next call
+  if (is_profiling())
+    get_profiler().reset_sample_clock();
+
+  int r = lua_pcall(m_vm, nargs, nresults, 0);
+
+  if (is_profiling())
+    get_profiler().reset_sample_clock();
+
+  return r;
+}
+
+void
+LuaVirtualMachine::set_profiling_hook(bool enabled)
+{
+  if (enabled)
+  {
+    lua_sethook(m_vm, LuaVirtualMachine::profile_hook, LUA_MASKCOUNT,
+                PROFILE_SAMPLE_INSTRUCTIONS);
+  }
+  else
+  {
+    lua_sethook(m_vm, nullptr, 0, 0);
+  }
 }
 
 std::string
@@ -35,13 +35,12 @@ class LuaVirtualMachine final :
   public VirtualMachine
 {
 public:
-  static int call_lua(lua_State* vm);
-  static LuaVirtualMachine* get_vm(const lua_State * vm);
-  static void clear_vms();
-  static void debugHook(lua_State * const ls, lua_Debug * const ar);
+  static void profile_hook(lua_State* vm, lua_Debug* ar);
+  static LuaVirtualMachine* get_vm(lua_State* vm);
 
 private:
-  static std::vector<LuaVirtualMachine*> s_vms;
+  /** How many instructions run between two samples of the profiler. */
+  static const int PROFILE_SAMPLE_INSTRUCTIONS = 1000;
 
 public:
   LuaVirtualMachine();
@@ -59,15 +58,90 @@ public:
   virtual void expose_int(std::string name, int val) override;
   virtual void expose_float(std::string name, float val) override;
   virtual void expose_string(std::string name, std::string val) override;
-  virtual std::vector<std::unique_ptr<Type>> call_function(std::string name,
-                                        std::vector<std::unique_ptr<Type>> args,
-                                        Scriptable* obj = nullptr,
-                                        bool func_relative = false) override;
+  virtual std::vector<Value> call_function(std::string name,
+                                           std::vector<Value> args,
+                                           Scriptable* obj = nullptr,
+                                           bool func_relative = false) override;
+  virtual std::unique_ptr<Callable>
+  get_callable(std::string name, Scriptable* obj = nullptr,
+               bool func_relative = false) override;
   virtual void remove_entry(std::string name) override;
 
-  const ExposableFunction* get_function_by_name(const std::string& name) const;
+protected:
+  /**
+   * Samples the call stack every PROFILE_SAMPLE_INSTRUCTIONS instructions.
+   * Only the main thread is sampled, not coroutines.
+   */
+  virtual void set_profiling_hook(bool enabled) override;
+
+private:
+  class LuaCallable final :
+    public Callable
+  {
+  public:
+    LuaCallable(LuaVirtualMachine& vm, const std::string& name, int ref);
+    virtual ~LuaCallable() override;
+
+    virtual std::vector<Value> call(const Arguments& args) override;
+
+    /**
+     * Objects can't be passed to Lua yet, so every receiver must be null.
+     */
+    virtual void call_batch(const std::vector<Scriptable*>& receivers,
+                            const std::vector<Arguments>& args,
+                            std::vector<Value>& results) override;
+
+  private:
+    LuaVirtualMachine& m_vm;
+    std::string m_name;
+    /** The function's reference in the registry. */
+    int m_ref;
+  };
 
 private:
+  /**
+   * Calls lua_pcall() without a message handler, keeping the profiler's
+   * sampling clock to the time spent in Lua.
+   */
+  int pcall(int nargs, int nresults);
+
+  /**
+   * Pushes the function @p func_name.
+   *
+   * @throws if the function doesn't exist; nothing is left on the stack.
+   */
+  void push_function(std::string func_name);
+
+  /**
+   * Calls the function pushed by push_function() with @p args, then restores
+   * the stack to @p top.
+   *
+   * @returns the values returned by the function.
+   */
+  std::vector<Value> call_pushed_function(const Arguments& args, int top,
+                                          const std::string& func_name);
+
+  /**
+   * Pushes @p args. If one of them can't be pushed, restores the stack to
+   * @p top and throws.
+   */
+  void push_arguments(const Arguments& args, int top);
+
+  /**
+   * @returns the value at @p index.
+   * @throws if its type can't be represented, after restoring the stack to
+   *         @p top.
+   */
+  Value get_return_value(int index, int top);
+
+  /**
+   * Pushes the chunk cached as bytecode in @p file.
+   *
+   * @returns `false`, without pushing anything, if the file doesn't exist or
+   *          doesn't hold valid bytecode.
+   */
+  bool load_bytecode(const std::string& file, const std::string& source);
+
   /**
    * Resolves a name, e. g. `var1.var2.name123`. Expects a root table/object to
    * start from. It will pop the table, regardless of whether or not it throws.
@@ -82,9 +156,9 @@ private:
 
 private:
   lua_State* m_vm;
-  std::string m_last_function_name;
   std::vector<ExposableFunction> m_functions;
-  bool m_dead;
+  /** Reused by profile_hook() to avoid allocating on every sample. */
+  std::vector<std::string> m_sample_stack;
 
 private:
   LuaVirtualMachine(const LuaVirtualMachine&) = delete;
@@ -0,0 +1,331 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "scripting/script_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "util/log.hpp"
+
+namespace {
+
+double
+to_ms(std::chrono::steady_clock::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double
+to_us(std::chrono::steady_clock::duration duration)
+{
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void
+write_json_string(std::ostream& out, const std::string& str)
+{
+  out << '"';
+
+  for (char c : str)
+  {
+    switch (c)
+    {
+      case '"':
+        out << "\\\"";
+        break;
+
+      case '\\':
+        out << "\\\\";
+        break;
+
+      case '\n':
+        out << "\\n";
+        break;
+
+      case '\t':
+        out << "\\t";
+        break;
+
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out << escaped;
+        }
+        else
+        {
+          out << c;
+        }
+        break;
+    }
+  }
+
+  out << '"';
+}
+
+} // namespace
+
+const size_t ScriptProfiler::MAX_TRACE_EVENTS;
+
+ScriptProfiler::ScriptProfiler() :
+  m_entries(),
+  m_entry_ids(),
+  m_active(),
+  m_last_sample(),
+  m_stack(),
+  m_events(),
+  m_dropped_events(0),
+  m_sample_count(0),
+  m_origin(std::chrono::steady_clock::now()),
+  m_last_sample_time(m_origin),
+  m_exact_time(std::chrono::steady_clock::duration::zero()),
+  m_key()
+{
+}
+
+void
+ScriptProfiler::start()
+{
+  reset_sample_clock();
+}
+
+void
+ScriptProfiler::reset_sample_clock()
+{
+  m_last_sample_time = std::chrono::steady_clock::now();
+  m_exact_time = std::chrono::steady_clock::duration::zero();
+}
+
+void
+ScriptProfiler::stop()
+{
+  while (!m_stack.empty())
+    leave();
+}
+
+void
+ScriptProfiler::clear()
+{
+  m_entries.clear();
+  m_entry_ids.clear();
+  m_active.clear();
+  m_last_sample.clear();
+  m_stack.clear();
+  m_events.clear();
+  m_dropped_events = 0;
+  m_sample_count = 0;
+  m_origin = std::chrono::steady_clock::now();
+  m_last_sample_time = m_origin;
+  m_exact_time = std::chrono::steady_clock::duration::zero();
+}
+
+void
+ScriptProfiler::enter(const char* name, const char* source)
+{
+  m_key.assign(name ? name : "<anonymous>");
+  if (source)
+  {
+    m_key.append(" (");
+    m_key.append(source);
+    m_key.append(")");
+  }
+
+  size_t entry = get_entry(m_key);
+
+  m_entries[entry].calls++;
+  m_active[entry]++;
+
+  m_stack.push_back({ entry, std::chrono::steady_clock::now(),
+                      std::chrono::steady_clock::duration::zero() });
+}
+
+void
+ScriptProfiler::leave()
+{
+  // Engines may unwind frames without reporting them, e. g. on errors
+  if (m_stack.empty())
+    return;
+
+  Frame frame = m_stack.back();
+  m_stack.pop_back();
+
+  auto elapsed = std::chrono::steady_clock::now() - frame.start;
+
+  Entry& entry = m_entries[frame.entry];
+  entry.exclusive += to_ms(elapsed - frame.children);
+
+  // Only the outermost call of a recursive function counts, so that the time
+  // isn't counted once per level
+  if (--m_active[frame.entry] == 0)
+    entry.inclusive += to_ms(elapsed);
+
+  if (!m_stack.empty())
+  {
+    m_stack.back().children += elapsed;
+  }
+  else
+  {
+    m_exact_time += elapsed;
+  }
+
+  add_event(frame.entry, frame.start, elapsed, false);
+}
+
+void
+ScriptProfiler::add_sample(const std::vector<std::string>& stack)
+{
+  auto now = std::chrono::steady_clock::now();
+
+  auto interval = now - m_last_sample_time;
+
+  // The calls recorded exactly in the meantime, e. g. to native functions,
+  // were made by the sampled functions: they count towards their inclusive
+  // time only
+  auto elapsed = interval - m_exact_time;
+  if (elapsed < std::chrono::steady_clock::duration::zero())
+    elapsed = std::chrono::steady_clock::duration::zero();
+  m_exact_time = std::chrono::steady_clock::duration::zero();
+
+  m_sample_count++;
+
+  for (size_t i = 0; i < stack.size(); i++)
+  {
+    size_t entry = get_entry(stack[i]);
+
+    if (i == 0)
+    {
+      m_entries[entry].samples++;
+      m_entries[entry].exclusive += to_ms(elapsed);
+      add_event(entry, m_last_sample_time, elapsed, true);
+    }
+
+    if (m_last_sample[entry] != m_sample_count)
+    {
+      m_last_sample[entry] = m_sample_count;
+      m_entries[entry].inclusive += to_ms(interval);
+    }
+  }
+
+  m_last_sample_time = now;
+}
+
+std::vector<ScriptProfiler::Entry>
+ScriptProfiler::get_entries() const
+{
+  std::vector<Entry> entries(m_entries);
+
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return a.exclusive > b.exclusive;
+                   });
+
+  return entries;
+}
+
+void
+ScriptProfiler::print(std::ostream& out) const
+{
+  out << "  " << std::left << std::setw(48) << "function" << std::right
+      << std::setw(9) << "calls" << std::setw(9) << "samples"
+      << std::setw(14) << "inclusive" << std::setw(14) << "exclusive"
+      << std::endl;
+
+  for (const auto& entry : get_entries())
+  {
+    out << "  " << std::left << std::setw(48) << entry.name << std::right
+        << std::setw(9) << entry.calls << std::setw(9) << entry.samples
+        << std::fixed << std::setprecision(3)
+        << std::setw(11) << entry.inclusive << " ms"
+        << std::setw(11) << entry.exclusive << " ms" << std::endl;
+  }
+}
+
+void
+ScriptProfiler::write_trace(std::ostream& out) const
+{
+  if (m_dropped_events > 0)
+  {
+    log_warn << "Script trace is missing " << m_dropped_events
+             << " calls past the first " << MAX_TRACE_EVENTS << std::endl;
+  }
+
+  out << "{\"traceEvents\":[";
+
+  for (size_t i = 0; i < m_events.size(); i++)
+  {
+    const Event& event = m_events[i];
+
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    write_json_string(out, m_entries[event.entry].name);
+    out << ",\"cat\":\"" << (event.sampled ? "sample" : "call") << "\""
+        << ",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+        << std::fixed << std::setprecision(3)
+        << ",\"ts\":" << to_us(event.start - m_origin)
+        << ",\"dur\":" << to_us(event.duration) << "}";
+  }
+
+  out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+void
+ScriptProfiler::save_trace(const std::string& file) const
+{
+  std::ofstream out(file, std::ios::binary);
+
+  if (!out)
+    throw std::runtime_error("Could not open '" + file + "' for writing");
+
+  write_trace(out);
+
+  if (!out)
+    throw std::runtime_error("Could not write script trace to '" + file + "'");
+}
+
+size_t
+ScriptProfiler::get_entry(const std::string& name)
+{
+  auto it = m_entry_ids.find(name);
+  if (it != m_entry_ids.end())
+    return it->second;
+
+  size_t entry = m_entries.size();
+  m_entries.push_back({ name, 0, 0, 0., 0. });
+  m_active.push_back(0);
+  m_last_sample.push_back(0);
+  m_entry_ids[name] = entry;
+
+  return entry;
+}
+
+void
+ScriptProfiler::add_event(size_t entry,
+                          std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::duration duration,
+                          bool sampled)
+{
+  if (m_events.size() >= MAX_TRACE_EVENTS)
+  {
+    m_dropped_events++;
+    return;
+  }
+
+  m_events.push_back({ entry, start, duration, sampled });
+}
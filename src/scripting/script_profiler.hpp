@@ -0,0 +1,136 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_SCRIPTING_SCRIPTPROFILER_HPP
+#define _HEADER_HARBOR_SCRIPTING_SCRIPTPROFILER_HPP
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Records how much time is spent in each script function and each bound
+ * native function of a VirtualMachine.
+ *
+ * Calls can be recorded exactly, with enter() and leave(), or estimated from
+ * samples of the call stack, with add_sample(). Inclusive time counts the
+ * functions called in turn; exclusive time doesn't. Recursive calls only count
+ * once towards inclusive time.
+ */
+class ScriptProfiler final
+{
+public:
+  /** Past this many, calls are still counted but left out of the trace. */
+  static const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+public:
+  struct Entry
+  {
+    std::string name;
+    size_t calls;
+    size_t samples;
+    /** In milliseconds. */
+    double inclusive;
+    double exclusive;
+  };
+
+public:
+  ScriptProfiler();
+
+  /** Starts the sampling clock; time before that isn't attributed. */
+  void start();
+  /**
+   * Restarts the sampling clock. Engines that sample call it whenever they
+   * enter or leave a script, so that the time spent outside of scripts isn't
+   * attributed to the next sample.
+   */
+  void reset_sample_clock();
+  /** Leaves any function that is still running. */
+  void stop();
+  void clear();
+
+  /**
+   * Records a call to @p name, defined in @p source, until the matching call
+   * to leave().
+   */
+  void enter(const char* name, const char* source);
+  void leave();
+
+  /**
+   * Attributes the time since the previous sample to @p stack, which lists the
+   * running functions from the innermost one. The time recorded in the
+   * meantime by enter() and leave(), e. g. for native functions, is left out.
+   */
+  void add_sample(const std::vector<std::string>& stack);
+
+  /** @returns one entry per function, the most expensive (exclusive) first. */
+  std::vector<Entry> get_entries() const;
+
+  /** Prints one function per line. */
+  void print(std::ostream& out) const;
+
+  /**
+   * Writes the recorded calls in the Chrome trace event format, to be opened
+   * in about:tracing or Perfetto.
+   */
+  void write_trace(std::ostream& out) const;
+  /** @throws if @p file can't be written. */
+  void save_trace(const std::string& file) const;
+
+private:
+  struct Frame
+  {
+    size_t entry;
+    std::chrono::steady_clock::time_point start;
+    /** The time spent in the functions it called. */
+    std::chrono::steady_clock::duration children;
+  };
+
+  struct Event
+  {
+    size_t entry;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    bool sampled;
+  };
+
+private:
+  size_t get_entry(const std::string& name);
+  void add_event(size_t entry, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::duration duration, bool sampled);
+
+private:
+  std::vector<Entry> m_entries;
+  std::unordered_map<std::string, size_t> m_entry_ids;
+  /** How many calls to each entry are running, for recursive functions. */
+  std::vector<size_t> m_active;
+  /** The last sample that counted towards each entry's inclusive time. */
+  std::vector<size_t> m_last_sample;
+  std::vector<Frame> m_stack;
+  std::vector<Event> m_events;
+  size_t m_dropped_events;
+  size_t m_sample_count;
+  std::chrono::steady_clock::time_point m_origin;
+  std::chrono::steady_clock::time_point m_last_sample_time;
+  /** The time spent in calls recorded by enter() since the last sample. */
+  std::chrono::steady_clock::duration m_exact_time;
+  /** Reused to build names without allocating on every call. */
+  std::string m_key;
+};
+
+#endif
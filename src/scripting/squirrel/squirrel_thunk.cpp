@@ -0,0 +1,248 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_SCRIPTING_SQUIRREL_SQUIRRELTHUNK_HPP
+
+#include "scripting/squirrel/squirrel_thunk.hpp"
+
+#include <type_traits>
+
+#include <squirrel.h>
+
+#include "scripting/scriptable.hpp"
+#include "scripting/squirrel/squirrel_virtual_machine.hpp"
+
+static_assert(std::is_same<SquirrelThunk::Function, SQFUNCTION>::value,
+              "SquirrelThunk::Function doesn't match SQFUNCTION");
+
+SquirrelThunk::ProfileScope::ProfileScope(HSQUIRRELVM vm) :
+  m_profiler(nullptr)
+{
+  auto sqvm = SquirrelVirtualMachine::get_vm(vm);
+
+  if (!sqvm || !sqvm->is_profiling())
+    return;
+
+  // The closure is named after the exposed function
+  SQStackInfos si;
+  const SQChar* name = nullptr;
+  if (SQ_SUCCEEDED(sq_stackinfos(vm, 0, &si)))
+    name = si.funcname;
+
+  m_profiler = &sqvm->get_profiler();
+  m_profiler->enter(name, "native");
+}
+
+SquirrelThunk::ProfileScope::~ProfileScope()
+{
+  if (m_profiler)
+    m_profiler->leave();
+}
+
+void
+SquirrelThunk::get(HSQUIRRELVM vm, SQInteger idx, size_t pos, bool& value)
+{
+  SQBool bool_sq;
+  if (SQ_FAILED(sq_getbool(vm, idx, &bool_sq)))
+    throw arg_error(vm, idx, pos, "boolean");
+
+  value = static_cast<bool>(bool_sq);
+}
+
+void
+SquirrelThunk::get(HSQUIRRELVM vm, SQInteger idx, size_t pos, int& value)
+{
+  SQInteger int_sq;
+  if (SQ_FAILED(sq_getinteger(vm, idx, &int_sq)))
+    throw arg_error(vm, idx, pos, "integer");
+
+  value = static_cast<int>(int_sq);
+}
+
+void
+SquirrelThunk::get(HSQUIRRELVM vm, SQInteger idx, size_t pos, float& value)
+{
+  SQFloat float_sq;
+  if (SQ_FAILED(sq_getfloat(vm, idx, &float_sq)))
+    throw arg_error(vm, idx, pos, "float");
+
+  value = static_cast<float>(float_sq);
+}
+
+void
+SquirrelThunk::get(HSQUIRRELVM vm, SQInteger idx, size_t pos,
+                   Scriptable*& value)
+{
+  SQUserPointer obj;
+  if (SQ_FAILED(sq_getinstanceup(vm, idx, &obj, nullptr)))
+    throw arg_error(vm, idx, pos, "class");
+
+  value = static_cast<Scriptable*>(obj);
+}
+
+void
+SquirrelThunk::get(HSQUIRRELVM vm, SQInteger idx, size_t pos,
+                   std::string& value)
+{
+  const SQChar* str_sq;
+  if (SQ_FAILED(sq_getstring(vm, idx, &str_sq)))
+    throw arg_error(vm, idx, pos, "string");
+
+  value.assign(str_sq, static_cast<size_t>(sq_getsize(vm, idx)));
+}
+
+void
+SquirrelThunk::push(HSQUIRRELVM vm, bool value)
+{
+  sq_pushbool(vm, static_cast<SQBool>(value));
+}
+
+void
+SquirrelThunk::push(HSQUIRRELVM vm, int value)
+{
+  sq_pushinteger(vm, static_cast<SQInteger>(value));
+}
+
+void
+SquirrelThunk::push(HSQUIRRELVM vm, float value)
+{
+  sq_pushfloat(vm, static_cast<SQFloat>(value));
+}
+
+void
+SquirrelThunk::push(HSQUIRRELVM vm, Scriptable* value)
+{
+  auto sqvm = SquirrelVirtualMachine::get_vm(vm);
+
+  if (!sqvm)
+    throw std::runtime_error("Native function returned an object outside of "
+                             "a Harbor VM");
+
+  sqvm->push_instance(value->get_classname(), value);
+}
+
+void
+SquirrelThunk::push(HSQUIRRELVM vm, const std::string& value)
+{
+  sq_pushstring(vm, value.c_str(), static_cast<SQInteger>(value.size()));
+}
+
+void*
+SquirrelThunk::get_callable(HSQUIRRELVM vm)
+{
+  // The bound function is the closure's only free variable, which Squirrel
+  // pushes above the call arguments
+  SQUserPointer callable;
+  if (SQ_FAILED(sq_getuserpointer(vm, -1, &callable)))
+    return nullptr;
+
+  return callable;
+}
+
+SQInteger
+SquirrelThunk::get_top(HSQUIRRELVM vm)
+{
+  return sq_gettop(vm);
+}
+
+SQInteger
+SquirrelThunk::throw_error(HSQUIRRELVM vm, const char* message)
+{
+  return sq_throwerror(vm, message);
+}
+
+void
+SquirrelThunk::check_arg_count(HSQUIRRELVM vm, SQInteger nargs)
+{
+  // One slot is `this`, one is the free variable
+  if (sq_gettop(vm) - 1 < nargs)
+  {
+    throw std::runtime_error("Not enough args to call native function "
+                             "(expected " + std::to_string(nargs) + ", got "
+                             + std::to_string(sq_gettop(vm) - 2) + ")");
+  }
+}
+
+std::runtime_error
+SquirrelThunk::arg_error(HSQUIRRELVM vm, SQInteger idx, size_t pos,
+                         const char* type)
+{
+  // FIXME: Print the actual type names
+  return std::runtime_error("Native function couldn't parse "
+                            + std::string(type) + " at position " + std::to_string(pos + 1)
+                            + " (Squirrel reports: "
+                            + std::to_string(sq_gettype(vm, idx)) + ")");
+}
+
+#else
+
+#include "function_tuple_args.hpp"
+
+template<typename R, typename... A>
+SquirrelThunk::Integer
+SquirrelThunk::call(SQVM* vm)
+{
+  ProfileScope profile(vm);
+
+  void* callable = get_callable(vm);
+  if (!callable)
+    return throw_error(vm, "Native closure has no bound function");
+
+  const auto& func = *static_cast<std::function<R(A...)>*>(callable);
+  const Integer nargs = static_cast<Integer>(sizeof...(A));
+
+  check_arg_count(vm, nargs);
+
+  // The arguments are the values right below the free variable. If the call
+  // has one more argument than that, it is `this`, which class methods take
+  // as their first argument.
+  std::tuple<A...> args;
+  FetchArg<0, sizeof...(A), A...>::fetch(vm, get_top(vm) - nargs, args);
+
+  return ReturnVal<R, A...>::exec(vm, func, std::move(args));
+}
+
+template<std::size_t Current, std::size_t End, typename... Args>
+void
+SquirrelThunk::FetchArg<Current, End, Args...>::fetch(SQVM* vm, Integer first,
+                                                  std::tuple<Args...>& tuple)
+{
+  get(vm, first + static_cast<Integer>(Current), Current,
+      std::get<Current>(tuple));
+
+  FetchArg<Current + 1, End, Args...>::fetch(vm, first, tuple);
+}
+
+template<typename R, typename... A>
+SquirrelThunk::Integer
+SquirrelThunk::ReturnVal<R, A...>::exec(SQVM* vm,
+                                        const std::function<R(A...)>& func,
+                                        std::tuple<A...>&& args)
+{
+  push(vm, ::call(func, std::move(args)));
+  return 1;
+}
+
+template<typename... A>
+SquirrelThunk::Integer
+SquirrelThunk::ReturnVal<void, A...>::exec(SQVM* /* vm */,
+                                          const std::function<void(A...)>& func,
+                                           std::tuple<A...>&& args)
+{
+  ::call(func, std::move(args));
+  return 0;
+}
+
+#endif
@@ -0,0 +1,141 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_SCRIPTING_SQUIRREL_SQUIRRELTHUNK_HPP
+#define _HEADER_HARBOR_SCRIPTING_SQUIRREL_SQUIRRELTHUNK_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+class Scriptable;
+class ScriptProfiler;
+struct SQVM;
+
+/**
+ * Native closures generated by VirtualMachine::bind() for Squirrel.
+ *
+ * Each closure carries a pointer to the bound `std::function` as its only free
+ * variable, and converts its arguments and return value directly between the
+ * Squirrel stack and C++.
+ *
+ * Only the Squirrel VM type is forward-declared here, so that the thunks can
+ * be generated from virtual_machine.hpp without including squirrel.h; the
+ * templates only call the functions declared below, which are compiled with
+ * the Squirrel VM.
+ */
+class SquirrelThunk final
+{
+public:
+  /** SQInteger, as squirrel.h defines it; checked in squirrel_thunk.cpp. */
+#if defined(_WIN64) || defined(_LP64) || defined(_SQ64)
+  typedef long long Integer;
+#else
+  typedef int Integer;
+#endif
+  /** SQFUNCTION. */
+  typedef Integer (*Function)(SQVM* vm);
+
+public:
+  template<typename R, typename... A>
+  static Integer call(SQVM* vm);
+
+private:
+  // ========================================================================
+  // FETCH_ARG
+
+  template<std::size_t Current, std::size_t End, typename... Args>
+  class FetchArg;
+
+  template<std::size_t End, typename... Args>
+  class FetchArg<End, End, Args...>
+  {
+  public:
+    static void fetch(SQVM* /* vm */, Integer /* first */,
+                      std::tuple<Args...>& /* tuple */) {}
+  };
+
+  template<std::size_t Current, std::size_t End, typename... Args>
+  class FetchArg
+  {
+  public:
+    static void fetch(SQVM* vm, Integer first,
+                      std::tuple<Args...>& tuple);
+  };
+
+  // ========================================================================
+  // RETURN_VAL
+
+  template<typename R, typename... A>
+  class ReturnVal
+  {
+  public:
+    static Integer exec(SQVM* vm, const std::function<R(A...)>& func,
+                        std::tuple<A...>&& args);
+  };
+
+  template<typename... A>
+  class ReturnVal<void, A...>
+  {
+  public:
+    static Integer exec(SQVM* vm, const std::function<void(A...)>& func,
+                        std::tuple<A...>&& args);
+  };
+
+  /** Records the native call in the VM's profiler, if it is on. */
+  class ProfileScope final
+  {
+  public:
+    ProfileScope(SQVM* vm);
+    ~ProfileScope();
+
+  private:
+    ScriptProfiler* m_profiler;
+
+  private:
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+  };
+
+private:
+  static void get(SQVM* vm, Integer idx, size_t pos, bool& value);
+  static void get(SQVM* vm, Integer idx, size_t pos, int& value);
+  static void get(SQVM* vm, Integer idx, size_t pos, float& value);
+  static void get(SQVM* vm, Integer idx, size_t pos, Scriptable*& value);
+  static void get(SQVM* vm, Integer idx, size_t pos, std::string& value);
+
+  static void push(SQVM* vm, bool value);
+  static void push(SQVM* vm, int value);
+  static void push(SQVM* vm, float value);
+  static void push(SQVM* vm, Scriptable* value);
+  static void push(SQVM* vm, const std::string& value);
+
+  /** @returns The bound function, or nullptr if the closure has none. */
+  static void* get_callable(SQVM* vm);
+  static Integer get_top(SQVM* vm);
+  /** Raises @p message as a script error; return the result from the thunk. */
+  static Integer throw_error(SQVM* vm, const char* message);
+  static void check_arg_count(SQVM* vm, Integer nargs);
+  static std::runtime_error arg_error(SQVM* vm, Integer idx,
+                                      size_t pos, const char* type);
+
+private:
+  SquirrelThunk() = delete;
+};
+
+#include "scripting/squirrel/squirrel_thunk.cpp"
+
+#endif
@@ -17,193 +17,54 @@
 #include "scripting/squirrel/squirrel_virtual_machine.hpp"
 
 #include <stdarg.h>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
+#include "make_unique.hpp"
+
 #include "scripting/scriptable.hpp"
 #include "util/log.hpp"
+#include "util/mapped_file.hpp"
 
-SquirrelVirtualMachine* 
-SquirrelVirtualMachine::get_vm(const HSQUIRRELVM vm)
-{
-  for (auto* sqvm : s_vms)
-  {
-    if (sqvm->m_vm == vm)
-    {
-      return sqvm;
-    }
-  }
-
-  return nullptr;
-}
+namespace {
 
-void
-SquirrelVirtualMachine::clear_vms()
+struct BytecodeReader
 {
-  for (auto it = s_vms.begin(); it != s_vms.end();)
-  {
-    if ((*it)->m_dead)
-    {
-      it = s_vms.erase(it);
-    }
-    else
-    {
-      it++;
-    }
-  }
-}
+  const uint8_t* data;
+  size_t size;
+  size_t pos;
+};
 
 SQInteger
-SquirrelVirtualMachine::squirrel_call(HSQUIRRELVM vm)
+read_bytecode(SQUserPointer reader_ptr, SQUserPointer buffer, SQInteger size)
 {
-  auto sqvm = get_vm(vm);
-
-  if (!sqvm)
-    return 0;
-
-  const SQChar* func_name;
-  sq_getclosurename(vm, 0);
-  sq_getstring(vm, -1, &func_name);
-  sq_pop(vm, 1);
-
-  const auto* func = sqvm->get_function_by_name(std::string(func_name));
-
-  if (!func)
-    return 0;
-
-  // Parse arguments
-  std::vector<std::unique_ptr<Type>> args;
-
-  int nargs = static_cast<int>(func->m_arg_types.size());
-
-  if (sq_gettop(vm) < nargs)
-  {
-    throw std::runtime_error("Not enough args to call '"
-                              + std::string(func_name) + "'");
-  }
-
-  for (int i = 0; i < nargs; i++)
-  {
-    auto t = func->m_arg_types[static_cast<size_t>(i)];
-    int argn = i - nargs;
-    switch(t)
-    {
-      case Types::BOOLEAN:
-      {
-        SQBool bool_sq;
-        if (SQ_FAILED(sq_getbool(vm, argn, &bool_sq)))
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + std::string(func_name)
-                                  + "' couldn't parse boolean at position "
-                                  + std::to_string(i + 1) + " (Squirrel "
-                                  + "reports: " + std::to_string(
-                                    sq_gettype(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Boolean>(static_cast<bool>(bool_sq)));
-        break;
-      }
-
-      case Types::INTEGER:
-      {
-        SQInteger int_sq;
-        if (SQ_FAILED(sq_getinteger(vm, argn, &int_sq)))
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + std::string(func_name)
-                                  + "' couldn't parse integer at position "
-                                  + std::to_string(i + 1) + " (Squirrel "
-                                  + "reports: " + std::to_string(
-                                    sq_gettype(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Integer>(static_cast<int>(int_sq)));
-        break;
-      }
+  auto* reader = static_cast<BytecodeReader*>(reader_ptr);
 
-      case Types::FLOAT:
-      {
-        SQFloat float_sq;
-        if (SQ_FAILED(sq_getfloat(vm, argn, &float_sq)))
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + std::string(func_name)
-                                  + "' couldn't parse float at position "
-                                  + std::to_string(i + 1) + " (Squirrel "
-                                  + "reports: " + std::to_string(
-                                    sq_gettype(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Float>(static_cast<float>(float_sq)));
-        break;
-      }
+  size_t n = std::min(static_cast<size_t>(size), reader->size - reader->pos);
+  memcpy(buffer, reader->data + reader->pos, n);
+  reader->pos += n;
 
-      case Types::OBJECT:
-      {
-        SQUserPointer obj;
-        if (SQ_FAILED(sq_getinstanceup(vm, argn, &obj, nullptr)))
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + std::string(func_name)
-                                  + "' couldn't parse class at position "
-                                  + std::to_string(i + 1) + " (Squirrel "
-                                  + "reports: " + std::to_string(
-                                    sq_gettype(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::Object>(static_cast<Scriptable*>(obj)));
-        break;
-      }
-
-      case Types::STRING:
-      {
-        const char* str_sq;
-        if (SQ_FAILED(sq_getstring(vm, argn, &str_sq)))
-        {
-          // FIXME: Print the actual type names
-          throw std::runtime_error("Call to '" + std::string(func_name)
-                                  + "' couldn't parse string at position "
-                                  + std::to_string(i + 1) + " (Squirrel "
-                                  + "reports: " + std::to_string(
-                                    sq_gettype(vm, argn)) + ")");
-        }
-        args.push_back(std::make_unique<VirtualMachine::String>(std::string(str_sq)));
-        break;
-      }
-    }
-  }
+  return static_cast<SQInteger>(n);
+}
 
-  // Call function
-  auto ret = func->m_function(args);
+SQInteger
+write_bytecode(SQUserPointer out, SQUserPointer buffer, SQInteger size)
+{
+  static_cast<std::string*>(out)->append(static_cast<const char*>(buffer),
+                                         static_cast<size_t>(size));
+  return size;
+}
 
-  // Parse return value
-  if (auto b = dynamic_cast<VirtualMachine::Boolean*>(ret.get()))
-  {
-    sq_pushbool(vm, b->m_value);
-    return 1;
-  }
-  else if (auto i = dynamic_cast<VirtualMachine::Integer*>(ret.get()))
-  {
-    sq_pushinteger(vm, i->m_value);
-    return 1;
-  }
-  else if (auto f = dynamic_cast<VirtualMachine::Float*>(ret.get()))
-  {
-    sq_pushfloat(vm, f->m_value);
-    return 1;
-  }
-  else if (auto o = dynamic_cast<VirtualMachine::Object*>(ret.get()))
-  {
-    sqvm->push_instance(o->m_value->get_classname(), o->m_value);
-    return 1;
-  }
-  else if (auto s = dynamic_cast<VirtualMachine::String*>(ret.get()))
-  {
-    sq_pushstring(vm, s->m_value.c_str(), static_cast<SQInteger>(s->m_value.size()));
-    return 1;
-  }
+} // namespace
 
-  return 0;
+SquirrelVirtualMachine* 
+SquirrelVirtualMachine::get_vm(const HSQUIRRELVM vm)
+{
+  // The constructor stores the owning object as the VM's foreign pointer
+  return static_cast<SquirrelVirtualMachine*>(sq_getforeignptr(vm));
 }
 
-std::vector<SquirrelVirtualMachine*> SquirrelVirtualMachine::s_vms;
-
 void
 SquirrelVirtualMachine::print(HSQUIRRELVM vm, const SQChar* str, ...)
 {
@@ -241,16 +102,40 @@ SquirrelVirtualMachine::on_compile_error(HSQUIRRELVM /*vm*/, const SQChar* desc,
             << ": " << std::string(desc) << std::endl;
 }
 
+void
+SquirrelVirtualMachine::profile_hook(HSQUIRRELVM vm, SQInteger type,
+                                     const SQChar* source,
+                                     SQInteger /* line */,
+                                     const SQChar* funcname)
+{
+  auto svm = get_vm(vm);
+
+  if (!svm || !svm->is_profiling())
+    return;
+
+  // Native closures don't trigger the hook; their thunks record themselves
+  switch (type)
+  {
+    case 'c':
+      svm->get_profiler().enter(funcname, source);
+      break;
+
+    case 'r':
+      svm->get_profiler().leave();
+      break;
+
+    default:
+      break;
+  }
+}
+
 SquirrelVirtualMachine::SquirrelVirtualMachine() :
   m_vm(sq_open(1024)),
   m_current_top(0),
-  m_dead(false),
   m_functions(),
   m_objects(),
   m_print_stream(nullptr)
 {
-  s_vms.push_back(this);
-
   sq_setforeignptr(m_vm, this);
   sq_setcompilererrorhandler(m_vm, SquirrelVirtualMachine::on_compile_error);
   sq_setprintfunc(m_vm, SquirrelVirtualMachine::print, SquirrelVirtualMachine::print);
@@ -258,10 +143,6 @@ SquirrelVirtualMachine::SquirrelVirtualMachine() :
 
 SquirrelVirtualMachine::~SquirrelVirtualMachine()
 {
-  m_dead = true;
-
-  clear_vms();
-
   if (m_vm)
   {
     sq_close(m_vm);
@@ -271,17 +152,30 @@ SquirrelVirtualMachine::~SquirrelVirtualMachine()
 void
 SquirrelVirtualMachine::run_code(std::string code, std::string source)
 {
-  std::istringstream s(code);
-
-  SQRESULT r = sq_compilebuffer(m_vm, code.c_str(),
-                                static_cast<SQInteger>(code.size()),
-                                source.c_str(),
-                                SQTrue);
+  std::string cache_file = get_cache_file(code, source, "cnut");
+  SQRESULT r;
 
-  if (SQ_FAILED(r))
+  if (cache_file.empty() || !load_bytecode(cache_file))
   {
-    // get_error() will return only the message, not the line/column
-    throw std::runtime_error("Could not compile Squirrel script");
+    r = sq_compilebuffer(m_vm, code.c_str(),
+                         static_cast<SQInteger>(code.size()),
+                         source.c_str(),
+                         SQTrue);
+
+    if (SQ_FAILED(r))
+    {
+      // get_error() will return only the message, not the line/column
+      throw std::runtime_error("Could not compile Squirrel script");
+    }
+
+    if (!cache_file.empty())
+    {
+      std::string bytecode;
+      if (SQ_SUCCEEDED(sq_writeclosure(m_vm, write_bytecode, &bytecode)))
+      {
+        write_cache_file(cache_file, bytecode);
+      }
+    }
   }
 
   m_current_top = sq_gettop(m_vm);
@@ -308,12 +202,12 @@ SquirrelVirtualMachine::expose_class(std::string name,
 
   for (auto& m : methods)
   {
+    m_functions.push_back(m);
+
     sq_pushstring(m_vm, m.m_name.c_str(), -1);
-    sq_newclosure(m_vm, squirrel_call, 0);
+    push_closure(m_functions.back());
     sq_setnativeclosurename(m_vm, -1, m.m_name.c_str());
     sq_newslot(m_vm, -3, SQFalse); // Add the method
-
-    m_functions.push_back(m);
   }
 
   sq_newslot(m_vm, -3, SQFalse); // Add the class
@@ -413,7 +307,7 @@ SquirrelVirtualMachine::expose_object(std::string name,
     m_functions.push_back(func_copy);
 
     sq_pushstring(m_vm, func.m_name.c_str(), -1);
-    sq_newclosure(m_vm, squirrel_call, 0);
+    push_closure(m_functions.back());
     sq_setnativeclosurename(m_vm, -1, func_copy.m_name.c_str());
     sq_newslot(m_vm, -3, SQFalse);
   }
@@ -435,7 +329,7 @@ SquirrelVirtualMachine::expose_function(ExposableFunction func)
   sq_pushroottable(m_vm);
   std::string varname = resolve_name(func.m_name, false);
   sq_pushstring(m_vm, varname.c_str(), -1);
-  sq_newclosure(m_vm, squirrel_call, 0);
+  push_closure(m_functions.back());
   if (SQ_FAILED(sq_setnativeclosurename(m_vm, -1, func.m_name.c_str())))
   {
     sq_pop(m_vm, 3);
@@ -530,15 +424,56 @@ SquirrelVirtualMachine::expose_string(std::string name, std::string val)
  *                      to the object containing the function.
  * @author Semphris <semphris@protonmail.com>
  */
-std::vector<std::unique_ptr<VirtualMachine::Type>>
+std::vector<VirtualMachine::Value>
 SquirrelVirtualMachine::call_function(std::string func_name,
-                                      std::vector<std::unique_ptr<Type>> args,
+                                      std::vector<Value> args,
                                       Scriptable* obj, bool func_relative)
+{
+  auto top = sq_gettop(m_vm);
+
+  push_function(func_name, obj, func_relative);
+
+  return call_pushed_function(args, top, func_name);
+}
+
+/**
+ * Resolves a function in the squirrel environment once, so that it can be
+ * called repeatedly without looking up its name again.
+ *
+ * @see call_function() for the meaning of the arguments.
+ */
+std::unique_ptr<VirtualMachine::Callable>
+SquirrelVirtualMachine::get_callable(std::string name, Scriptable* obj,
+                                     bool func_relative)
+{
+  auto top = sq_gettop(m_vm);
+
+  push_function(name, obj, func_relative);
+
+  HSQOBJECT function, self;
+  sq_resetobject(&function);
+  sq_resetobject(&self);
+  sq_getstackobj(m_vm, -2, &function);
+  sq_getstackobj(m_vm, -1, &self);
+
+  std::unique_ptr<Callable> callable =
+    std::make_unique<SquirrelCallable>(*this, name, function, self);
+
+  sq_settop(m_vm, top);
+
+  return callable;
+}
+
+void
+SquirrelVirtualMachine::push_function(std::string func_name, Scriptable* obj,
+                                      bool func_relative)
 {
   // The lazy way to protect the stack
   auto top = sq_gettop(m_vm);
 
-  if (obj && func_relative)
+  const HSQOBJECT* self = nullptr;
+
+  if (obj)
   {
     const auto& it = m_objects.find(obj);
 
@@ -547,7 +482,12 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       throw std::runtime_error("Attempt to call function on unexposed object");
     }
 
-    sq_pushobject(m_vm, it->second);
+    self = &it->second;
+  }
+
+  if (self && func_relative)
+  {
+    sq_pushobject(m_vm, *self);
   }
   else
   {
@@ -565,11 +505,9 @@ SquirrelVirtualMachine::call_function(std::string func_name,
   }
 
   // Push 'this'
-  if (obj)
+  if (self)
   {
-    // FIXME: Don't recalculate that
-    const auto& it = m_objects.find(obj);
-    sq_pushobject(m_vm, it->second);
+    sq_pushobject(m_vm, *self);
   }
   else
   {
@@ -579,55 +517,84 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       resolve_name(func_name, false);
     }
   }
+}
 
-  // Push args
-  for (const auto& arg : args)
-  {
-    if (auto b = dynamic_cast<const Boolean*>(arg.get()))
-    {
-      sq_pushbool(m_vm, b->m_value);
-    }
-    else if (auto i = dynamic_cast<const Integer*>(arg.get()))
-    {
-      sq_pushinteger(m_vm, i->m_value);
-    }
-    else if (auto f = dynamic_cast<const Float*>(arg.get()))
-    {
-      sq_pushfloat(m_vm, f->m_value);
-    }
-    else if (auto o = dynamic_cast<const Object*>(arg.get()))
-    {
-      try
-      {
-        push_instance(o->m_value->get_classname(), o->m_value);
-      }
-      catch(std::runtime_error& e)
-      {
-        sq_pop(m_vm, sq_gettop(m_vm) - top);
-        throw e;
-      }
-    }
-    else if (auto s = dynamic_cast<const String*>(arg.get()))
-    {
-      sq_pushstring(m_vm, s->m_value.c_str(), static_cast<SQInteger>(s->m_value.size()));
-    }
-    else
-    {
-      sq_pop(m_vm, sq_gettop(m_vm) - top);
-      throw std::runtime_error("Unknown argument type");
-    }
-  }
+std::vector<VirtualMachine::Value>
+SquirrelVirtualMachine::call_pushed_function(const Arguments& args,
+                                             SQInteger top,
+                                             const std::string& func_name)
+{
+  push_arguments(args, top);
 
   // Call Squirrel function
   if (SQ_FAILED(sq_call(m_vm, args.size() + 1, SQTrue, SQTrue)))
   {
     sq_pop(m_vm, sq_gettop(m_vm) - top);
-    throw std::runtime_error("Could not call function: " + get_error());
+    throw std::runtime_error("Could not call function '" + func_name + "': "
+                             + get_error());
+  }
+
+  std::vector<Value> ret;
+
+  Value value = get_return_value();
+  if (value.get_type() != Types::NONE)
+  {
+    ret.push_back(std::move(value));
+  }
+
+  sq_pop(m_vm, sq_gettop(m_vm) - top);
+
+  return ret;
+}
+
+void
+SquirrelVirtualMachine::push_arguments(const Arguments& args, SQInteger top)
+{
+  for (const auto& arg : args)
+  {
+    switch (arg.get_type())
+    {
+      case Types::BOOLEAN:
+        sq_pushbool(m_vm, arg.get_bool());
+        break;
+
+      case Types::INTEGER:
+        sq_pushinteger(m_vm, arg.get_int());
+        break;
+
+      case Types::FLOAT:
+        sq_pushfloat(m_vm, arg.get_float());
+        break;
+
+      case Types::OBJECT:
+        try
+        {
+          push_instance(arg.get_object()->get_classname(), arg.get_object());
+        }
+        catch(std::runtime_error& e)
+        {
+          sq_pop(m_vm, sq_gettop(m_vm) - top);
+          throw e;
+        }
+        break;
+
+      case Types::STRING:
+        sq_pushstring(m_vm, arg.get_string(),
+                      static_cast<SQInteger>(arg.get_string_size()));
+        break;
+
+      case Types::NONE:
+        sq_pop(m_vm, sq_gettop(m_vm) - top);
+        throw std::runtime_error("Unknown argument type");
+    }
   }
+}
 
-  std::vector<std::unique_ptr<VirtualMachine::Type>> ret;
+VirtualMachine::Value
+SquirrelVirtualMachine::get_return_value()
+{
+  Value ret;
 
-  // Parse return value
   switch (sq_gettype(m_vm, -1))
   {
     case SQObjectType::OT_BOOL:
@@ -635,7 +602,7 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       SQBool sqb;
       // FIXME: Uninitialized variable if call failed
       sq_getbool(m_vm, -1, &sqb);
-      ret.push_back(std::make_unique<Boolean>(static_cast<bool>(sqb)));
+      ret = Value(static_cast<bool>(sqb));
       break;
     }
 
@@ -644,7 +611,7 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       SQFloat sqf;
       // FIXME: Uninitialized variable if call failed
       sq_getfloat(m_vm, -1, &sqf);
-      ret.push_back(std::make_unique<Float>(static_cast<float>(sqf)));
+      ret = Value(static_cast<float>(sqf));
       break;
     }
 
@@ -653,7 +620,7 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       SQInteger sqi;
       // FIXME: Uninitialized variable if call failed
       sq_getinteger(m_vm, -1, &sqi);
-      ret.push_back(std::make_unique<Integer>(static_cast<int>(sqi)));
+      ret = Value(static_cast<int>(sqi));
       break;
     }
 
@@ -662,7 +629,8 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       const SQChar* sqs;
       // FIXME: Uninitialized variable if call failed
       sq_getstring(m_vm, -1, &sqs);
-      ret.push_back(std::make_unique<String>(std::string(sqs)));
+      // The string is popped by the caller, so the value must own a copy
+      ret = Value(sqs, static_cast<size_t>(sq_getsize(m_vm, -1)));
       break;
     }
 
@@ -671,7 +639,7 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       SQUserPointer sqp;
       // FIXME: Uninitialized variable if call failed
       sq_getinstanceup(m_vm, -1, &sqp, nullptr);
-      ret.push_back(std::make_unique<Object>(static_cast<Scriptable*>(sqp)));
+      ret = Value(static_cast<Scriptable*>(sqp));
       break;
     }
     
@@ -679,11 +647,92 @@ SquirrelVirtualMachine::call_function(std::string func_name,
       break;
   }
 
-  sq_pop(m_vm, sq_gettop(m_vm) - top);
-
   return ret;
 }
 
+SquirrelVirtualMachine::SquirrelCallable::SquirrelCallable(
+    SquirrelVirtualMachine& vm, const std::string& name, HSQOBJECT function,
+    HSQOBJECT self) :
+  m_vm(vm),
+  m_name(name),
+  m_function(function),
+  m_self(self)
+{
+  sq_addref(m_vm.m_vm, &m_function);
+  sq_addref(m_vm.m_vm, &m_self);
+}
+
+SquirrelVirtualMachine::SquirrelCallable::~SquirrelCallable()
+{
+  sq_release(m_vm.m_vm, &m_self);
+  sq_release(m_vm.m_vm, &m_function);
+}
+
+std::vector<VirtualMachine::Value>
+SquirrelVirtualMachine::SquirrelCallable::call(const Arguments& args)
+{
+  auto top = sq_gettop(m_vm.m_vm);
+
+  sq_pushobject(m_vm.m_vm, m_function);
+  sq_pushobject(m_vm.m_vm, m_self);
+
+  return m_vm.call_pushed_function(args, top, m_name);
+}
+
+void
+SquirrelVirtualMachine::SquirrelCallable::call_batch(
+    const std::vector<Scriptable*>& receivers,
+    const std::vector<Arguments>& args, std::vector<Value>& results)
+{
+  check_batch(receivers, args);
+
+  HSQUIRRELVM vm = m_vm.m_vm;
+  auto top = sq_gettop(vm);
+
+  results.resize(receivers.size());
+
+  // sq_call() leaves the closure on the stack, so it is only pushed once
+  sq_pushobject(vm, m_function);
+
+  for (size_t i = 0; i < receivers.size(); i++)
+  {
+    // Push 'this'
+    if (receivers[i])
+    {
+      try
+      {
+        m_vm.push_instance(receivers[i]->get_classname(), receivers[i]);
+      }
+      catch(std::runtime_error& e)
+      {
+        sq_pop(vm, sq_gettop(vm) - top);
+        throw e;
+      }
+    }
+    else
+    {
+      sq_pushobject(vm, m_self);
+    }
+
+    Arguments call_args = args.empty() ? Arguments(nullptr, 0) : args[i];
+    m_vm.push_arguments(call_args, top);
+
+    if (SQ_FAILED(sq_call(vm, call_args.size() + 1, SQTrue, SQTrue)))
+    {
+      sq_pop(vm, sq_gettop(vm) - top);
+      throw std::runtime_error("Could not call function '" + m_name + "': "
+                               + m_vm.get_error());
+    }
+
+    results[i] = m_vm.get_return_value();
+
+    // Pop the return value
+    sq_pop(vm, 1);
+  }
+
+  sq_pop(vm, sq_gettop(vm) - top);
+}
+
 void
 SquirrelVirtualMachine::remove_entry(std::string name)
 {
@@ -698,24 +747,17 @@ SquirrelVirtualMachine::remove_entry(std::string name)
   sq_pop(m_vm, 1);
 }
 
-const VirtualMachine::ExposableFunction*
-SquirrelVirtualMachine::get_function_by_name(const std::string& name) const
+void
+SquirrelVirtualMachine::set_print(std::ostream* out)
 {
-  for (const auto& f : m_functions)
-  {
-    if (f.m_name == name)
-    {
-      return &f;
-    }
-  }
-
-  return nullptr;
+  m_print_stream = out;
 }
 
 void
-SquirrelVirtualMachine::set_print(std::ostream* out)
+SquirrelVirtualMachine::set_profiling_hook(bool enabled)
 {
-  m_print_stream = out;
+  sq_setnativedebughook(m_vm, enabled ? SquirrelVirtualMachine::profile_hook
+                                      : nullptr);
 }
 
 std::string
@@ -742,6 +784,40 @@ SquirrelVirtualMachine::get_error()
   return std::string(str);
 }
 
+bool
+SquirrelVirtualMachine::load_bytecode(const std::string& file)
+{
+  std::unique_ptr<MappedFile> data;
+
+  try
+  {
+    data = std::make_unique<MappedFile>(file);
+  }
+  catch (std::exception&)
+  {
+    // Not cached yet
+    return false;
+  }
+
+  BytecodeReader reader{data->get_data(), data->get_size(), 0};
+
+  if (SQ_FAILED(sq_readclosure(m_vm, read_bytecode, &reader)))
+  {
+    log_warn << "Ignoring invalid Squirrel script cache '" << file << "'"
+             << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void
+SquirrelVirtualMachine::push_closure(const ExposableFunction& func)
+{
+  sq_pushuserpointer(m_vm, func.m_binding.m_callable.get());
+  sq_newclosure(m_vm, func.m_binding.m_squirrel_thunk, 1);
+}
+
 void
 SquirrelVirtualMachine::push_instance(std::string classname, Scriptable* owner)
 {
@@ -32,12 +32,10 @@ public:
   static void on_compile_error(HSQUIRRELVM vm, const SQChar* desc,
                                const SQChar* source, SQInteger line,
                                SQInteger column);
+  static void profile_hook(HSQUIRRELVM vm, SQInteger type,
+                           const SQChar* source, SQInteger line,
+                           const SQChar* funcname);
   static SquirrelVirtualMachine* get_vm(const HSQUIRRELVM vm);
-  static void clear_vms();
-  static SQInteger squirrel_call(HSQUIRRELVM vm);
-
-private:
-  static std::vector<SquirrelVirtualMachine*> s_vms;
 
 public:
   SquirrelVirtualMachine();
@@ -56,17 +54,89 @@ public:
   virtual void expose_int(std::string name, int val) override;
   virtual void expose_float(std::string name, float val) override;
   virtual void expose_string(std::string name, std::string val) override;
-  virtual std::vector<std::unique_ptr<Type>> call_function(std::string name,
-                                        std::vector<std::unique_ptr<Type>> args,
-                                        Scriptable* obj = nullptr,
-                                        bool func_relative = false) override;
+  virtual std::vector<Value> call_function(std::string name,
+                                           std::vector<Value> args,
+                                           Scriptable* obj = nullptr,
+                                           bool func_relative = false) override;
+  virtual std::unique_ptr<Callable>
+  get_callable(std::string name, Scriptable* obj = nullptr,
+               bool func_relative = false) override;
   virtual void remove_entry(std::string name) override;
 
-  const ExposableFunction* get_function_by_name(const std::string& name) const;
   void set_print(std::ostream* out);
 
+protected:
+  virtual void set_profiling_hook(bool enabled) override;
+
+private:
+  class SquirrelCallable final :
+    public Callable
+  {
+  public:
+    SquirrelCallable(SquirrelVirtualMachine& vm, const std::string& name,
+                     HSQOBJECT function, HSQOBJECT self);
+    virtual ~SquirrelCallable() override;
+
+    virtual std::vector<Value> call(const Arguments& args) override;
+    virtual void call_batch(const std::vector<Scriptable*>& receivers,
+                            const std::vector<Arguments>& args,
+                            std::vector<Value>& results) override;
+
+  private:
+    SquirrelVirtualMachine& m_vm;
+    std::string m_name;
+    HSQOBJECT m_function;
+    HSQOBJECT m_self;
+  };
+
 private:
   std::string get_error();
+
+  /**
+   * Pushes the function @p func_name, followed by the object it should be
+   * called on, as described in call_function().
+   *
+   * @throws if the function doesn't exist; nothing is left on the stack.
+   */
+  void push_function(std::string func_name, Scriptable* obj,
+                     bool func_relative);
+
+  /**
+   * Calls the function pushed by push_function() with @p args, then restores
+   * the stack to @p top.
+   *
+   * @returns the value returned by the function, if any.
+   */
+  std::vector<Value> call_pushed_function(const Arguments& args,
+                                          SQInteger top,
+                                          const std::string& func_name);
+
+  /**
+   * Pushes @p args. If one of them can't be pushed, restores the stack to
+   * @p top and throws.
+   */
+  void push_arguments(const Arguments& args, SQInteger top);
+
+  /**
+   * @returns the value on top of the stack, or an empty value if its type
+   *          can't be represented.
+   */
+  Value get_return_value();
+
+  /**
+   * Pushes the closure cached as bytecode in @p file.
+   *
+   * @returns `false`, without pushing anything, if the file doesn't exist or
+   *          doesn't hold valid bytecode.
+   */
+  bool load_bytecode(const std::string& file);
+
+  /**
+   * Pushes a native closure that calls @p func through the thunk generated by
+   * VirtualMachine::bind(). The bound function, owned by @p func, is stored
+   * as the closure's free variable.
+   */
+  void push_closure(const ExposableFunction& func);
   void push_instance(std::string classname, Scriptable* owner);
 
   /**
@@ -81,10 +151,12 @@ private:
    */
   std::string resolve_name(std::string name, bool resolve_last = true);
 
+private:
+  friend class SquirrelThunk;
+
 private:
   HSQUIRRELVM m_vm;
   SQInteger m_current_top;
-  bool m_dead;
   std::vector<ExposableFunction> m_functions;
   std::unordered_map<Scriptable*, HSQOBJECT> m_objects;
   std::ostream* m_print_stream;
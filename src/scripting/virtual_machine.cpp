@@ -18,208 +18,404 @@
 
 #include "scripting/virtual_machine.hpp"
 
-VirtualMachine::ExposableFunction::ExposableFunction(const std::string& name,
-                const std::pair<ScriptFunction, std::vector<Types>>& function) :
-  m_name(name),
-  m_function(function.first),
-  m_arg_types(function.second)
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "util/log.hpp"
+
+namespace {
+
+// 64-bit FNV-1a
+uint64_t
+hash_string(const std::string& str, uint64_t hash = 14695981039346656037ull)
 {
+  for (const char c : str)
+  {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
 }
 
-#else
+} // namespace
 
-#include <stdexcept>
+VirtualMachine::Binding::Binding() :
+  m_callable()
+#if HARBOR_USE_SCRIPTING_SQUIRREL
+  , m_squirrel_thunk(nullptr)
+#endif
+#if HARBOR_USE_SCRIPTING_LUA
+  , m_lua_thunk(nullptr)
+#endif
+{
+}
 
-#include "function_tuple_args.hpp"
-#include "make_unique.hpp"
+VirtualMachine::ExposableFunction::ExposableFunction(const std::string& name,
+                                                     const Binding& binding) :
+  m_name(name),
+  m_binding(binding)
+{
+}
 
-template<size_t Pos, typename... Args>
 void
-VirtualMachine::SingleArg<bool, Pos, Args...>::parse(std::tuple<Args...>& tuple, VirtualMachine::Type* arg)
+VirtualMachine::Callable::check_batch(const std::vector<Scriptable*>& receivers,
+                                      const std::vector<Arguments>& args)
 {
-  const auto i = dynamic_cast<const VirtualMachine::Boolean*>(arg);
-
-  if (!i)
+  if (!args.empty() && args.size() != receivers.size())
   {
-    throw std::runtime_error("Argument " + std::to_string(Pos + 1) + " must be a boolean");
+    throw std::runtime_error("Batch call got " + std::to_string(args.size())
+                             + " argument lists for "
+                             + std::to_string(receivers.size())
+                             + " receivers");
   }
+}
 
-  std::get<Pos>(tuple) = i->m_value;
+VirtualMachine::Value::Value() :
+  m_type(Types::NONE),
+  m_storage(Storage::INLINE),
+  m_size(0),
+  m_object(nullptr)
+{
 }
 
-template<size_t Pos, typename... Args>
-void
-VirtualMachine::SingleArg<float, Pos, Args...>::parse(std::tuple<Args...>& tuple, VirtualMachine::Type* arg)
+VirtualMachine::Value::Value(bool v) :
+  m_type(Types::BOOLEAN),
+  m_storage(Storage::INLINE),
+  m_size(0),
+  m_bool(v)
 {
-  const auto i = dynamic_cast<const VirtualMachine::Float*>(arg);
+}
 
-  if (!i)
-  {
-    throw std::runtime_error("Argument " + std::to_string(Pos + 1) + " must be a float");
-  }
+VirtualMachine::Value::Value(int v) :
+  m_type(Types::INTEGER),
+  m_storage(Storage::INLINE),
+  m_size(0),
+  m_int(v)
+{
+}
 
-  std::get<Pos>(tuple) = i->m_value;
+VirtualMachine::Value::Value(float v) :
+  m_type(Types::FLOAT),
+  m_storage(Storage::INLINE),
+  m_size(0),
+  m_float(v)
+{
 }
 
-template<size_t Pos, typename... Args>
-void
-VirtualMachine::SingleArg<int, Pos, Args...>::parse(std::tuple<Args...>& tuple, VirtualMachine::Type* arg)
+VirtualMachine::Value::Value(Scriptable* v) :
+  m_type(Types::OBJECT),
+  m_storage(Storage::INLINE),
+  m_size(0),
+  m_object(v)
 {
-  const auto i = dynamic_cast<const VirtualMachine::Integer*>(arg);
+}
 
-  if (!i)
-  {
-    throw std::runtime_error("Argument " + std::to_string(Pos + 1) + " must be an integer");
-  }
+VirtualMachine::Value::Value(const char* v) :
+  Value(v, strlen(v))
+{
+}
+
+VirtualMachine::Value::Value(const char* v, size_t size) :
+  Value()
+{
+  set_string(v, size);
+}
 
-  std::get<Pos>(tuple) = i->m_value;
+VirtualMachine::Value::Value(const std::string& v) :
+  Value(v.c_str(), v.size())
+{
 }
 
-template<size_t Pos, typename... Args>
-void
-VirtualMachine::SingleArg<Scriptable*, Pos, Args...>::parse(std::tuple<Args...>& tuple, VirtualMachine::Type* arg)
+VirtualMachine::Value::Value(const Value& other) :
+  Value()
 {
-  const auto i = dynamic_cast<const VirtualMachine::Object*>(arg);
+  *this = other;
+}
 
-  if (!i)
-  {
-    throw std::runtime_error("Argument " + std::to_string(Pos + 1) + " must be a class");
-  }
+VirtualMachine::Value::Value(Value&& other) :
+  Value()
+{
+  *this = std::move(other);
+}
 
-  std::get<Pos>(tuple) = i->m_value;
+VirtualMachine::Value::~Value()
+{
+  clear();
 }
 
-template<size_t Pos, typename... Args>
-void
-VirtualMachine::SingleArg<std::string, Pos, Args...>::parse(std::tuple<Args...>& tuple, VirtualMachine::Type* arg)
+VirtualMachine::Value&
+VirtualMachine::Value::operator=(const Value& other)
 {
-  const auto i = dynamic_cast<const VirtualMachine::String*>(arg);
+  if (this == &other)
+    return *this;
 
-  if (!i)
+  if (other.m_type == Types::STRING)
   {
-    throw std::runtime_error("Argument " + std::to_string(Pos + 1) + " must be a string");
+    // set_string() clears the old value, so the copy can't alias it
+    set_string(other.get_string(), other.m_size);
+    return *this;
   }
 
-  std::get<Pos>(tuple) = i->m_value;
+  clear();
+  m_type = other.m_type;
+  m_storage = other.m_storage;
+  m_size = other.m_size;
+  memcpy(m_small, other.m_small, sizeof(m_small));
+
+  return *this;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<void, A...>::exec(std::function<void(A...)> func, const std::tuple<A...>& args)
+VirtualMachine::Value&
+VirtualMachine::Value::operator=(Value&& other)
 {
-  call(func, args);
-  return nullptr;
+  if (this == &other)
+    return *this;
+
+  clear();
+  m_type = other.m_type;
+  m_storage = other.m_storage;
+  m_size = other.m_size;
+  memcpy(m_small, other.m_small, sizeof(m_small));
+
+  // The heap buffer, if any, now belongs to this value
+  other.m_type = Types::NONE;
+  other.m_storage = Storage::INLINE;
+  other.m_size = 0;
+
+  return *this;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<bool, A...>::exec(std::function<bool(A...)> func, const std::tuple<A...>& args)
+bool
+VirtualMachine::Value::get_bool() const
 {
-  auto ret = std::make_unique<VirtualMachine::Boolean>();
-  ret->m_value = call(func, args);
-  return ret;
+  check_type(Types::BOOLEAN);
+  return m_bool;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<float, A...>::exec(std::function<float(A...)> func, const std::tuple<A...>& args)
+int
+VirtualMachine::Value::get_int() const
 {
-  auto ret = std::make_unique<VirtualMachine::Float>();
-  ret->m_value = call(func, args);
-  return ret;
+  check_type(Types::INTEGER);
+  return m_int;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<int, A...>::exec(std::function<int(A...)> func, const std::tuple<A...>& args)
+float
+VirtualMachine::Value::get_float() const
 {
-  auto ret = std::make_unique<VirtualMachine::Integer>();
-  ret->m_value = call(func, args);
-  return ret;
+  check_type(Types::FLOAT);
+  return m_float;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<Scriptable*, A...>::exec(std::function<Scriptable*(A...)> func, const std::tuple<A...>& args)
+Scriptable*
+VirtualMachine::Value::get_object() const
 {
-  auto ret = std::make_unique<VirtualMachine::Object>();
-  ret->m_value = call(func, args);
-  return ret;
+  check_type(Types::OBJECT);
+  return m_object;
 }
 
-template<typename... A>
-std::unique_ptr<VirtualMachine::Type>
-VirtualMachine::ReturnVal<std::string, A...>::exec(std::function<std::string(A...)> func, const std::tuple<A...>& args)
+const char*
+VirtualMachine::Value::get_string() const
 {
-  auto ret = std::make_unique<VirtualMachine::String>();
-  ret->m_value = call(func, args);
-  return ret;
+  check_type(Types::STRING);
+
+  switch (m_storage)
+  {
+    case Storage::INLINE:
+      return m_small;
+
+    case Storage::HEAP:
+      return m_string;
+  }
+
+  return nullptr;
 }
 
-template<std::size_t Current, std::size_t End, typename... Args>
-VirtualMachine::FetchArg<Current, End, Args...>::FetchArg(std::tuple<Args...>& tuple, const std::vector<std::unique_ptr<VirtualMachine::Type>>& args)
+size_t
+VirtualMachine::Value::get_string_size() const
 {
-  SingleArg<typename std::tuple_element<Current, std::tuple<Args...>>::type, Current, Args...>::parse(tuple, args[Current].get());
-
-  FetchArg<Current + 1, End, Args...>(tuple, args);
+  check_type(Types::STRING);
+  return m_size;
 }
 
-template<std::size_t Current, std::size_t End, typename... Args>
 void
-VirtualMachine::ListArg<Current, End, Args...>::list(std::vector<VirtualMachine::Types>& list)
+VirtualMachine::Value::set_string(const char* str, size_t size)
 {
-  if (std::is_same<typename std::tuple_element<Current, std::tuple<Args...>>::type, bool>::value)
+  char* buffer;
+
+  if (size > SMALL_STRING_SIZE)
   {
-    list.push_back(VirtualMachine::Types::BOOLEAN);
+    // Allocate before clearing, in case str points into this value
+    buffer = new char[size + 1];
+    memcpy(buffer, str, size);
+    clear();
+    m_storage = Storage::HEAP;
+    m_string = buffer;
   }
-  else if (std::is_same<typename std::tuple_element<Current, std::tuple<Args...>>::type, int>::value)
+  else
   {
-    list.push_back(VirtualMachine::Types::INTEGER);
+    // Copy through a temporary, in case str points into this value or the
+    // inline buffer still overlaps a heap pointer that clear() must free
+    char small[SMALL_STRING_SIZE + 1];
+    memcpy(small, str, size);
+    clear();
+    memcpy(m_small, small, size);
+    m_storage = Storage::INLINE;
+    buffer = m_small;
   }
-  else if (std::is_same<typename std::tuple_element<Current, std::tuple<Args...>>::type, float>::value)
+
+  buffer[size] = '\0';
+  m_type = Types::STRING;
+  m_size = size;
+}
+
+void
+VirtualMachine::Value::clear()
+{
+  if (m_type == Types::STRING && m_storage == Storage::HEAP)
   {
-    list.push_back(VirtualMachine::Types::FLOAT);
+    delete[] m_string;
   }
-  else if (std::is_same<typename std::tuple_element<Current, std::tuple<Args...>>::type, Scriptable*>::value)
+
+  m_type = Types::NONE;
+  m_storage = Storage::INLINE;
+  m_size = 0;
+}
+
+void
+VirtualMachine::Value::check_type(Types type) const
+{
+  if (m_type != type)
   {
-    list.push_back(VirtualMachine::Types::OBJECT);
+    throw std::runtime_error("Script value is of type "
+                             + std::to_string(static_cast<int>(m_type))
+                             + ", expected type "
+                             + std::to_string(static_cast<int>(type)));
   }
-  else if (std::is_same<typename std::tuple_element<Current, std::tuple<Args...>>::type, std::string>::value)
+}
+
+VirtualMachine::VirtualMachine() :
+  m_cache_dir(),
+  m_profiler(),
+  m_profiling(false)
+{
+}
+
+void
+VirtualMachine::set_cache_dir(const std::string& dir)
+{
+  m_cache_dir = dir;
+}
+
+const std::string&
+VirtualMachine::get_cache_dir() const
+{
+  return m_cache_dir;
+}
+
+void
+VirtualMachine::set_profiling(bool enabled)
+{
+  if (enabled == m_profiling)
+    return;
+
+  if (enabled)
   {
-    list.push_back(VirtualMachine::Types::STRING);
+    m_profiler.start();
   }
   else
   {
-    throw std::runtime_error("Unrecognized C++ argument type #" + std::to_string(Current + 1));
+    m_profiler.stop();
   }
 
-  ListArg<Current + 1, End, Args...>::list(list);
+  set_profiling_hook(enabled);
+  m_profiling = enabled;
 }
 
-template<typename R, typename... A, size_t NArgs>
-std::pair<VirtualMachine::ScriptFunction, std::vector<VirtualMachine::Types>>
-VirtualMachine::bind(std::function<R(A...)> func)
+bool
+VirtualMachine::is_profiling() const
+{
+  return m_profiling;
+}
+
+ScriptProfiler&
+VirtualMachine::get_profiler()
+{
+  return m_profiler;
+}
+
+std::string
+VirtualMachine::get_cache_file(const std::string& code,
+                               const std::string& source,
+                               const std::string& extension) const
+{
+  if (m_cache_dir.empty())
+    return "";
+
+  // The source name is part of the key, as it is stored in the debug info
+  uint64_t hash = hash_string(code, hash_string(source + '\0'));
+
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx",
+           static_cast<unsigned long long>(hash));
+
+  return m_cache_dir + "/" + name + "." + extension;
+}
+
+void
+VirtualMachine::write_cache_file(const std::string& file,
+                                 const std::string& data)
 {
-  auto function = [func](const std::vector<std::unique_ptr<VirtualMachine::Type>>& args) -> std::unique_ptr<VirtualMachine::Type> {
+  std::string tmp = file + ".tmp";
 
-    if (args.size() != std::tuple_size<std::tuple<A...>>::value)
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    if (!out)
     {
-      throw std::runtime_error("Wrong number of arguments (expected "
-                      + std::to_string(std::tuple_size<std::tuple<A...>>::value)
-                      + ", got " + std::to_string(args.size()) + ")");
+      log_warn << "Could not write script cache '" << tmp << "'" << std::endl;
+      out.close();
+      std::remove(tmp.c_str());
+      return;
     }
+  }
 
-    std::tuple<A...> native_args;
+  if (std::rename(tmp.c_str(), file.c_str()) != 0)
+  {
+    // On Windows, rename() doesn't replace an existing file
+    std::remove(file.c_str());
+
+    if (std::rename(tmp.c_str(), file.c_str()) != 0)
+    {
+      log_warn << "Could not write script cache '" << file << "'"
+               << std::endl;
+      std::remove(tmp.c_str());
+    }
+  }
+}
 
-    FetchArg<0, std::tuple_size<std::tuple<A...>>::value, A...>(native_args, args);
+#else
 
-    return ReturnVal<R, A...>::exec(func, native_args);
-  };
+template<typename R, typename... A>
+VirtualMachine::Binding
+VirtualMachine::bind(std::function<R(A...)> func)
+{
+  Binding binding;
 
-  std::vector<VirtualMachine::Types> list;
-  ListArg<0, std::tuple_size<std::tuple<A...>>::value, A...>::list(list);
+  binding.m_callable =
+      std::make_shared<std::function<R(A...)>>(std::move(func));
+#if HARBOR_USE_SCRIPTING_SQUIRREL
+  binding.m_squirrel_thunk = SquirrelThunk::call<R, A...>;
+#endif
+#if HARBOR_USE_SCRIPTING_LUA
+  binding.m_lua_thunk = LuaThunk::call<R, A...>;
+#endif
 
-  return {function, list};
+  return binding;
 }
 
 #endif
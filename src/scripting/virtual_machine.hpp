@@ -23,6 +23,15 @@
 #include <unordered_map>
 #include <vector>
 
+#include "scripting/script_profiler.hpp"
+
+#if HARBOR_USE_SCRIPTING_SQUIRREL
+#include "scripting/squirrel/squirrel_thunk.hpp"
+#endif
+#if HARBOR_USE_SCRIPTING_LUA
+#include "scripting/lua/lua_thunk.hpp"
+#endif
+
 class Scriptable;
 
 /**
@@ -30,144 +39,10 @@ class Scriptable;
  */
 class VirtualMachine
 {
-public:
-  // Forward declarations, because they will be public
-  class Type;
-  enum class Types;
-
-private:
-  // ========================================================================
-  // SINGLE_ARG
-
-  template<typename T, size_t pos, typename... Args>
-  class SingleArg;
-
-  template<size_t Pos, typename... Args>
-  class SingleArg<bool, Pos, Args...>
-  {
-  public:
-    static void parse(std::tuple<Args...>& tuple, Type* arg);
-  };
-
-  template<size_t Pos, typename... Args>
-  class SingleArg<float, Pos, Args...>
-  {
-  public:
-    static void parse(std::tuple<Args...>& tuple, Type* arg);
-  };
-
-  template<size_t Pos, typename... Args>
-  class SingleArg<int, Pos, Args...>
-  {
-  public:
-    static void parse(std::tuple<Args...>& tuple, Type* arg);
-  };
-
-  template<size_t Pos, typename... Args>
-  class SingleArg<Scriptable*, Pos, Args...>
-  {
-  public:
-    static void parse(std::tuple<Args...>& tuple, Type* arg);
-  };
-
-  template<size_t Pos, typename... Args>
-  class SingleArg<std::string, Pos, Args...>
-  {
-  public:
-    static void parse(std::tuple<Args...>& tuple, Type* arg);
-  };
-
-  // ========================================================================
-  // RETURN_VAL
-
-  template<typename T, typename... A>
-  class ReturnVal;
-
-  template<typename... A>
-  class ReturnVal<void, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<void(A...)> func, const std::tuple<A...>& args);
-  };
-
-  template<typename... A>
-  class ReturnVal<bool, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<bool(A...)> func, const std::tuple<A...>& args);
-  };
-
-  template<typename... A>
-  class ReturnVal<float, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<float(A...)> func, const std::tuple<A...>& args);
-  };
-
-  template<typename... A>
-  class ReturnVal<int, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<int(A...)> func, const std::tuple<A...>& args);
-  };
-
-  template<typename... A>
-  class ReturnVal<Scriptable*, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<Scriptable*(A...)> func, const std::tuple<A...>& args);
-  };
-
-  template<typename... A>
-  class ReturnVal<std::string, A...>
-  {
-  public:
-    static std::unique_ptr<Type> exec(std::function<std::string(A...)> func, const std::tuple<A...>& args);
-  };
-
-  // ========================================================================
-  // FETCH_ARG
-
-  template<std::size_t Current, std::size_t End, typename... Args>
-  class FetchArg;
-
-  template<std::size_t End, typename... Args>
-  class FetchArg<End, End, Args...>
-  {
-  public:
-    FetchArg(std::tuple<Args...>& /* tuple */, const std::vector<std::unique_ptr<Type>>& /* args */) {}
-  };
-
-  template<std::size_t Current, std::size_t End, typename... Args>
-  class FetchArg
-  {
-  public:
-    FetchArg(std::tuple<Args...>& tuple, const std::vector<std::unique_ptr<Type>>& args);
-  };
-
-  // ========================================================================
-  // LIST_ARG
-
-  template<std::size_t Current, std::size_t End, typename... Args>
-  class ListArg;
-
-  template<std::size_t End, typename... Args>
-  class ListArg<End, End, Args...>
-  {
-  public:
-    static void list(std::vector<Types>& /* list */) {}
-  };
-
-  template<std::size_t Current, std::size_t End, typename... Args>
-  class ListArg
-  {
-  public:
-    static void list(std::vector<Types>& list);
-  };
-
 public:
   enum class Types
   {
+    NONE,
     BOOLEAN,
     INTEGER,
     FLOAT,
@@ -175,84 +50,184 @@ public:
     STRING
   };
 
-  class Type
-  {
-    // This is just to make this class look polymorphic to the compiler
-  public:
-    virtual ~Type() = default;
-  };
-
-  class Boolean final :
-    public Type
+  /**
+   * A tagged value passed between the scripting engines and native code.
+   *
+   * Strings of up to SMALL_STRING_SIZE characters are stored inline; longer
+   * strings are copied on the heap.
+   */
+  class Value final
   {
   public:
-    Boolean() = default;
-    Boolean(bool v) : m_value(v) {}
-  public:
-    bool m_value;
-  };
+    static const size_t SMALL_STRING_SIZE = 23;
 
-  class Integer final :
-    public Type
-  {
-  public:
-    Integer() = default;
-    Integer(int v) : m_value(v) {}
   public:
-    int m_value;
+    Value();
+    Value(bool v);
+    Value(int v);
+    Value(float v);
+    Value(Scriptable* v);
+    Value(const char* v);
+    Value(const char* v, size_t size);
+    Value(const std::string& v);
+    Value(const Value& other);
+    Value(Value&& other);
+    ~Value();
+
+    Value& operator=(const Value& other);
+    Value& operator=(Value&& other);
+
+    Types get_type() const { return m_type; }
+
+    /** @throws if the value doesn't hold the requested type. */
+    bool get_bool() const;
+    int get_int() const;
+    float get_float() const;
+    Scriptable* get_object() const;
+    /** @returns a null-terminated string of get_string_size() characters. */
+    const char* get_string() const;
+    size_t get_string_size() const;
+
+  private:
+    enum class Storage
+    {
+      INLINE,
+      HEAP
+    };
+
+  private:
+    void set_string(const char* str, size_t size);
+    void clear();
+    void check_type(Types type) const;
+
+  private:
+    Types m_type;
+    Storage m_storage;
+    size_t m_size;
+    union
+    {
+      bool m_bool;
+      int m_int;
+      float m_float;
+      Scriptable* m_object;
+      char* m_string;
+      char m_small[SMALL_STRING_SIZE + 1];
+    };
   };
 
-  class Float final :
-    public Type
+  /**
+   * A non-owning view over a contiguous array of values, typically allocated
+   * on the stack by the caller.
+   */
+  class Arguments final
   {
   public:
-    Float() = default;
-    Float(float v) : m_value(v) {}
-  public:
-    float m_value;
+    Arguments(const Value* values, size_t size) :
+      m_values(values),
+      m_size(size)
+    {
+    }
+
+    Arguments(const std::vector<Value>& values) :
+      m_values(values.data()),
+      m_size(values.size())
+    {
+    }
+
+    size_t size() const { return m_size; }
+    const Value& operator[](size_t i) const { return m_values[i]; }
+    const Value* begin() const { return m_values; }
+    const Value* end() const { return m_values + m_size; }
+
+  private:
+    const Value* m_values;
+    size_t m_size;
   };
 
-  class Object final :
-    public Type
+  /**
+   * A native function bound by bind(), along with one thunk per engine that
+   * was generated for its signature. The engine thunks read the arguments
+   * straight from the engine's stack and push the result back.
+   */
+  class Binding final
   {
   public:
-    Object() = default;
-    Object(Scriptable* v) : m_value(v) {}
-  public:
-    Scriptable* m_value;
-  };
+    Binding();
 
-  class String final :
-    public Type
-  {
-  public:
-    String() = default;
-    String(std::string v) : m_value(v) {}
   public:
-    std::string m_value;
+    /** The bound std::function, type-erased. */
+    std::shared_ptr<void> m_callable;
+#if HARBOR_USE_SCRIPTING_SQUIRREL
+    SquirrelThunk::Function m_squirrel_thunk;
+#endif
+#if HARBOR_USE_SCRIPTING_LUA
+    LuaThunk::Function m_lua_thunk;
+#endif
   };
 
-  typedef std::function<std::unique_ptr<Type>(const std::vector<std::unique_ptr<Type>>&)> ScriptFunction;
-
   class ExposableFunction final
   {
   public:
     ExposableFunction() = default;
-    ExposableFunction(const std::string& name, const std::pair<ScriptFunction,
-                                                std::vector<Types>>& function);
+    ExposableFunction(const std::string& name, const Binding& binding);
 
   public:
     std::string m_name;
-    ScriptFunction m_function;
-    std::vector<Types> m_arg_types;
+    Binding m_binding;
+  };
+
+  /**
+   * A script function resolved once by get_callable(), along with the object
+   * it is called on. The handle holds a strong reference to both, so calling
+   * it skips name resolution entirely and keeps working even if the script
+   * later removes or replaces the function. It must be destroyed before the
+   * VM that created it.
+   */
+  class Callable
+  {
+  public:
+    Callable() = default;
+    virtual ~Callable() = default;
+
+    virtual std::vector<Value> call(const Arguments& args) = 0;
+
+    /**
+     * Calls the function once for each of @p receivers, with `this` set to the
+     * receiver (or to the object given to get_callable() if it is null) and
+     * with the matching entry of @p args as arguments. @p args may be empty if
+     * the function takes no arguments.
+     *
+     * The function is pushed once for the whole batch. @p results is resized
+     * to hold what each call returned (an empty value if nothing), so that
+     * reusing the same vector every frame doesn't allocate.
+     *
+     * @throws if a call fails; the remaining receivers are not called.
+     */
+    virtual void call_batch(const std::vector<Scriptable*>& receivers,
+                            const std::vector<Arguments>& args,
+                            std::vector<Value>& results) = 0;
+
+  protected:
+    /** @throws if @p args doesn't hold one entry per receiver. */
+    static void check_batch(const std::vector<Scriptable*>& receivers,
+                            const std::vector<Arguments>& args);
+
+  private:
+    Callable(const Callable&) = delete;
+    Callable& operator=(const Callable&) = delete;
   };
 
 public:
-  template<typename R, typename... A, size_t NArgs = std::tuple_size<std::tuple<A...>>::value>
-  static std::pair<ScriptFunction, std::vector<Types>> bind(std::function<R(A...)> func);
+  /**
+   * Binds a native function. Every argument and the return type must be one
+   * of `bool`, `int`, `float`, `Scriptable*` or `std::string` (or `void` for
+   * the return type); anything else fails to compile.
+   */
+  template<typename R, typename... A>
+  static Binding bind(std::function<R(A...)> func);
 
 public:
-  VirtualMachine() = default;
+  VirtualMachine();
   virtual ~VirtualMachine() = default;
 
   virtual void run_code(std::string script, std::string source) = 0;
@@ -269,12 +244,65 @@ public:
   virtual void expose_int(std::string name, int val) = 0;
   virtual void expose_float(std::string name, float val) = 0;
   virtual void expose_string(std::string name, std::string val) = 0;
-  virtual std::vector<std::unique_ptr<Type>> call_function(std::string name,
-                                        std::vector<std::unique_ptr<Type>> args,
-                                        Scriptable* obj = nullptr,
-                                        bool func_relative = false) = 0;
+  virtual std::vector<Value> call_function(std::string name,
+                                           std::vector<Value> args,
+                                           Scriptable* obj = nullptr,
+                                           bool func_relative = false) = 0;
+
+  /**
+   * Resolves a function once, for callers that call it repeatedly (e. g. every
+   * frame). The arguments have the same meaning as for call_function().
+   *
+   * @throws if the function doesn't exist.
+   */
+  virtual std::unique_ptr<Callable>
+  get_callable(std::string name, Scriptable* obj = nullptr,
+               bool func_relative = false) = 0;
   virtual void remove_entry(std::string name) = 0;
 
+  /**
+   * Sets the directory where run_code() caches compiled scripts. Each script
+   * is cached under a hash of its source, so a script whose source changed is
+   * compiled again instead of loading stale bytecode. Stale files are left in
+   * place. An empty path, the default, disables the cache.
+   */
+  void set_cache_dir(const std::string& dir);
+  const std::string& get_cache_dir() const;
+
+  /**
+   * Turns the profiler on or off. While it is on, the calls to script
+   * functions and to bound native functions are recorded in get_profiler(),
+   * which slows scripts down. Turning it off keeps what was recorded.
+   */
+  void set_profiling(bool enabled);
+  bool is_profiling() const;
+  ScriptProfiler& get_profiler();
+
+protected:
+  /** Installs or removes the engine hook that feeds get_profiler(). */
+  virtual void set_profiling_hook(bool enabled) = 0;
+
+  /**
+   * @returns the file in which the bytecode for @p code is cached, or an empty
+   *          string if the cache is disabled.
+   */
+  std::string get_cache_file(const std::string& code,
+                             const std::string& source,
+                             const std::string& extension) const;
+
+  /**
+   * Writes @p data to the cache file @p file. The file is replaced atomically,
+   * so that a concurrent or interrupted run never sees partial bytecode.
+   * Failures are logged and otherwise ignored.
+   */
+  static void write_cache_file(const std::string& file,
+                               const std::string& data);
+
+private:
+  std::string m_cache_dir;
+  ScriptProfiler m_profiler;
+  bool m_profiling;
+
 private:
   VirtualMachine(const VirtualMachine&) = delete;
   VirtualMachine& operator=(const VirtualMachine&) = delete;
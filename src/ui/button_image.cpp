@@ -35,7 +35,7 @@ ButtonImage::draw(DrawingContext& context) const
   Button::draw(context);
 
   const auto& theme = get_current_theme();
-  Texture& image = context.get_renderer().get_window().load_texture(m_image);
+  auto image = context.get_renderer().get_window().load_texture(m_image);
 
   Rect img_rect = m_rect;
   img_rect.x1 += theme.left.padding;
@@ -43,7 +43,7 @@ ButtonImage::draw(DrawingContext& context) const
   img_rect.x2 -= theme.right.padding;
   img_rect.y2 -= theme.bottom.padding;
 
-  Size s = image.get_size();
+  Size s = image->get_size();
   switch(m_scaling)
   {
     case Scaling::NONE:
@@ -54,14 +54,14 @@ ButtonImage::draw(DrawingContext& context) const
       break;
 
     case Scaling::CONTAIN:
-      s *= std::min(img_rect.height() / image.get_size().h,
-                    img_rect.width() / image.get_size().w);
+      s *= std::min(img_rect.height() / image->get_size().h,
+                    img_rect.width() / image->get_size().w);
       break;
 
     case Scaling::COVER:
     {
-      s *= std::max(img_rect.height() / image.get_size().h,
-                    img_rect.width() / image.get_size().w);
+      s *= std::max(img_rect.height() / image->get_size().h,
+                    img_rect.width() / image->get_size().w);
     }
       break;
   };
@@ -69,7 +69,7 @@ ButtonImage::draw(DrawingContext& context) const
   context.push_transform();
   context.get_transform().clip(img_rect);
 
-  context.draw_texture(image, Rect(Vector(), image.get_size()),
+  context.draw_texture(image, Rect(Vector(), image->get_size()),
                        Rect(img_rect.mid() - Vector(s / 2), s), 0.f,
                        Color(1.f, 1.f, 1.f), theme.fg_blend, m_layer);
 
@@ -20,6 +20,18 @@
 
 #include "ui/container.hpp"
 
+const Font::Handle&
+Control::Theme::get_font() const
+{
+  if (!font_handle.is_valid() || font_handle.get_size() != fontsize ||
+      font_handle.get_file() != font)
+  {
+    font_handle = Font::get_handle(font, fontsize);
+  }
+
+  return font_handle;
+}
+
 Control::Control(int layer, const Rect& rect, const ThemeSet& theme,
                  Container* parent) :
   m_rect(rect),
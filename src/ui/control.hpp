@@ -23,6 +23,7 @@
 #include "util/rect.hpp"
 #include "util/vector.hpp"
 
+#include "video/font.hpp"
 #include "video/renderer.hpp"
 
 class Container;
@@ -54,6 +55,14 @@ public:
     float round_corners;
     std::string font;
     int fontsize;
+
+    /**
+     * @returns The handle of `font` at `fontsize`, looked up again only when
+     *          either of them changes or the fonts are flushed.
+     */
+    const Font::Handle& get_font() const;
+
+    mutable Font::Handle font_handle;
   };
 
   struct ThemeSet
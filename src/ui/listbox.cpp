@@ -222,8 +222,8 @@ Listbox<T>::draw(DrawingContext& context) const
 
     context.draw_filled_rect(r, theme.bg_color, theme.bg_blend, m_layer);
     context.draw_text(std::get<0>(item), r.mid(), Renderer::TextAlign::CENTER,
-                      theme.font, theme.fontsize, theme.fg_color,
-                      theme.fg_blend, m_layer);
+                      theme.get_font(), theme.fg_color, theme.fg_blend,
+                      m_layer);
 
     i++;
   }
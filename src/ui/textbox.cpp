@@ -150,13 +150,10 @@ Textbox::draw(DrawingContext& context) const
   context.get_transform().clip(contents_rect);
   context.get_transform().move(Vector(m_scroll, 0.f));
 
-  // FIXME: The Font class should never have to be used directly, needs refactor
-  float w1 = Font::get_font(theme.font, theme.fontsize)
-                  .get_text_width(m_contents.substr(0, m_caret))
-                  + contents_rect.x1;
-  float w2 = Font::get_font(theme.font, theme.fontsize)
-                  .get_text_width(m_contents.substr(0, m_caret_2))
-                  + contents_rect.x1;
+  std::vector<float> offsets;
+  Renderer::get_caret_offsets(theme.get_font(), m_contents, offsets);
+  float w1 = offsets[m_caret] + contents_rect.x1;
+  float w2 = offsets[m_caret_2] + contents_rect.x1;
 
   Rect selection(w1, m_rect.y1, w2, m_rect.y2);
   selection.fix();
@@ -173,7 +170,7 @@ Textbox::draw(DrawingContext& context) const
 
   context.draw_text(m_contents,
                     (contents_rect.top_lft() + contents_rect.bot_lft()) / 2,
-                    Renderer::TextAlign::MID_LEFT, theme.font, theme.fontsize,
+                    Renderer::TextAlign::MID_LEFT, theme.get_font(),
                     theme.fg_color, theme.fg_blend, m_layer);
 
   context.pop_transform();
@@ -261,8 +258,9 @@ Textbox::adjust_scroll()
   const auto& theme = get_current_theme();
   float w = m_rect.width() - theme.left.padding - theme.right.padding;
 
-  float scroll = Font::get_font(theme.font, theme.fontsize)
-                                 .get_text_width(m_contents.substr(0, m_caret));
+  std::vector<float> offsets;
+  Renderer::get_caret_offsets(theme.get_font(), m_contents, offsets);
+  float scroll = offsets[m_caret];
 
   m_scroll = Math::clamp(scroll - w, scroll, m_scroll);
 }
@@ -273,17 +271,8 @@ Textbox::get_hit_point(const Vector& p)
   const auto& theme = get_current_theme();
   float x = p.x - m_rect.x1 - theme.left.padding + m_scroll;
 
-  int pos = 0;
-  float dist = x;
-  float newdist = 0.f;
+  std::vector<float> offsets;
+  Renderer::get_caret_offsets(theme.get_font(), m_contents, offsets);
 
-  while (pos < static_cast<int>(m_contents.size()) &&
-          (newdist = std::abs(Font::get_font(theme.font, theme.fontsize)
-          .get_text_width(m_contents.substr(0, pos + 1)) - x)) < dist)
-  {
-    dist = newdist;
-    pos++;
-  }
-
-  return pos;
+  return static_cast<int>(Font::get_caret_at(offsets, x));
 }
@@ -0,0 +1,277 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "util/archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "make_unique.hpp"
+
+#include "SDL.h"
+
+// Layout, in native byte order:
+//   "HPAK", uint32 version, uint32 entry count
+//   entry count * { uint32 path offset, uint32 path length,
+//                   uint64 data offset, uint64 data size }
+//   paths, concatenated, in the same order as the entries
+//   data, each file aligned on DATA_ALIGNMENT bytes
+// Entries are sorted by path, bytewise. Offsets are from the start of the file.
+
+namespace {
+
+const char MAGIC[4] = { 'H', 'P', 'A', 'K' };
+const size_t DATA_ALIGNMENT = 16;
+const size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+const size_t ENTRY_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+template<typename T>
+void
+write(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+T
+read(const uint8_t* data)
+{
+  // The index isn't aligned for 64-bit reads
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+size_t
+align(size_t offset)
+{
+  return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+int
+compare_path(const char* path, size_t length, const std::string& other)
+{
+  int result = std::memcmp(path, other.data(), std::min(length, other.size()));
+
+  if (result != 0)
+    return result;
+
+  return length < other.size() ? -1 : (length > other.size() ? 1 : 0);
+}
+
+} // namespace
+
+const uint32_t Archive::VERSION = 1;
+std::vector<Archive::Mount> Archive::s_mounts;
+std::mutex Archive::s_mounts_mutex;
+
+void
+Archive::create(const std::string& file,
+                const std::map<std::string, std::string>& files)
+{
+  std::ofstream out(file, std::ios::binary);
+
+  if (!out)
+    throw std::runtime_error("Could not open archive for writing: " + file);
+
+  size_t paths_size = 0;
+  for (const auto& entry : files)
+    paths_size += entry.first.size();
+
+  size_t offset = align(HEADER_SIZE + files.size() * ENTRY_SIZE + paths_size);
+  std::vector<uint64_t> offsets, sizes;
+
+  // std::map iterates in bytewise order, which is the order find() expects
+  for (const auto& entry : files)
+  {
+    std::ifstream in(entry.second, std::ios::binary | std::ios::ate);
+
+    if (!in)
+      throw std::runtime_error("Could not open file to pack: " + entry.second);
+
+    offsets.push_back(offset);
+    sizes.push_back(static_cast<uint64_t>(in.tellg()));
+    offset = align(offset + sizes.back());
+  }
+
+  out.write(MAGIC, sizeof(MAGIC));
+  write(out, VERSION);
+  write(out, static_cast<uint32_t>(files.size()));
+
+  uint32_t path_offset = 0;
+  size_t i = 0;
+  for (const auto& entry : files)
+  {
+    write(out, path_offset);
+    write(out, static_cast<uint32_t>(entry.first.size()));
+    write(out, offsets[i]);
+    write(out, sizes[i]);
+    path_offset += static_cast<uint32_t>(entry.first.size());
+    i++;
+  }
+
+  for (const auto& entry : files)
+  {
+    out.write(entry.first.data(),
+              static_cast<std::streamsize>(entry.first.size()));
+  }
+
+  i = 0;
+  for (const auto& entry : files)
+  {
+    std::vector<char> padding(offsets[i] - static_cast<size_t>(out.tellp()), 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+    std::ifstream in(entry.second, std::ios::binary);
+    if (sizes[i] > 0 && !(out << in.rdbuf()))
+      throw std::runtime_error("Could not pack file: " + entry.second);
+
+    i++;
+  }
+
+  if (!out)
+    throw std::runtime_error("Could not write archive: " + file);
+}
+
+void
+Archive::mount(const std::string& file, const std::string& directory)
+{
+  auto archive = std::make_unique<Archive>(file);
+
+  std::string dir = directory;
+  while (!dir.empty() && dir.back() == '/')
+    dir.pop_back();
+
+  std::lock_guard<std::mutex> lock(s_mounts_mutex);
+  s_mounts.push_back({ dir, std::move(archive) });
+}
+
+void
+Archive::unmount_all()
+{
+  std::lock_guard<std::mutex> lock(s_mounts_mutex);
+  s_mounts.clear();
+}
+
+SDL_RWops*
+Archive::open_rw(const std::string& path)
+{
+  const uint8_t* data;
+  size_t size;
+
+  if (find_mounted(path, data, size))
+    return SDL_RWFromConstMem(data, static_cast<int>(size));
+
+  return SDL_RWFromFile(path.c_str(), "rb");
+}
+
+bool
+Archive::find_mounted(const std::string& path, const uint8_t*& data,
+                      size_t& size)
+{
+  std::lock_guard<std::mutex> lock(s_mounts_mutex);
+
+  for (auto it = s_mounts.rbegin(); it != s_mounts.rend(); ++it)
+  {
+    const std::string& dir = it->directory;
+    size_t start = 0;
+
+    if (!dir.empty())
+    {
+      if (path.size() <= dir.size() || path.compare(0, dir.size(), dir) != 0
+          || path[dir.size()] != '/')
+        continue;
+
+      start = dir.size() + 1;
+    }
+
+    if (it->archive->find(path.substr(start), data, size))
+      return true;
+  }
+
+  return false;
+}
+
+Archive::Archive(const std::string& file) :
+  m_file(file),
+  m_entries()
+{
+  const uint8_t* data = m_file.get_data();
+  const size_t size = m_file.get_size();
+
+  if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    throw std::runtime_error("Not an asset archive: " + file);
+
+  uint32_t version = read<uint32_t>(data + sizeof(MAGIC));
+  if (version != VERSION)
+  {
+    throw std::runtime_error("Unsupported asset archive version "
+                             + std::to_string(version) + ": " + file);
+  }
+
+  uint32_t count = read<uint32_t>(data + sizeof(MAGIC) + sizeof(uint32_t));
+  if (count > (size - HEADER_SIZE) / ENTRY_SIZE)
+    throw std::runtime_error("Truncated asset archive: " + file);
+
+  const size_t paths_start = HEADER_SIZE + count * ENTRY_SIZE;
+  m_entries.reserve(count);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint8_t* entry = data + HEADER_SIZE + i * ENTRY_SIZE;
+    uint32_t path_offset = read<uint32_t>(entry);
+    uint32_t path_length = read<uint32_t>(entry + 4);
+    uint64_t data_offset = read<uint64_t>(entry + 8);
+    uint64_t data_size = read<uint64_t>(entry + 16);
+
+    if (paths_start + path_offset + path_length > size
+        || data_offset > size || data_size > size - data_offset)
+    {
+      throw std::runtime_error("Truncated asset archive: " + file);
+    }
+
+    m_entries.push_back({
+      reinterpret_cast<const char*>(data + paths_start + path_offset),
+      path_length,
+      data + data_offset,
+      static_cast<size_t>(data_size)
+    });
+  }
+}
+
+bool
+Archive::find(const std::string& path, const uint8_t*& data,
+              size_t& size) const
+{
+  auto it = std::lower_bound(m_entries.begin(), m_entries.end(), path,
+                             [](const Entry& entry, const std::string& p) {
+    return compare_path(entry.path, entry.path_length, p) < 0;
+  });
+
+  if (it == m_entries.end() || compare_path(it->path, it->path_length, path))
+    return false;
+
+  data = it->data;
+  size = it->size;
+  return true;
+}
+
+size_t
+Archive::get_entry_count() const
+{
+  return m_entries.size();
+}
@@ -0,0 +1,121 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_UTIL_ARCHIVE_HPP
+#define _HEADER_HARBOR_UTIL_ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.hpp"
+
+struct SDL_RWops;
+
+/**
+ * Packed, memory-mapped set of asset files, built with `harbor_pack`. Files
+ * are looked up by their path relative to the packed directory, with '/' as
+ * the separator.
+ *
+ * Archives are usually mounted over a directory; open_rw() then serves files
+ * under that directory straight from the mapped archive.
+ */
+class Archive final
+{
+public:
+  static const uint32_t VERSION;
+
+  /**
+   * Packs @p files into a new archive.
+   *
+   * @param files Maps each path in the archive to the file to copy there.
+   */
+  static void create(const std::string& file,
+                     const std::map<std::string, std::string>& files);
+
+  /**
+   * Mounts an archive over @p directory: paths under it are looked up in the
+   * archive first. Archives mounted last take precedence.
+   */
+  static void mount(const std::string& file, const std::string& directory);
+
+  /**
+   * Unmounts all archives. Data opened from them, like fonts which read their
+   * file lazily, must have been released first.
+   */
+  static void unmount_all();
+
+  /**
+   * Opens @p path from the mounted archives, without copying it, or from the
+   * disk if no archive has it. Safe to call from any thread.
+   *
+   * @returns The stream, or nullptr with the SDL error set.
+   */
+  static SDL_RWops* open_rw(const std::string& path);
+
+  /**
+   * Looks @p path up in the mounted archives. The contents stay valid until
+   * the archives are unmounted.
+   *
+   * @returns Whether a mounted archive has @p path.
+   */
+  static bool find_mounted(const std::string& path, const uint8_t*& data,
+                           size_t& size);
+
+public:
+  Archive(const std::string& file);
+
+  /**
+   * @returns Whether the archive has @p path. If so, @p data and @p size are
+   *          set to its contents, which live as long as the archive.
+   */
+  bool find(const std::string& path, const uint8_t*& data, size_t& size) const;
+
+  size_t get_entry_count() const;
+
+private:
+  struct Entry
+  {
+    const char* path;
+    size_t path_length;
+    const uint8_t* data;
+    size_t size;
+  };
+
+  struct Mount
+  {
+    std::string directory;
+    std::unique_ptr<Archive> archive;
+  };
+
+private:
+  static std::vector<Mount> s_mounts;
+  static std::mutex s_mounts_mutex;
+
+private:
+  MappedFile m_file;
+  /** Sorted by path. */
+  std::vector<Entry> m_entries;
+
+private:
+  Archive(const Archive&) = delete;
+  Archive& operator=(const Archive&) = delete;
+};
+
+#endif
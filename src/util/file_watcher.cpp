@@ -0,0 +1,189 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "util/file_watcher.hpp"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/log.hpp"
+
+namespace {
+
+#ifdef __linux__
+// Editors either rewrite files or move a new version over them
+const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+/** How long the thread may take to notice it should stop, in ms. */
+const int STOP_LATENCY = 100;
+#endif
+
+} // namespace
+
+bool
+FileWatcher::is_supported()
+{
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+FileWatcher::FileWatcher(const std::string& directory) :
+  m_fd(-1),
+  m_watches(),
+  m_changes(),
+  m_mutex(),
+  m_running(true),
+  m_thread()
+{
+#ifdef __linux__
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (m_fd < 0)
+    throw std::runtime_error("Could not start watching files");
+
+  std::string dir = directory;
+  while (dir.size() > 1 && dir.back() == '/')
+    dir.pop_back();
+
+  try
+  {
+    add_watch(dir);
+  }
+  catch (...)
+  {
+    close(m_fd);
+    throw;
+  }
+
+  m_thread = std::thread(&FileWatcher::run, this);
+#else
+  (void) directory;
+  throw std::runtime_error("File watching isn't supported on this platform");
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+  m_running = false;
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+#ifdef __linux__
+  if (m_fd >= 0)
+    close(m_fd);
+#endif
+}
+
+std::vector<std::string>
+FileWatcher::poll_changes()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> changes(m_changes.begin(), m_changes.end());
+  m_changes.clear();
+  return changes;
+}
+
+void
+FileWatcher::add_watch(const std::string& directory)
+{
+#ifdef __linux__
+  int wd = inotify_add_watch(m_fd, directory.c_str(), WATCH_EVENTS);
+
+  if (wd < 0)
+    throw std::runtime_error("Could not watch directory: " + directory);
+
+  m_watches[wd] = directory;
+
+  DIR* handle = opendir(directory.c_str());
+  if (!handle)
+    return;
+
+  while (struct dirent* entry = readdir(handle))
+  {
+    std::string name = entry->d_name;
+    if (name == "." || name == "..")
+      continue;
+
+    std::string path = directory + "/" + name;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+      add_watch(path);
+  }
+
+  closedir(handle);
+#else
+  (void) directory;
+#endif
+}
+
+void
+FileWatcher::run()
+{
+#ifdef __linux__
+  alignas(struct inotify_event) char buffer[4096];
+
+  while (m_running)
+  {
+    struct pollfd fds = { m_fd, POLLIN, 0 };
+    if (poll(&fds, 1, STOP_LATENCY) <= 0)
+      continue;
+
+    ssize_t length;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+      for (char* p = buffer; p < buffer + length;)
+      {
+        auto* event = reinterpret_cast<struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + event->len;
+
+        auto watch = m_watches.find(event->wd);
+        if (watch == m_watches.end() || !event->len)
+          continue;
+
+        std::string path = watch->second + "/" + event->name;
+
+        if (event->mask & IN_ISDIR)
+        {
+          // New directories, and those moved in, are watched as well
+          try
+          {
+            add_watch(path);
+          }
+          catch (const std::exception& e)
+          {
+            log_warn << e.what() << std::endl;
+          }
+        }
+        else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_changes.insert(path);
+        }
+      }
+    }
+  }
+#endif
+}
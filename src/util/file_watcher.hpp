@@ -0,0 +1,65 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_UTIL_FILEWATCHER_HPP
+#define _HEADER_HARBOR_UTIL_FILEWATCHER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Watches a directory tree for files being written, on a background thread.
+ * Only supported on Linux (inotify); see is_supported().
+ */
+class FileWatcher final
+{
+public:
+  static bool is_supported();
+
+public:
+  /** Starts watching @p directory and its subdirectories. */
+  FileWatcher(const std::string& directory);
+  ~FileWatcher();
+
+  /**
+   * @returns The files written to since the last call, each listed once, as
+   *          the watched directory followed by their relative path.
+   */
+  std::vector<std::string> poll_changes();
+
+private:
+  void add_watch(const std::string& directory);
+  void run();
+
+private:
+  int m_fd;
+  /** Watched directories, by watch descriptor. Only used by the thread. */
+  std::unordered_map<int, std::string> m_watches;
+  std::set<std::string> m_changes;
+  std::mutex m_mutex;
+  std::atomic<bool> m_running;
+  std::thread m_thread;
+
+private:
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+};
+
+#endif
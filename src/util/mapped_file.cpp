@@ -0,0 +1,107 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "util/mapped_file.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(EMSCRIPTEN)
+#define HARBOR_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define HARBOR_MMAP 0
+#endif
+
+MappedFile::MappedFile(const std::string& file) :
+  m_data(nullptr),
+  m_size(0),
+  m_mapped(false),
+  m_buffer()
+{
+#if HARBOR_MMAP
+  int fd = open(file.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    throw std::runtime_error("Could not open file: " + file);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    throw std::runtime_error("Could not stat file: " + file);
+  }
+
+  m_size = static_cast<size_t>(info.st_size);
+
+  // Empty files can't be mapped, but there is nothing to read either
+  if (m_size > 0)
+  {
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("Could not map file: " + file);
+    }
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_mapped = true;
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+#else
+  std::ifstream in(file, std::ios::binary | std::ios::ate);
+
+  if (!in)
+    throw std::runtime_error("Could not open file: " + file);
+
+  m_buffer.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+
+  if (!in.read(reinterpret_cast<char*>(m_buffer.data()),
+               static_cast<std::streamsize>(m_buffer.size())))
+  {
+    throw std::runtime_error("Could not read file: " + file);
+  }
+
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if HARBOR_MMAP
+  if (m_mapped)
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+const uint8_t*
+MappedFile::get_data() const
+{
+  return m_data;
+}
+
+size_t
+MappedFile::get_size() const
+{
+  return m_size;
+}
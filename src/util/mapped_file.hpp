@@ -0,0 +1,49 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_UTIL_MAPPEDFILE_HPP
+#define _HEADER_HARBOR_UTIL_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Read-only view of a whole file. The file is memory-mapped where the platform
+ * supports it, and read into memory otherwise.
+ */
+class MappedFile final
+{
+public:
+  MappedFile(const std::string& file);
+  ~MappedFile();
+
+  const uint8_t* get_data() const;
+  size_t get_size() const;
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  bool m_mapped;
+  /** Contents of the file, when it couldn't be mapped. */
+  std::vector<uint8_t> m_buffer;
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+};
+
+#endif
@@ -0,0 +1,96 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "util/stage_timer.hpp"
+
+#include <iomanip>
+
+StageTimer::StageTimer() :
+  m_stages(),
+  m_stage_start(),
+  m_running(false)
+{
+}
+
+void
+StageTimer::begin(const std::string& name)
+{
+  end();
+
+  m_stages.push_back({ name, 0.f, false });
+  m_stage_start = std::chrono::steady_clock::now();
+  m_running = true;
+}
+
+void
+StageTimer::end()
+{
+  if (!m_running)
+    return;
+
+  std::chrono::duration<float, std::milli> elapsed =
+                              std::chrono::steady_clock::now() - m_stage_start;
+
+  // Parallel stages may have been added since this one began
+  for (auto it = m_stages.rbegin(); it != m_stages.rend(); ++it)
+  {
+    if (!it->parallel)
+    {
+      it->time = elapsed.count();
+      break;
+    }
+  }
+
+  m_running = false;
+}
+
+void
+StageTimer::add_parallel(const std::string& name, float ms)
+{
+  m_stages.push_back({ name, ms, true });
+}
+
+const std::vector<StageTimer::Stage>&
+StageTimer::get_stages() const
+{
+  return m_stages;
+}
+
+float
+StageTimer::get_total() const
+{
+  float total = 0.f;
+
+  for (const auto& stage : m_stages)
+    if (!stage.parallel)
+      total += stage.time;
+
+  return total;
+}
+
+void
+StageTimer::print(std::ostream& out) const
+{
+  for (const auto& stage : m_stages)
+  {
+    out << "  " << std::left << std::setw(32) << stage.name << std::right
+        << std::fixed << std::setprecision(2) << std::setw(9) << stage.time
+        << " ms" << (stage.parallel ? " (in parallel)" : "") << std::endl;
+  }
+
+  out << "  " << std::left << std::setw(32) << "total" << std::right
+      << std::fixed << std::setprecision(2) << std::setw(9) << get_total()
+      << " ms" << std::endl;
+}
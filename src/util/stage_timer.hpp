@@ -0,0 +1,66 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_UTIL_STAGETIMER_HPP
+#define _HEADER_HARBOR_UTIL_STAGETIMER_HPP
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Measures how long each stage of a sequence (e.g. startup) takes, for a
+ * timing breakdown.
+ */
+class StageTimer final
+{
+public:
+  struct Stage
+  {
+    std::string name;
+    /** In milliseconds. */
+    float time;
+    /**
+     * Whether the time was spent alongside the sequence, e.g. on worker
+     * threads. Such stages don't count towards the total.
+     */
+    bool parallel;
+  };
+
+public:
+  StageTimer();
+
+  /** Ends the current stage, if any, and starts @p name. */
+  void begin(const std::string& name);
+  void end();
+
+  /** Records work measured elsewhere, like the time spent by workers. */
+  void add_parallel(const std::string& name, float ms);
+
+  const std::vector<Stage>& get_stages() const;
+  /** @returns The time spent in the sequential stages, in milliseconds. */
+  float get_total() const;
+
+  /** Prints one stage per line, then the total. */
+  void print(std::ostream& out) const;
+
+private:
+  std::vector<Stage> m_stages;
+  std::chrono::steady_clock::time_point m_stage_start;
+  bool m_running;
+};
+
+#endif
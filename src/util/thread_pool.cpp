@@ -0,0 +1,117 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool&
+ThreadPool::get_default()
+{
+  // Keep a core for the main thread
+  static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  return pool;
+}
+
+ThreadPool::ThreadPool(size_t threads) :
+  m_threads(),
+  m_queue(),
+  m_mutex(),
+  m_wake(),
+  m_idle(),
+  m_running(0),
+  m_stopping(false)
+{
+  for (size_t i = 0; i < threads; i++)
+    m_threads.emplace_back(&ThreadPool::run_worker, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+
+  m_wake.notify_all();
+
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+void
+ThreadPool::wait_idle()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_queue.empty() && m_running == 0; });
+}
+
+size_t
+ThreadPool::get_thread_count() const
+{
+  return m_threads.size();
+}
+
+size_t
+ThreadPool::get_queued_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_queue.size();
+}
+
+void
+ThreadPool::enqueue(std::function<void()> job)
+{
+  if (m_threads.empty())
+  {
+    job();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(job));
+  }
+
+  m_wake.notify_one();
+}
+
+void
+ThreadPool::run_worker()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true)
+  {
+    m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+
+    if (m_queue.empty())
+      return;
+
+    auto job = std::move(m_queue.front());
+    m_queue.pop_front();
+    m_running++;
+
+    lock.unlock();
+    job();
+    lock.lock();
+
+    m_running--;
+
+    if (m_queue.empty() && m_running == 0)
+      m_idle.notify_all();
+  }
+}
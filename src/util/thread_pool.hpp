@@ -0,0 +1,89 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_UTIL_THREADPOOL_HPP
+#define _HEADER_HARBOR_UTIL_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running queued jobs in FIFO order. A pool with
+ * no threads runs jobs immediately, on the thread submitting them.
+ */
+class ThreadPool final
+{
+public:
+  /** Pool shared by the engine's subsystems, created on first use. */
+  static ThreadPool& get_default();
+
+public:
+  /** @param threads Number of workers; 0 to run jobs synchronously. */
+  ThreadPool(size_t threads);
+  /** Finishes the queued jobs, then joins the workers. */
+  ~ThreadPool();
+
+  /**
+   * Queues @p job to run on a worker.
+   *
+   * @returns A future for the result of the job, or its exception.
+   */
+  template<typename F>
+  auto submit(F job) -> std::future<decltype(job())>
+  {
+    typedef decltype(job()) Result;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+    std::future<Result> result = task->get_future();
+
+    enqueue([task] { (*task)(); });
+
+    return result;
+  }
+
+  /** Blocks until the queue is empty and no job is running. */
+  void wait_idle();
+
+  size_t get_thread_count() const;
+  /** @returns The number of jobs waiting for a worker. */
+  size_t get_queued_count() const;
+
+private:
+  void enqueue(std::function<void()> job);
+  void run_worker();
+
+private:
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_queue;
+  mutable std::mutex m_mutex;
+  /** Signaled when jobs are queued or the pool is stopping. */
+  std::condition_variable m_wake;
+  /** Signaled when the pool becomes idle. */
+  std::condition_variable m_idle;
+  size_t m_running;
+  bool m_stopping;
+
+private:
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+};
+
+#endif
@@ -0,0 +1,50 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/async_texture.hpp"
+
+AsyncTexture::AsyncTexture(const std::string& file,
+                           const std::shared_ptr<Texture>& placeholder) :
+  m_file(file),
+  m_texture(),
+  m_placeholder(placeholder),
+  m_failed(false)
+{
+}
+
+bool
+AsyncTexture::is_ready() const
+{
+  return m_texture != nullptr;
+}
+
+bool
+AsyncTexture::has_failed() const
+{
+  return m_failed;
+}
+
+const std::shared_ptr<Texture>&
+AsyncTexture::get() const
+{
+  return m_texture ? m_texture : m_placeholder;
+}
+
+const std::string&
+AsyncTexture::get_file() const
+{
+  return m_file;
+}
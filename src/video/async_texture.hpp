@@ -0,0 +1,61 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_ASYNCTEXTURE_HPP
+#define _HEADER_HARBOR_VIDEO_ASYNCTEXTURE_HPP
+
+#include <memory>
+#include <string>
+
+class Texture;
+
+/**
+ * Handle to a texture loaded in the background by Window::load_texture_async().
+ * It can be drawn right away: until the texture is uploaded, the window's
+ * placeholder texture stands in for it.
+ */
+class AsyncTexture final
+{
+  friend class Window;
+
+public:
+  AsyncTexture(const std::string& file,
+               const std::shared_ptr<Texture>& placeholder);
+
+  /** @returns Whether the texture was loaded and uploaded. */
+  bool is_ready() const;
+  /** @returns Whether loading failed; the placeholder then stays in place. */
+  bool has_failed() const;
+
+  /**
+   * @returns The texture once ready, else the placeholder, or nullptr if
+   *          the window has none.
+   */
+  const std::shared_ptr<Texture>& get() const;
+  const std::string& get_file() const;
+
+private:
+  std::string m_file;
+  std::shared_ptr<Texture> m_texture;
+  std::shared_ptr<Texture> m_placeholder;
+  bool m_failed;
+
+private:
+  AsyncTexture(const AsyncTexture&) = delete;
+  AsyncTexture& operator=(const AsyncTexture&) = delete;
+};
+
+#endif
@@ -86,8 +86,7 @@ DrawingContext::TextureRequest::render(Renderer& renderer) const
 void
 DrawingContext::TextRequest::render(Renderer& renderer) const
 {
-  renderer.draw_text(m_text, m_pos, m_clip, m_align, m_font, m_size, m_color,
-                     m_blend);
+  renderer.draw_text(m_text, m_pos, m_clip, m_align, m_font, m_color, m_blend);
 }
 
 void
@@ -96,6 +95,12 @@ DrawingContext::LineRequest::render(Renderer& renderer) const
   renderer.draw_line(m_p1, m_p2, m_color, m_blend);
 }
 
+void
+DrawingContext::LinesRequest::render(Renderer& renderer) const
+{
+  renderer.draw_lines(m_points, m_color, m_blend);
+}
+
 DrawingContext::DrawingContext(Renderer& renderer) :
   m_renderer(renderer)
 {
@@ -172,20 +177,45 @@ DrawingContext::draw_texture(const std::shared_ptr<Texture>& texture,
   m_requests[layer].push_back(std::move(req));
 }
 
+void
+DrawingContext::draw_texture(const AsyncTexture& texture, const Rect& srcrect,
+                             const Rect& dstrect, float angle,
+                             const Color& color, const Renderer::Blend& blend,
+                             int layer)
+{
+  const auto& current = texture.get();
+
+  if (!current)
+    return;
+
+  // The placeholder doesn't share the coordinates of the real texture
+  Rect src = texture.is_ready() ? srcrect : Rect(Vector(), current->get_size());
+  draw_texture(current, src, dstrect, angle, color, blend, layer);
+}
+
 void
 DrawingContext::draw_text(const std::string& text, const Vector& pos,
                           Renderer::TextAlign align,
                           const std::string& fontfile, int size,
                           const Color& color, const Renderer::Blend& blend,
                           int layer)
+{
+  draw_text(text, pos, align, Font::get_handle(fontfile, size), color, blend,
+            layer);
+}
+
+void
+DrawingContext::draw_text(const std::string& text, const Vector& pos,
+                          Renderer::TextAlign align, const Font::Handle& font,
+                          const Color& color, const Renderer::Blend& blend,
+                          int layer)
 {
   auto req = std::make_unique<TextRequest>();
   req->m_color = color;
   req->m_blend = blend;
   req->m_align = align;
-  req->m_font = fontfile;
+  req->m_font = font;
   req->m_pos = pos - get_transform().m_offset;
-  req->m_size = size;
   req->m_text = text;
   req->m_clip = get_transform().m_clip;
 
@@ -210,20 +240,61 @@ DrawingContext::draw_line(const Vector& p1, const Vector& p2,
   m_requests[layer].push_back(std::move(req));
 }
 
+void
+DrawingContext::draw_lines(const std::vector<Vector>& points,
+                           const Color& color, const Renderer::Blend& blend,
+                           int layer)
+{
+  auto req = std::make_unique<LinesRequest>();
+  req->m_color = color;
+  req->m_blend = blend;
+  req->m_points.reserve(points.size() - points.size() % 2);
+
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+    push_segment(req->m_points, points[i], points[i + 1]);
+
+  push_lines_request(std::move(req), layer);
+}
+
+void
+DrawingContext::draw_polyline(const std::vector<Vector>& points,
+                              const Color& color, const Renderer::Blend& blend,
+                              int layer, bool closed)
+{
+  auto req = std::make_unique<LinesRequest>();
+  req->m_color = color;
+  req->m_blend = blend;
+  req->m_points.reserve(points.size() * 2);
+
+  for (size_t i = 1; i < points.size(); i++)
+    push_segment(req->m_points, points[i - 1], points[i]);
+
+  if (closed && points.size() > 2)
+    push_segment(req->m_points, points.back(), points.front());
+
+  push_lines_request(std::move(req), layer);
+}
+
 void
 DrawingContext::render(Texture* texture) const
 {
-  m_renderer.start_draw(texture);
+  render(m_renderer, texture);
+}
+
+void
+DrawingContext::render(Renderer& renderer, Texture* texture) const
+{
+  renderer.start_draw(texture);
 
   for (const auto& reqs : m_requests)
   {
     for (const auto& req : reqs.second)
     {
-      req->render(m_renderer);
+      req->render(renderer);
     }
   }
 
-  m_renderer.end_draw();
+  renderer.end_draw();
 }
 
 void
@@ -255,3 +326,35 @@ DrawingContext::get_renderer() const
 {
   return m_renderer;
 }
+
+void
+DrawingContext::push_segment(std::vector<Vector>& out, const Vector& p1,
+                             const Vector& p2)
+{
+  const auto& transform = get_transform();
+  Vector t1 = p1 * transform.m_scale - transform.m_offset;
+  Vector t2 = p2 * transform.m_scale - transform.m_offset;
+
+  auto pts = transform.m_clip.clip_line(t1, t2);
+
+  // Rect::clip_line() returns a pair of null vectors for invisible segments
+  if (pts.first == Vector() && pts.second == Vector() &&
+      !(t1 == Vector() && t2 == Vector()))
+    return;
+
+  out.push_back(pts.first);
+  out.push_back(pts.second);
+}
+
+void
+DrawingContext::push_lines_request(std::unique_ptr<LinesRequest> req,
+                                   int layer)
+{
+  if (req->m_points.empty())
+  {
+    log_info << "Not rendering empty lines" << std::endl;
+    return;
+  }
+
+  m_requests[layer].push_back(std::move(req));
+}
@@ -21,6 +21,7 @@
 #include <map>
 #include <memory>
 
+#include "video/async_texture.hpp"
 #include "video/renderer.hpp"
 #include "util/color.hpp"
 #include "util/rect.hpp"
@@ -118,8 +119,7 @@ public:
 
   public:
     std::string m_text;
-    std::string m_font;
-    int m_size;
+    Font::Handle m_font;
     Vector m_pos;
     Renderer::TextAlign m_align;
     Rect m_clip;
@@ -141,6 +141,22 @@ public:
     Vector m_p2;
   };
 
+  /**
+   * Holds the data to perform a batched Lines request on a Renderer.
+   */
+  class LinesRequest final :
+    public DrawRequest
+  {
+  public:
+    LinesRequest() = default;
+
+    virtual void render(Renderer& renderer) const override;
+
+  public:
+    /** Segment endpoints, in pairs, already transformed and clipped. */
+    std::vector<Vector> m_points;
+  };
+
 public:
   DrawingContext() = delete;
   DrawingContext(Renderer& renderer);
@@ -153,13 +169,45 @@ public:
   void draw_texture(const std::shared_ptr<Texture>& texture, const Rect& srcrect,
                     const Rect& dstrect, float angle, const Color& color,
                     const Renderer::Blend& blend, int layer);
+  /**
+   * Draws the texture if it is ready. Until then, draws the whole placeholder
+   * in @p dstrect, or nothing if there is no placeholder.
+   */
+  void draw_texture(const AsyncTexture& texture, const Rect& srcrect,
+                    const Rect& dstrect, float angle, const Color& color,
+                    const Renderer::Blend& blend, int layer);
+  /**
+   * Looks the font up by name on every call; code that draws every frame
+   * should keep a Font::Handle and use the overload below.
+   */
   void draw_text(const std::string& text, const Vector& pos,
                  Renderer::TextAlign align, const std::string& fontfile,
                  int size, const Color& color, const Renderer::Blend& blend,
                  int layer);
+  void draw_text(const std::string& text, const Vector& pos,
+                 Renderer::TextAlign align, const Font::Handle& font,
+                 const Color& color, const Renderer::Blend& blend, int layer);
   void draw_line(const Vector& p1, const Vector& p2, const Color& color,
                  const Renderer::Blend& blend, int layer);
+  /**
+   * Draws independent segments; @p points holds their endpoints in pairs. All
+   * segments are recorded as a single request.
+   */
+  void draw_lines(const std::vector<Vector>& points, const Color& color,
+                  const Renderer::Blend& blend, int layer);
+  /**
+   * Draws connected segments going through all @p points, in order. If
+   * @p closed is true, the last point is also joined back to the first one.
+   */
+  void draw_polyline(const std::vector<Vector>& points, const Color& color,
+                     const Renderer::Blend& blend, int layer,
+                     bool closed = false);
   void render(Texture* texture = nullptr) const;
+  /**
+   * Plays the requests on @p renderer instead of the context's own renderer,
+   * for example to capture them with a FrameCapture.
+   */
+  void render(Renderer& renderer, Texture* texture = nullptr) const;
   void clear();
   void push_transform();
   void pop_transform();
@@ -167,6 +215,12 @@ public:
   Transform& get_transform();
   Renderer& get_renderer() const;
 
+private:
+  /** Transforms and clips a segment, appending it to @p out if visible. */
+  void push_segment(std::vector<Vector>& out, const Vector& p1,
+                    const Vector& p2);
+  void push_lines_request(std::unique_ptr<LinesRequest> req, int layer);
+
 private:
   Renderer& m_renderer;
   std::map<int, std::vector<std::unique_ptr<DrawRequest>>> m_requests;
@@ -17,76 +17,327 @@
 #include "video/font.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
 #include "make_unique.hpp"
 
+#include "util/archive.hpp"
+#include "util/log.hpp"
+#include "util/thread_pool.hpp"
+
+Font::Handle::Handle() :
+  m_index(0),
+  m_generation(0)
+{
+}
+
+Font::Handle::Handle(uint32_t index, uint32_t generation) :
+  m_index(index),
+  m_generation(generation)
+{
+}
+
+bool
+Font::Handle::is_valid() const
+{
+  return m_generation == s_generation && m_index < s_fonts.size();
+}
+
+const std::string&
+Font::Handle::get_file() const
+{
+  return get_entry(*this).file;
+}
+
+int
+Font::Handle::get_size() const
+{
+  return get_entry(*this).size;
+}
+
+bool
+Font::Handle::is_sdf() const
+{
+  return get_entry(*this).sdf;
+}
+
+bool
+Font::Handle::operator==(const Handle& handle) const
+{
+  return m_index == handle.m_index && m_generation == handle.m_generation;
+}
+
+bool
+Font::Handle::operator!=(const Handle& handle) const
+{
+  return !(*this == handle);
+}
+
 void
 Font::flush_fonts()
 {
+  // The entries the reloads are for are going away
+  for (auto& pending : s_pending_reloads)
+  {
+    try
+    {
+      close_font(pending.font.get());
+    }
+    catch (...)
+    {
+    }
+  }
+  s_pending_reloads.clear();
+
   s_fonts.clear();
+  s_indices.clear();
+  s_generation++;
 }
 
-Font&
-Font::get_font(const std::string& file, int size)
+bool
+Font::reload_fonts(const std::string& file)
 {
-  auto it = std::find_if(s_fonts.begin(), s_fonts.end(),
-                         [&file, size](const std::unique_ptr<Font>& font) {
-    return font->m_name == file && font->m_size == size;
-  });
+  auto indices = s_indices.find(file);
+
+  if (indices == s_indices.end())
+    return false;
 
-  if (it == s_fonts.end())
+  bool reloaded = false;
+  for (uint32_t index : indices->second)
   {
-    s_fonts.push_back(std::make_unique<Font>(file, size));
-    return **s_fonts.rbegin();
+    const Entry& entry = s_fonts[index];
+
+    if (!entry.font)
+      continue;
+
+    reloaded = true;
+
+    if (!s_rasterizer)
+    {
+      s_fonts[index].font.reset();
+      continue;
+    }
+
+    std::string file = entry.file;
+    int size = entry.size;
+    bool sdf = entry.sdf;
+
+    auto font = s_rasterizer->submit([file, size, sdf]() {
+      return std::make_unique<Font>(file, size, sdf);
+    });
+
+    s_pending_reloads.push_back({ index, std::move(font) });
   }
-  else
+
+  return reloaded;
+}
+
+void
+Font::finish_reloads()
+{
+  for (auto it = s_pending_reloads.begin(); it != s_pending_reloads.end();)
   {
-    return **it;
+    if (it->font.wait_for(std::chrono::seconds(0))
+          != std::future_status::ready)
+    {
+      ++it;
+      continue;
+    }
+
+    auto& entry = s_fonts[it->index];
+
+    try
+    {
+      std::unique_ptr<Font> font = it->font.get();
+      entry.font.swap(font);
+      close_font(std::move(font));
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Could not reload font '" << entry.file << "': "
+               << e.what() << std::endl;
+    }
+
+    it = s_pending_reloads.erase(it);
   }
 }
 
-std::vector<std::unique_ptr<Font>> Font::s_fonts;
+Font::Handle
+Font::get_handle(const std::string& file, int size, bool sdf)
+{
+  auto it = s_indices.find(file);
+  if (it != s_indices.end())
+    for (uint32_t index : it->second)
+      if (s_fonts[index].size == size && s_fonts[index].sdf == sdf)
+        return Handle(index, s_generation);
+
+  uint32_t source = static_cast<uint32_t>(s_fonts.size());
+
+  if (sdf && size != SDF_REFERENCE_SIZE)
+    source = get_handle(file, SDF_REFERENCE_SIZE, true).m_index;
+
+  uint32_t index = static_cast<uint32_t>(s_fonts.size());
+  s_fonts.push_back(Entry{ file, size, sdf, source, nullptr });
+  s_indices[file].push_back(index);
+
+  return Handle(index, s_generation);
+}
+
+Font&
+Font::get_font(const Handle& handle)
+{
+  auto& entry = s_fonts[get_entry(handle).source];
+
+  if (!entry.font)
+    entry.font = std::make_unique<Font>(entry.file, entry.size, entry.sdf);
+
+  return *entry.font;
+}
+
+Font&
+Font::get_font(const std::string& file, int size)
+{
+  return get_font(get_handle(file, size));
+}
+
+void
+Font::set_rasterizer(ThreadPool* pool)
+{
+  s_rasterizer = pool;
+}
+
+ThreadPool*
+Font::get_rasterizer()
+{
+  return s_rasterizer;
+}
+
+void
+Font::get_retired_ids(size_t& cursor, std::vector<unsigned>& ids)
+{
+  std::lock_guard<std::mutex> lock(s_retired_mutex);
+
+  ids.insert(ids.end(), s_retired_ids.begin() + cursor, s_retired_ids.end());
+  cursor = s_retired_ids.size();
+}
+
+void
+Font::close_font(std::unique_ptr<Font> font)
+{
+  if (!font || !s_rasterizer)
+    return;
+
+  // Lambdas can't own a unique_ptr in C++11
+  Font* closing = font.release();
+  s_rasterizer->submit([closing]() {
+    delete closing;
+  });
+}
+
+Font::Entry&
+Font::get_entry(const Handle& handle)
+{
+  if (!handle.is_valid())
+    throw std::runtime_error("Use of an invalid or flushed font handle");
+
+  return s_fonts[handle.m_index];
+}
+
+Font::Placeholder Font::s_default_placeholder = Font::Placeholder::SKIP;
+ThreadPool* Font::s_rasterizer = nullptr;
+std::vector<Font::PendingReload> Font::s_pending_reloads;
+std::vector<Font::Entry> Font::s_fonts;
+std::unordered_map<std::string, std::vector<uint32_t>> Font::s_indices;
+// Starts at 1 so that default-constructed handles are never valid
+uint32_t Font::s_generation = 1;
+std::atomic<unsigned> Font::s_next_id(0);
+std::vector<unsigned> Font::s_retired_ids;
+std::mutex Font::s_retired_mutex;
+const int Font::SDF_REFERENCE_SIZE = 48;
+const int Font::SDF_SPREAD = 6;
 
-Font::Font(const std::string& text, int size) :
+Font::Font(const std::string& text, int size, bool sdf) :
   m_name(text),
   m_size(size),
-  m_font(TTF_OpenFont(text.c_str(), size)),
-  m_text_surfaces()
+  m_sdf(sdf),
+  m_padding(sdf ? SDF_SPREAD : 0),
+  m_font(TTF_OpenFontRW(Archive::open_rw(text), 1, size)),
+  m_id(s_next_id++),
+  m_glyphs(),
+  m_kerning_enabled(false),
+  m_kerning(),
+  m_atlas(nullptr),
+  m_atlas_version(0),
+  m_atlas_x(0),
+  m_atlas_y(0),
+  m_atlas_shelf_h(0),
+  m_placeholder(s_default_placeholder),
+  m_worker_font(nullptr),
+  m_worker_mutex(),
+  m_ready_mutex(),
+  m_jobs_done(),
+  m_ready_glyphs(),
+  m_pending_jobs(0)
 {
   if (!m_font)
   {
     throw std::runtime_error("Could not open font '" + text + "': " +
                              std::string(TTF_GetError()));
   }
+
+  m_kerning_enabled = TTF_GetFontKerning(m_font) != 0;
 }
 
 Font::~Font()
 {
-  for (const auto& text_surface : m_text_surfaces)
-    SDL_FreeSurface(text_surface.second);
+  // Workers still hold a pointer to this font
+  {
+    std::unique_lock<std::mutex> lock(m_ready_mutex);
+    m_jobs_done.wait(lock, [this] { return m_pending_jobs == 0; });
+  }
+
+  for (const auto& ready : m_ready_glyphs)
+    if (ready.second)
+      SDL_FreeSurface(ready.second);
+
+  if (m_worker_font)
+    TTF_CloseFont(m_worker_font);
+
+  if (m_atlas)
+    SDL_FreeSurface(m_atlas);
 
   TTF_CloseFont(m_font);
+
+  std::lock_guard<std::mutex> lock(s_retired_mutex);
+  s_retired_ids.push_back(m_id);
 }
 
-SDL_Surface*
-Font::get_sdl_surface(const std::string& text)
+void
+Font::set_placeholder(Placeholder placeholder)
 {
-  auto it = m_text_surfaces.find(text);
-  if (it != m_text_surfaces.end())
-    return it->second;
+  m_placeholder = placeholder;
+}
 
-  SDL_Color white;
+Font::Placeholder
+Font::get_placeholder() const
+{
+  return m_placeholder;
+}
 
-  white.r = 255;
-  white.g = 255;
-  white.b = 255;
-#ifndef EMSCRIPTEN
-  white.a = 255;
-#endif
+bool
+Font::is_text_ready(const std::string& text)
+{
+  collect_glyphs();
+
+  bool ready = true;
 
-  SDL_Surface* surface = TTF_RenderText_Blended(m_font, text.c_str(), white);
-  m_text_surfaces[text] = surface;
-  return surface;
+  // Keep going after the first missing glyph so all of them get requested
+  for (char c : text)
+    ready = get_glyph(static_cast<unsigned char>(c)).loaded && ready;
+
+  return ready;
 }
 
 float
@@ -114,3 +365,453 @@ Font::get_text_size(const std::string& text) const
 
   return Size(static_cast<float>(w), static_cast<float>(h));
 }
+
+int
+Font::get_height() const
+{
+  return TTF_FontHeight(m_font);
+}
+
+int
+Font::get_line_skip() const
+{
+  return TTF_FontLineSkip(m_font);
+}
+
+Size
+Font::layout_text(const std::string& text, std::vector<GlyphQuad>& quads)
+{
+  quads.clear();
+  collect_glyphs();
+
+  const float height = static_cast<float>(TTF_FontHeight(m_font));
+  int pen = 0, right = 0;
+  unsigned char prev = 0;
+
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+
+    if (i > 0)
+      pen += get_kerning(prev, c);
+
+    const Glyph& glyph = get_glyph(c);
+
+    if (glyph.loaded && !glyph.blank)
+    {
+      GlyphQuad quad;
+      quad.srcrect = Rect(static_cast<float>(glyph.rect.x),
+                          static_cast<float>(glyph.rect.y),
+                          static_cast<float>(glyph.rect.x + glyph.rect.w),
+                          static_cast<float>(glyph.rect.y + glyph.rect.h));
+      // Padding around SDF images extends outside of the glyph's own box
+      const int x = pen + glyph.offset - m_padding;
+      quad.dstrect = Rect(static_cast<float>(x),
+                          static_cast<float>(-m_padding),
+                          static_cast<float>(x + glyph.rect.w),
+                          static_cast<float>(glyph.rect.h - m_padding));
+      quads.push_back(quad);
+    }
+
+    right = std::max(right, pen + glyph.offset + glyph.rect.w - 2 * m_padding);
+    pen += glyph.advance;
+    prev = c;
+  }
+
+  return Size(static_cast<float>(std::max(right, pen)), height);
+}
+
+void
+Font::get_caret_offsets(const std::string& text, std::vector<float>& offsets)
+{
+  offsets.resize(text.size() + 1);
+
+  int pen = 0;
+  unsigned char prev = 0;
+
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+
+    if (i > 0)
+      pen += get_kerning(prev, c);
+
+    offsets[i] = static_cast<float>(pen);
+    pen += get_glyph_metrics(c).advance;
+    prev = c;
+  }
+
+  offsets[text.size()] = static_cast<float>(pen);
+}
+
+size_t
+Font::get_caret_at(const std::vector<float>& offsets, float x)
+{
+  if (offsets.empty())
+    return 0;
+
+  auto it = std::upper_bound(offsets.begin(), offsets.end(), x);
+
+  if (it == offsets.begin())
+    return 0;
+
+  size_t i = static_cast<size_t>(it - offsets.begin());
+
+  if (it == offsets.end() || x - offsets[i - 1] <= offsets[i] - x)
+    i--;
+
+  // Zero-width characters share offsets; keep the caret before them
+  return static_cast<size_t>(std::lower_bound(offsets.begin(), offsets.end(),
+                                              offsets[i]) - offsets.begin());
+}
+
+SDL_Surface*
+Font::get_atlas() const
+{
+  return m_atlas;
+}
+
+unsigned
+Font::get_atlas_version() const
+{
+  return m_atlas_version;
+}
+
+unsigned
+Font::get_id() const
+{
+  return m_id;
+}
+
+int
+Font::get_size() const
+{
+  return m_size;
+}
+
+bool
+Font::is_sdf() const
+{
+  return m_sdf;
+}
+
+const Font::Glyph&
+Font::get_glyph_metrics(unsigned char c)
+{
+  Glyph& glyph = m_glyphs[c];
+
+  if (glyph.measured)
+    return glyph;
+
+  glyph.measured = true;
+  glyph.offset = 0;
+  glyph.advance = 0;
+
+  int minx, maxx, miny, maxy, advance;
+  if (TTF_GlyphMetrics(m_font, c, &minx, &maxx, &miny, &maxy, &advance) == 0)
+  {
+    glyph.advance = advance;
+    // TTF_RenderGlyph_Blended() shifts the image right by the part of the
+    // glyph that extends left of the pen, like TTF_RenderText_Blended() does
+    // for a whole string.
+    glyph.offset = std::min(minx, 0);
+  }
+
+  return glyph;
+}
+
+const Font::Glyph&
+Font::get_glyph(unsigned char c)
+{
+  Glyph& glyph = m_glyphs[c];
+
+  if (glyph.loaded || glyph.pending)
+    return glyph;
+
+  get_glyph_metrics(c);
+
+  if (!s_rasterizer)
+  {
+    place_glyph(glyph, rasterize_glyph(m_font, c));
+    return glyph;
+  }
+
+  if (!m_worker_font)
+  {
+    m_worker_font = TTF_OpenFontRW(Archive::open_rw(m_name), 1, m_size);
+
+    if (!m_worker_font)
+    {
+      throw std::runtime_error("Could not open font '" + m_name + "': " +
+                               std::string(TTF_GetError()));
+    }
+  }
+
+  glyph.pending = true;
+
+  {
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_pending_jobs++;
+  }
+
+  s_rasterizer->submit([this, c] {
+    SDL_Surface* image = nullptr;
+
+    try
+    {
+      std::lock_guard<std::mutex> lock(m_worker_mutex);
+      image = rasterize_glyph(m_worker_font, c);
+    }
+    catch (const std::exception& e)
+    {
+      // The glyph will be drawn as blank, like glyphs the font doesn't have
+      log_warn << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_ready_glyphs.emplace_back(c, image);
+    m_pending_jobs--;
+    m_jobs_done.notify_all();
+  });
+
+  return glyph;
+}
+
+SDL_Surface*
+Font::rasterize_glyph(TTF_Font* face, unsigned char c) const
+{
+  SDL_Color white;
+
+  white.r = 255;
+  white.g = 255;
+  white.b = 255;
+#ifndef EMSCRIPTEN
+  white.a = 255;
+#endif
+
+  SDL_Surface* image = TTF_RenderGlyph_Blended(face, c, white);
+
+  if (!image)
+    return nullptr;
+
+  SDL_Surface* converted = SDL_ConvertSurfaceFormat(image,
+                                                    SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(image);
+
+  if (!converted)
+  {
+    throw std::runtime_error("Could not convert glyph surface: "
+                             + std::string(SDL_GetError()));
+  }
+
+  // Blank glyphs take no room in the atlas and produce no quads
+  bool blank = true;
+
+  SDL_LockSurface(converted);
+  for (int y = 0; y < converted->h && blank; y++)
+  {
+    const Uint8* row = static_cast<const Uint8*>(converted->pixels)
+                       + y * converted->pitch;
+    for (int x = 0; x < converted->w; x++)
+    {
+      if (row[x * 4 + 3])
+      {
+        blank = false;
+        break;
+      }
+    }
+  }
+  SDL_UnlockSurface(converted);
+
+  if (blank)
+  {
+    SDL_FreeSurface(converted);
+    return nullptr;
+  }
+
+  if (m_sdf)
+  {
+    SDL_Surface* field = make_distance_field(converted);
+    SDL_FreeSurface(converted);
+    converted = field;
+  }
+
+  return converted;
+}
+
+void
+Font::place_glyph(Glyph& glyph, SDL_Surface* image)
+{
+  glyph.loaded = true;
+  glyph.pending = false;
+  glyph.blank = !image;
+  glyph.rect = SDL_Rect{ 0, 0, 0, 0 };
+
+  if (!image)
+    return;
+
+  if (!m_atlas || m_atlas_x + image->w > m_atlas->w)
+  {
+    if (m_atlas)
+    {
+      m_atlas_x = 0;
+      m_atlas_y += m_atlas_shelf_h;
+      m_atlas_shelf_h = 0;
+    }
+
+    grow_atlas(image->w, m_atlas_y + image->h);
+  }
+  else if (m_atlas_y + image->h > m_atlas->h)
+  {
+    grow_atlas(image->w, m_atlas_y + image->h);
+  }
+
+  glyph.rect = SDL_Rect{ m_atlas_x, m_atlas_y, image->w, image->h };
+  m_atlas_x += image->w;
+  m_atlas_shelf_h = std::max(m_atlas_shelf_h, image->h);
+
+  SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE);
+  SDL_BlitSurface(image, nullptr, m_atlas, &glyph.rect);
+  SDL_FreeSurface(image);
+
+  m_atlas_version++;
+}
+
+void
+Font::collect_glyphs()
+{
+  std::vector<std::pair<unsigned char, SDL_Surface*>> ready;
+
+  {
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    ready.swap(m_ready_glyphs);
+  }
+
+  for (const auto& glyph : ready)
+    place_glyph(m_glyphs[glyph.first], glyph.second);
+}
+
+SDL_Surface*
+Font::make_distance_field(SDL_Surface* image) const
+{
+  const int w = image->w + 2 * SDF_SPREAD;
+  const int h = image->h + 2 * SDF_SPREAD;
+  SDL_Surface* field = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32,
+                                                      SDL_PIXELFORMAT_RGBA32);
+
+  if (!field)
+  {
+    throw std::runtime_error("Could not create distance field surface: "
+                             + std::string(SDL_GetError()));
+  }
+
+  // Coverage of the padded image, thresholded at half opacity
+  std::vector<bool> inside(static_cast<size_t>(w * h), false);
+
+  SDL_LockSurface(image);
+  for (int y = 0; y < image->h; y++)
+  {
+    const Uint8* row = static_cast<const Uint8*>(image->pixels)
+                       + y * image->pitch;
+    for (int x = 0; x < image->w; x++)
+      inside[(y + SDF_SPREAD) * w + x + SDF_SPREAD] = row[x * 4 + 3] >= 128;
+  }
+  SDL_UnlockSurface(image);
+
+  // Glyphs are small and rasterized once, so a search of the neighbourhood of
+  // each pixel for the closest pixel on the other side of the edge will do.
+  const float spread = static_cast<float>(SDF_SPREAD);
+
+  SDL_LockSurface(field);
+  for (int y = 0; y < h; y++)
+  {
+    Uint8* row = static_cast<Uint8*>(field->pixels) + y * field->pitch;
+
+    for (int x = 0; x < w; x++)
+    {
+      const bool in = inside[y * w + x];
+      int best = (SDF_SPREAD + 1) * (SDF_SPREAD + 1);
+
+      for (int dy = -SDF_SPREAD; dy <= SDF_SPREAD; dy++)
+      {
+        if (y + dy < 0 || y + dy >= h)
+          continue;
+
+        for (int dx = -SDF_SPREAD; dx <= SDF_SPREAD; dx++)
+        {
+          if (x + dx < 0 || x + dx >= w || inside[(y + dy) * w + x + dx] == in)
+            continue;
+
+          best = std::min(best, dx * dx + dy * dy);
+        }
+      }
+
+      // The edge lies halfway between the two pixel centers
+      float distance = std::min(std::sqrt(static_cast<float>(best)) - .5f,
+                                spread);
+      float value = .5f + (in ? distance : -distance) / (2.f * spread);
+
+      row[x * 4 + 0] = 255;
+      row[x * 4 + 1] = 255;
+      row[x * 4 + 2] = 255;
+      row[x * 4 + 3] = static_cast<Uint8>(std::min(std::max(value, 0.f), 1.f)
+                                          * 255.f + .5f);
+    }
+  }
+  SDL_UnlockSurface(field);
+
+  return field;
+}
+
+int
+Font::get_kerning(unsigned char prev, unsigned char c)
+{
+  if (!m_kerning_enabled)
+    return 0;
+
+  uint16_t key = static_cast<uint16_t>(prev << 8 | c);
+  auto it = m_kerning.find(key);
+
+  if (it != m_kerning.end())
+    return it->second;
+
+  int kerning = TTF_GetFontKerningSizeGlyphs(m_font, prev, c);
+  m_kerning[key] = kerning;
+  return kerning;
+}
+
+void
+Font::grow_atlas(int min_width, int min_height)
+{
+  int width = m_atlas ? m_atlas->w : 256;
+  int height = m_atlas ? m_atlas->h : std::max(TTF_FontHeight(m_font), 1) * 4;
+
+  while (width < min_width)
+    width *= 2;
+  while (height < min_height)
+    height *= 2;
+
+  if (m_atlas && width == m_atlas->w && height == m_atlas->h)
+    return;
+
+  SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                      SDL_PIXELFORMAT_RGBA32);
+
+  if (!atlas)
+  {
+    throw std::runtime_error("Could not create glyph atlas: "
+                             + std::string(SDL_GetError()));
+  }
+
+  SDL_FillRect(atlas, nullptr, 0);
+
+  if (m_atlas)
+  {
+    SDL_SetSurfaceBlendMode(m_atlas, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(m_atlas, nullptr, atlas, nullptr);
+    SDL_FreeSurface(m_atlas);
+  }
+
+  m_atlas = atlas;
+  m_atlas_version++;
+}
@@ -17,6 +17,11 @@
 #ifndef _HEADER_HARBOR_VIDEO_FONT_HPP
 #define _HEADER_HARBOR_VIDEO_FONT_HPP
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <vector>
@@ -26,43 +31,326 @@
 
 #include "SDL_ttf.h"
 
+#include "util/rect.hpp"
 #include "util/size.hpp"
 
+class ThreadPool;
+
 /**
  * Video class to handle font files.
  */
 class Font final
 {
-  friend class Renderer;
+public:
+  /** Placement of a single glyph image from the atlas. */
+  struct GlyphQuad
+  {
+    /** Location of the glyph in the atlas. */
+    Rect srcrect;
+    /** Location of the glyph, relative to the top-left corner of the text. */
+    Rect dstrect;
+  };
+
+  /** What renderers draw while glyphs are rasterized in the background. */
+  enum class Placeholder
+  {
+    /** Draw the text without the glyphs that aren't ready yet. */
+    SKIP,
+    /**
+     * Keep drawing the last text that was completely ready at the same place,
+     * if any, until the new one is.
+     */
+    PREVIOUS
+  };
+
+  /**
+   * Small, copyable reference to a font in the registry, cheaper to look up
+   * than a (path, size) pair. Handles stay valid until flush_fonts().
+   */
+  class Handle final
+  {
+    friend class Font;
+
+  public:
+    /** Creates an invalid handle. */
+    Handle();
+
+    /** @returns false for default-constructed and flushed handles. */
+    bool is_valid() const;
+
+    /** @throws std::runtime_error if the handle isn't valid. */
+    const std::string& get_file() const;
+    /** @throws std::runtime_error if the handle isn't valid. */
+    int get_size() const;
+    /** @throws std::runtime_error if the handle isn't valid. */
+    bool is_sdf() const;
+
+    bool operator==(const Handle& handle) const;
+    bool operator!=(const Handle& handle) const;
+
+  private:
+    Handle(uint32_t index, uint32_t generation);
+
+  private:
+    uint32_t m_index;
+    uint32_t m_generation;
+  };
 
 public:
   static void flush_fonts();
+
+  /**
+   * Opens the fonts opened from @p file again. With a rasterizer, they are
+   * opened on it, and finish_reloads() puts them in place once they are
+   * ready; the old fonts are closed on it too, as closing waits for their
+   * glyphs. Without one, they are closed now and opened again on their next
+   * use. Their handles stay valid. Must not be called while drawing.
+   *
+   * @returns Whether any font was opened from @p file.
+   */
+  static bool reload_fonts(const std::string& file);
+
+  /**
+   * Puts the fonts opened again by reload_fonts() in place, if they are ready.
+   * Fonts that fail to open are kept as they were. Must not be called while
+   * drawing.
+   */
+  static void finish_reloads();
+
+  /**
+   * Registers the font if needed, without opening it yet.
+   *
+   * With @p sdf, all sizes of the file share a single font rasterized at
+   * SDF_REFERENCE_SIZE into a distance field atlas. get_font() then returns
+   * that shared font, and renderers scale its glyphs by
+   * `size / SDF_REFERENCE_SIZE`.
+   *
+   * @returns The handle to use with get_font(Handle) from now on.
+   */
+  static Handle get_handle(const std::string& file, int size,
+                           bool sdf = false);
+
+  /**
+   * Opens the font the first time it is requested.
+   *
+   * @throws std::runtime_error if the handle isn't valid or if the font can't
+   *         be opened.
+   */
+  static Font& get_font(const Handle& handle);
+
+  /** Same as `get_font(get_handle(file, size))`. */
   static Font& get_font(const std::string& file, int size);
 
+  /**
+   * Sets the pool rasterizing new glyphs in the background. With nullptr (the
+   * default), glyphs are rasterized on first use by the calling thread.
+   */
+  static void set_rasterizer(ThreadPool* pool);
+  static ThreadPool* get_rasterizer();
+
+  /**
+   * Appends to @p ids the IDs of the fonts destroyed since @p cursor, then
+   * moves @p cursor past them. Each caller keeps its own cursor, starting at
+   * 0, so that every renderer learns about every retired font once.
+   */
+  static void get_retired_ids(size_t& cursor, std::vector<unsigned>& ids);
+
+  /** Placeholder given to fonts when they are created. */
+  static Placeholder s_default_placeholder;
+
+  /** Size at which signed distance field fonts are rasterized. */
+  static const int SDF_REFERENCE_SIZE;
+  /**
+   * Distance, in pixels at the reference size, covered by the distance field
+   * on each side of glyph edges. Glyph images are padded by as much.
+   */
+  static const int SDF_SPREAD;
+
 private:
-  static std::vector<std::unique_ptr<Font>> s_fonts;
+  struct Entry
+  {
+    std::string file;
+    int size;
+    bool sdf;
+    /** Entry owning the font; SDF sizes share the reference size's one. */
+    uint32_t source;
+    std::unique_ptr<Font> font;
+  };
 
-public:
-  Font(const std::string& text, int size);
-  ~Font();
+  struct PendingReload
+  {
+    /** Index of the entry in s_fonts. */
+    uint32_t index;
+    std::future<std::unique_ptr<Font>> font;
+  };
 
 private:
-  SDL_Surface* get_sdl_surface(const std::string& text);
+  static Entry& get_entry(const Handle& handle);
+  /** Destroys @p font on the rasterizer, if there is one. */
+  static void close_font(std::unique_ptr<Font> font);
+
+private:
+  /** Registered fonts; handles index into it. */
+  static std::vector<Entry> s_fonts;
+  /** Indices of the fonts in s_fonts, by file. */
+  static std::unordered_map<std::string, std::vector<uint32_t>> s_indices;
+  /** Incremented by flush_fonts(), invalidating all handles. */
+  static uint32_t s_generation;
+  static ThreadPool* s_rasterizer;
+  static std::vector<PendingReload> s_pending_reloads;
 
 public:
+  Font(const std::string& text, int size, bool sdf = false);
+  ~Font();
+
+  void set_placeholder(Placeholder placeholder);
+  Placeholder get_placeholder() const;
+
+  /**
+   * Requests the glyphs of @p text that aren't rasterized yet.
+   *
+   * @returns Whether all of them are in the atlas; always true without a
+   *          rasterizer.
+   */
+  bool is_text_ready(const std::string& text);
+
   /** @deprecated Use `get_text_size` instead */
   float get_text_width(const std::string& text) const;
 
   /** @deprecated Use `get_text_size` instead */
   float get_text_height(const std::string& text) const;
 
+  /** Measures @p text from the font metrics, without rasterizing it. */
   Size get_text_size(const std::string& text) const;
 
+  /** @returns The maximum height of a line of text. */
+  int get_height() const;
+  /** @returns The recommended distance between two baselines. */
+  int get_line_skip() const;
+
+  /**
+   * Lays out @p text with the glyphs of the atlas, rasterizing the glyphs not
+   * seen before. With a rasterizer, those are left out until they are ready.
+   * Like the rest of this class, text is read as Latin-1.
+   *
+   * @param quads Receives one quad per visible glyph; it is cleared first.
+   * @returns The size of the whole text.
+   */
+  Size layout_text(const std::string& text, std::vector<GlyphQuad>& quads);
+
+  /**
+   * Measures every caret position of @p text in one pass, from the cached
+   * glyph advances and kerning; no glyph is rasterized.
+   *
+   * @param offsets Receives `text.size() + 1` horizontal offsets: the pen
+   *                position before each character, then after the last one.
+   */
+  void get_caret_offsets(const std::string& text, std::vector<float>& offsets);
+
+  /**
+   * @returns The index of the offset closest to @p x, using a binary search.
+   *          Ties go to the lower index.
+   */
+  static size_t get_caret_at(const std::vector<float>& offsets, float x);
+
+  /**
+   * The glyph atlas, as an SDL_PIXELFORMAT_RGBA32 surface of white glyphs.
+   * Renderers upload it as a texture; get_atlas_version() changes every time
+   * the atlas gains glyphs, telling them to upload it again.
+   */
+  SDL_Surface* get_atlas() const;
+  unsigned get_atlas_version() const;
+
+  /** Number identifying this font, never reused by another Font object. */
+  unsigned get_id() const;
+
+  int get_size() const;
+  /**
+   * Whether the atlas holds signed distance fields: the alpha channel is
+   * 0.5 on glyph edges, rising to 1 at SDF_SPREAD pixels inside and falling
+   * to 0 at SDF_SPREAD pixels outside.
+   */
+  bool is_sdf() const;
+
+private:
+  struct Glyph
+  {
+    /** Whether offset and advance are known. */
+    bool measured;
+    /** Whether the image has been put in the atlas (or found blank). */
+    bool loaded;
+    /** Whether the image is being rasterized in the background. */
+    bool pending;
+    /** Whether the glyph has no visible pixels (e.g. spaces). */
+    bool blank;
+    SDL_Rect rect;
+    /** Horizontal distance between the pen position and the glyph image. */
+    int offset;
+    int advance;
+  };
+
+private:
+  const Glyph& get_glyph_metrics(unsigned char c);
+  /**
+   * @returns The glyph, rasterized and in the atlas unless a rasterizer took
+   *          over the job; check Glyph::loaded.
+   */
+  const Glyph& get_glyph(unsigned char c);
+  /**
+   * Renders @p c with @p face, converted to RGBA32 (and to a distance field
+   * for SDF fonts). Doesn't touch the atlas, so workers may call it.
+   *
+   * @returns The image, or nullptr if the glyph has no visible pixels.
+   */
+  SDL_Surface* rasterize_glyph(TTF_Font* face, unsigned char c) const;
+  /** Packs @p image in the atlas, then frees it. nullptr marks it blank. */
+  void place_glyph(Glyph& glyph, SDL_Surface* image);
+  /** Places the glyphs finished by the rasterizer since the last call. */
+  void collect_glyphs();
+  int get_kerning(unsigned char prev, unsigned char c);
+  void grow_atlas(int min_width, int min_height);
+  /**
+   * @returns A new surface, padded by SDF_SPREAD, holding the distance field
+   *          of the coverage in @p image.
+   */
+  SDL_Surface* make_distance_field(SDL_Surface* image) const;
+
+private:
+  /** Atomic, as reloaded fonts are created on the rasterizer. */
+  static std::atomic<unsigned> s_next_id;
+  /** IDs of the destroyed fonts, in the order they were destroyed. */
+  static std::vector<unsigned> s_retired_ids;
+  static std::mutex s_retired_mutex;
+
 private:
   std::string m_name;
   int m_size;
+  bool m_sdf;
+  /** Space around glyph images in the atlas, SDF_SPREAD for SDF fonts. */
+  int m_padding;
   TTF_Font* m_font;
-  std::unordered_map<std::string, SDL_Surface*> m_text_surfaces;
+  unsigned m_id;
+  Glyph m_glyphs[256];
+  bool m_kerning_enabled;
+  /** Kerning between pairs of characters, keyed by `prev << 8 | c`. */
+  std::unordered_map<uint16_t, int> m_kerning;
+  SDL_Surface* m_atlas;
+  unsigned m_atlas_version;
+  /** Shelf packing: cursor in the current shelf, and that shelf's height. */
+  int m_atlas_x, m_atlas_y, m_atlas_shelf_h;
+  Placeholder m_placeholder;
+
+  /**
+   * TTF_Font isn't thread-safe: workers share a second face of the font, one
+   * at a time, while the render thread keeps using m_font.
+   */
+  TTF_Font* m_worker_font;
+  std::mutex m_worker_mutex;
+  /** Guards the members below, shared with the workers. */
+  std::mutex m_ready_mutex;
+  std::condition_variable m_jobs_done;
+  std::vector<std::pair<unsigned char, SDL_Surface*>> m_ready_glyphs;
+  int m_pending_jobs;
 
 private:
   Font(const Font&) = delete;
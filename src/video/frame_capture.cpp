@@ -0,0 +1,273 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/frame_capture.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "video/drawing_context.hpp"
+
+namespace {
+
+const char MAGIC[4] = { 'H', 'B', 'R', 'C' };
+
+template<typename T>
+void
+write(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void
+write_string(std::ostream& out, const std::string& str)
+{
+  write(out, static_cast<uint32_t>(str.size()));
+  out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+template<typename T>
+T
+read(std::istream& in)
+{
+  T value;
+  if (!in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    throw std::runtime_error("Truncated frame capture file");
+
+  return value;
+}
+
+size_t
+remaining(std::istream& in)
+{
+  std::streampos pos = in.tellg();
+  in.seekg(0, std::ios::end);
+  std::streampos end = in.tellg();
+  in.seekg(pos);
+
+  if (pos < 0 || end < pos)
+    throw std::runtime_error("Truncated frame capture file");
+
+  return static_cast<size_t>(end - pos);
+}
+
+/**
+ * Reads a count of entries that each take at least @p min_size bytes in the
+ * file, rejecting counts the rest of the file cannot hold.
+ */
+uint32_t
+read_count(std::istream& in, size_t min_size)
+{
+  uint32_t count = read<uint32_t>(in);
+  if (count > remaining(in) / min_size)
+    throw std::runtime_error("Truncated frame capture file");
+
+  return count;
+}
+
+std::string
+read_string(std::istream& in)
+{
+  std::string str(read_count(in, 1), '\0');
+  if (!in.read(&str[0], static_cast<std::streamsize>(str.size())))
+    throw std::runtime_error("Truncated frame capture file");
+
+  return str;
+}
+
+} // namespace
+
+FrameCapture::FrameCapture() :
+  m_recorder(),
+  m_buffer(),
+  m_frame_ends(),
+  m_textures(),
+  m_fonts(),
+  m_loaded(false)
+{
+}
+
+FrameCapture::FrameCapture(const std::string& file) :
+  m_recorder(),
+  m_buffer(),
+  m_frame_ends(),
+  m_textures(),
+  m_fonts(),
+  m_loaded(true)
+{
+  std::ifstream in(file, std::ios::binary);
+
+  if (!in)
+    throw std::runtime_error("Could not open frame capture: " + file);
+
+  char magic[sizeof(MAGIC)];
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+  {
+    throw std::runtime_error("Not a frame capture: " + file);
+  }
+
+  uint32_t version = read<uint32_t>(in);
+  if (version != VERSION)
+  {
+    throw std::runtime_error("Unsupported frame capture version "
+                             + std::to_string(version) + ": " + file);
+  }
+
+  // File name length, then width and height.
+  m_textures.resize(read_count(in, 3 * sizeof(uint32_t)));
+  for (auto& texture : m_textures)
+  {
+    texture.file = read_string(in);
+    texture.size.w = read<float>(in);
+    texture.size.h = read<float>(in);
+  }
+
+  // File name length, size, then the SDF flag.
+  m_fonts.resize(read_count(in, 2 * sizeof(uint32_t) + 1));
+  for (auto& font : m_fonts)
+  {
+    font.file = read_string(in);
+    font.size = read<int32_t>(in);
+    font.sdf = read<uint8_t>(in) != 0;
+  }
+
+  m_frame_ends.resize(read_count(in, sizeof(uint32_t)));
+  for (auto& frame_end : m_frame_ends)
+  {
+    size_t offset = m_buffer.size();
+    m_buffer.resize(offset + read_count(in, 1));
+
+    if (!in.read(reinterpret_cast<char*>(m_buffer.data() + offset),
+                 static_cast<std::streamsize>(m_buffer.size() - offset)))
+    {
+      throw std::runtime_error("Truncated frame capture file");
+    }
+
+    frame_end = m_buffer.size();
+  }
+}
+
+void
+FrameCapture::record(const DrawingContext& context, Texture* target)
+{
+  if (m_loaded)
+  {
+    throw std::runtime_error("Cannot record frames into a frame capture "
+                             "loaded from a file");
+  }
+
+  context.render(m_recorder, target);
+
+  const auto& commands = m_recorder.get_buffer();
+  m_buffer.insert(m_buffer.end(), commands.begin(), commands.end());
+  m_recorder.clear();
+
+  // The recorder's tables only ever grow, so new entries are at the end
+  for (size_t i = m_textures.size(); i < m_recorder.get_textures().size(); i++)
+  {
+    const auto& info = m_recorder.get_textures()[i];
+    m_textures.push_back({ info.file, info.size });
+  }
+
+  for (size_t i = m_fonts.size(); i < m_recorder.get_fonts().size(); i++)
+    m_fonts.push_back(m_recorder.get_fonts()[i]);
+}
+
+void
+FrameCapture::end_frame()
+{
+  m_frame_ends.push_back(m_buffer.size());
+}
+
+void
+FrameCapture::save(const std::string& file) const
+{
+  std::ofstream out(file, std::ios::binary);
+
+  if (!out)
+  {
+    throw std::runtime_error("Could not open frame capture for writing: "
+                             + file);
+  }
+
+  out.write(MAGIC, sizeof(MAGIC));
+  write(out, VERSION);
+
+  write(out, static_cast<uint32_t>(m_textures.size()));
+  for (const auto& texture : m_textures)
+  {
+    write_string(out, texture.file);
+    write(out, texture.size.w);
+    write(out, texture.size.h);
+  }
+
+  write(out, static_cast<uint32_t>(m_fonts.size()));
+  for (const auto& font : m_fonts)
+  {
+    write_string(out, font.file);
+    write(out, static_cast<int32_t>(font.size));
+    write(out, static_cast<uint8_t>(font.sdf));
+  }
+
+  write(out, static_cast<uint32_t>(m_frame_ends.size()));
+  size_t start = 0;
+  for (size_t end : m_frame_ends)
+  {
+    write(out, static_cast<uint32_t>(end - start));
+    out.write(reinterpret_cast<const char*>(m_buffer.data() + start),
+              static_cast<std::streamsize>(end - start));
+    start = end;
+  }
+
+  if (!out)
+    throw std::runtime_error("Could not write frame capture: " + file);
+}
+
+size_t
+FrameCapture::get_frame_count() const
+{
+  return m_frame_ends.size();
+}
+
+const std::vector<FrameCapture::TextureInfo>&
+FrameCapture::get_textures() const
+{
+  return m_textures;
+}
+
+const std::vector<RecordingRenderer::FontKey>&
+FrameCapture::get_fonts() const
+{
+  return m_fonts;
+}
+
+void
+FrameCapture::replay(size_t frame, Renderer& renderer,
+                     const std::vector<Texture*>& textures) const
+{
+  if (frame >= m_frame_ends.size())
+  {
+    throw std::runtime_error("Frame capture has no frame "
+                             + std::to_string(frame));
+  }
+
+  size_t start = frame ? m_frame_ends[frame - 1] : 0;
+  RecordingRenderer::replay(m_buffer.data() + start,
+                            m_frame_ends[frame] - start, renderer, textures,
+                            m_fonts);
+}
@@ -0,0 +1,99 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_FRAMECAPTURE_HPP
+#define _HEADER_HARBOR_VIDEO_FRAMECAPTURE_HPP
+
+#include <string>
+#include <vector>
+
+#include "util/size.hpp"
+#include "video/recording_renderer.hpp"
+
+class DrawingContext;
+
+/**
+ * Records the draw requests of whole frames so that they can be saved to a
+ * file and played back later, on any Renderer backend (see harbor_replay).
+ *
+ * File layout, with integers and floats in native byte order and strings as a
+ * 32-bit length followed by their bytes:
+ *
+ *   "HBRC", uint32 version
+ *   uint32 texture count, then for each: string file, float w, float h
+ *   uint32 font count, then for each: string file, int32 size, uint8 sdf
+ *   uint32 frame count, then for each: uint32 byte count, RecordingRenderer
+ *                                      command buffer
+ */
+class FrameCapture final
+{
+public:
+  static const uint32_t VERSION = 2;
+
+  /** Textures without a file are render targets; only their size is kept. */
+  struct TextureInfo
+  {
+    std::string file;
+    Size size;
+  };
+
+public:
+  FrameCapture();
+
+  /**
+   * Loads a capture written by save().
+   *
+   * @throws std::runtime_error if the file can't be read or isn't a capture.
+   */
+  FrameCapture(const std::string& file);
+
+  /**
+   * Appends the requests of @p context, as DrawingContext::render() would draw
+   * them on @p target, to the current frame.
+   */
+  void record(const DrawingContext& context, Texture* target = nullptr);
+
+  /** Closes the current frame; the next record() starts a new one. */
+  void end_frame();
+
+  /** Writes all frames closed with end_frame() to @p file. */
+  void save(const std::string& file) const;
+
+  size_t get_frame_count() const;
+  const std::vector<TextureInfo>& get_textures() const;
+  const std::vector<RecordingRenderer::FontKey>& get_fonts() const;
+
+  /**
+   * Plays frame number @p frame back on @p renderer. @p textures must hold a
+   * texture usable by @p renderer for each entry of get_textures().
+   */
+  void replay(size_t frame, Renderer& renderer,
+              const std::vector<Texture*>& textures) const;
+
+private:
+  RecordingRenderer m_recorder;
+  std::vector<uint8_t> m_buffer;
+  std::vector<size_t> m_frame_ends;
+  std::vector<TextureInfo> m_textures;
+  std::vector<RecordingRenderer::FontKey> m_fonts;
+  bool m_loaded;
+
+private:
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+};
+
+#endif
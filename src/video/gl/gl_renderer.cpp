@@ -22,20 +22,129 @@
 #include "video/gl/gl_texture.hpp"
 #include "video/gl/gl_window.hpp"
 #include "util/color.hpp"
+#include "util/log.hpp"
 #include "util/math.hpp"
 #include "util/rect.hpp"
 #include "util/vector.hpp"
 
+namespace {
+
+/**
+ * OpenGL 2.0 entry points, which SDL_opengl.h doesn't declare on every
+ * platform. They are looked up once, by the first renderer needing them.
+ */
+struct GLShaderFunctions
+{
+  PFNGLCREATESHADERPROC CreateShader;
+  PFNGLSHADERSOURCEPROC ShaderSource;
+  PFNGLCOMPILESHADERPROC CompileShader;
+  PFNGLGETSHADERIVPROC GetShaderiv;
+  PFNGLDELETESHADERPROC DeleteShader;
+  PFNGLCREATEPROGRAMPROC CreateProgram;
+  PFNGLATTACHSHADERPROC AttachShader;
+  PFNGLLINKPROGRAMPROC LinkProgram;
+  PFNGLGETPROGRAMIVPROC GetProgramiv;
+  PFNGLUSEPROGRAMPROC UseProgram;
+  PFNGLDELETEPROGRAMPROC DeleteProgram;
+
+  /** @returns Whether all the functions were found. */
+  bool load()
+  {
+    CreateShader = reinterpret_cast<PFNGLCREATESHADERPROC>(
+                                      SDL_GL_GetProcAddress("glCreateShader"));
+    ShaderSource = reinterpret_cast<PFNGLSHADERSOURCEPROC>(
+                                      SDL_GL_GetProcAddress("glShaderSource"));
+    CompileShader = reinterpret_cast<PFNGLCOMPILESHADERPROC>(
+                                     SDL_GL_GetProcAddress("glCompileShader"));
+    GetShaderiv = reinterpret_cast<PFNGLGETSHADERIVPROC>(
+                                       SDL_GL_GetProcAddress("glGetShaderiv"));
+    DeleteShader = reinterpret_cast<PFNGLDELETESHADERPROC>(
+                                      SDL_GL_GetProcAddress("glDeleteShader"));
+    CreateProgram = reinterpret_cast<PFNGLCREATEPROGRAMPROC>(
+                                     SDL_GL_GetProcAddress("glCreateProgram"));
+    AttachShader = reinterpret_cast<PFNGLATTACHSHADERPROC>(
+                                      SDL_GL_GetProcAddress("glAttachShader"));
+    LinkProgram = reinterpret_cast<PFNGLLINKPROGRAMPROC>(
+                                       SDL_GL_GetProcAddress("glLinkProgram"));
+    GetProgramiv = reinterpret_cast<PFNGLGETPROGRAMIVPROC>(
+                                      SDL_GL_GetProcAddress("glGetProgramiv"));
+    UseProgram = reinterpret_cast<PFNGLUSEPROGRAMPROC>(
+                                        SDL_GL_GetProcAddress("glUseProgram"));
+    DeleteProgram = reinterpret_cast<PFNGLDELETEPROGRAMPROC>(
+                                     SDL_GL_GetProcAddress("glDeleteProgram"));
+
+    return CreateShader && ShaderSource && CompileShader && GetShaderiv &&
+           DeleteShader && CreateProgram && AttachShader && LinkProgram &&
+           GetProgramiv && UseProgram && DeleteProgram;
+  }
+};
+
+GLShaderFunctions g_gl_shaders;
+
+const char* SDF_VERTEX_SHADER =
+  "#version 110\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = ftransform();\n"
+  "  gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+  "  gl_FrontColor = gl_Color;\n"
+  "}\n";
+
+// The edge is at 0.5; fwidth() gives how much the distance changes over one
+// pixel on screen, which keeps edges one pixel wide at any scale.
+const char* SDF_FRAGMENT_SHADER =
+  "#version 110\n"
+  "uniform sampler2D atlas;\n"
+  "void main()\n"
+  "{\n"
+  "  float distance = texture2D(atlas, gl_TexCoord[0].st).a;\n"
+  "  float width = max(fwidth(distance), 0.0001);\n"
+  "  float coverage = clamp((distance - 0.5) / width + 0.5, 0.0, 1.0);\n"
+  "  gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * coverage);\n"
+  "}\n";
+
+/** @returns The compiled shader, or 0 if it didn't compile. */
+GLuint
+compile_shader(GLenum type, const char* source)
+{
+  GLuint shader = g_gl_shaders.CreateShader(type);
+  g_gl_shaders.ShaderSource(shader, 1, &source, nullptr);
+  g_gl_shaders.CompileShader(shader);
+
+  GLint compiled = GL_FALSE;
+  g_gl_shaders.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+  if (!compiled)
+  {
+    g_gl_shaders.DeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+} // namespace
+
 GLRenderer::GLRenderer(GLWindow& window) :
   Renderer(window),
   m_glwindow(window),
   m_gl_renderer(SDL_GL_CreateContext(window.get_sdl_window())),
-  m_target(-1)
+  m_target(-1),
+  m_atlases(),
+  m_glyph_quads(),
+  m_sdf_program(0),
+  m_sdf_program_loaded(false)
 {
 }
 
 GLRenderer::~GLRenderer()
 {
+  for (const auto& atlas : m_atlases)
+    glDeleteTextures(1, &atlas.second.texture);
+
+  if (m_sdf_program)
+    g_gl_shaders.DeleteProgram(m_sdf_program);
+
   SDL_GL_DeleteContext(m_gl_renderer);
 }
 
@@ -121,9 +230,9 @@ GLRenderer::draw_texture(const Texture& texture, const Rect& srcrect,
 
 void
 GLRenderer::draw_text(const std::string& text, const Vector& pos,
-                       const Rect& /* clip */, TextAlign align,
-                       const std::string& fontfile, int size,
-                       const Color& color, const Blend& blend)
+                       const Rect& clip, TextAlign align,
+                       const Font::Handle& handle, const Color& color,
+                       const Blend& blend)
 {
   if (!is_drawing())
   {
@@ -131,89 +240,63 @@ GLRenderer::draw_text(const std::string& text, const Vector& pos,
                              "drawing");
   }
 
-  auto& font = Font::get_font(fontfile, size);
+  auto& font = Font::get_font(handle);
+  layout_glyphs(font, text, pos, align, clip, m_glyph_quads,
+                get_text_scale(handle, font));
+
+  if (m_glyph_quads.empty())
+    return;
 
-  SDL_Surface* surface = get_font_surface(font, text);
-  auto* image = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+  GLuint texture = get_atlas_texture(font);
+  const float atlas_w = static_cast<float>(font.get_atlas()->w);
+  const float atlas_h = static_cast<float>(font.get_atlas()->h);
+  GLuint program = font.is_sdf() ? get_sdf_program() : 0;
 
   glEnable(GL_TEXTURE_2D);
   glEnable(GL_BLEND);
   set_gl_blend(blend);
 
-  GLuint text_texture;
-  glGenTextures(1, &text_texture);
-  glBindTexture(GL_TEXTURE_2D, text_texture);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->w, image->h, 0,
-               GL_RGBA, GL_UNSIGNED_BYTE, image->pixels);
-
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-  // TODO: Support blend mode
-
-  Rect dst(Vector(static_cast<int>(pos.x), static_cast<int>(pos.y)),
-           Size(surface->w, surface->h));
-
-  switch(align) {
-    case TextAlign::TOP_LEFT:
-      break;
-
-    case TextAlign::TOP_MID:
-      dst.move(Vector(surface->w / 2, 0.f));
-      break;
-
-    case TextAlign::TOP_RIGHT:
-      dst.move(Vector(surface->w, 0.f));
-      break;
-
-    case TextAlign::MID_LEFT:
-      dst.move(Vector(0.f, -surface->h / 2));
-      break;
-
-    case TextAlign::CENTER:
-      dst.move(Vector(surface->w / 2, -surface->h / 2));
-      break;
-
-    case TextAlign::MID_RIGHT:
-      dst.move(Vector(surface->w, -surface->h / 2));
-      break;
-
-    case TextAlign::BOTTOM_LEFT:
-      dst.move(Vector(0.f, -surface->h));
-      break;
-
-    case TextAlign::BOTTOM_MID:
-      dst.move(Vector(surface->w / 2, -surface->h));
-      break;
-
-    case TextAlign::BOTTOM_RIGHT:
-      dst.move(Vector(surface->w, -surface->h));
-      break;
+  if (program)
+  {
+    g_gl_shaders.UseProgram(program);
+  }
+  else if (font.is_sdf())
+  {
+    // Without shaders, alpha testing at least keeps the edges sharp
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GEQUAL, .5f * color.a);
   }
 
+  glBindTexture(GL_TEXTURE_2D, texture);
   glColor4f(color.r, color.g, color.b, color.a);
 
+  // All the glyphs of the string go out in a single batch
   glBegin(GL_QUADS);
 
-  glTexCoord2i(0, 0);
-  glVertex2f(dst.x1, dst.y1);
-  glTexCoord2i(1, 0);
-  glVertex2f(dst.x2, dst.y1);
-  glTexCoord2i(1, 1);
-  glVertex2f(dst.x2, dst.y2);
-  glTexCoord2i(0, 1);
-  glVertex2f(dst.x1, dst.y2);
+  for (const auto& quad : m_glyph_quads)
+  {
+    const Rect& src = quad.srcrect;
+    const Rect& dst = quad.dstrect;
+
+    glTexCoord2f(src.x1 / atlas_w, src.y1 / atlas_h);
+    glVertex2f(dst.x1, dst.y1);
+    glTexCoord2f(src.x2 / atlas_w, src.y1 / atlas_h);
+    glVertex2f(dst.x2, dst.y1);
+    glTexCoord2f(src.x2 / atlas_w, src.y2 / atlas_h);
+    glVertex2f(dst.x2, dst.y2);
+    glTexCoord2f(src.x1 / atlas_w, src.y2 / atlas_h);
+    glVertex2f(dst.x1, dst.y2);
+  }
 
   glEnd();
 
+  if (program)
+    g_gl_shaders.UseProgram(0);
+  else if (font.is_sdf())
+    glDisable(GL_ALPHA_TEST);
+
   glDisable(GL_TEXTURE_2D);
   glDisable(GL_BLEND);
-
-  SDL_FreeSurface(surface);
-  SDL_FreeSurface(image);
 }
 
 void
@@ -240,10 +323,37 @@ GLRenderer::draw_line(const Vector& p1, const Vector& p2, const Color& color,
   glDisable(GL_BLEND);
 }
 
+void
+GLRenderer::draw_lines(const std::vector<Vector>& points, const Color& color,
+                       const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to GLRenderer::draw_lines while not "
+                             "drawing");
+  }
+
+  glEnable(GL_BLEND);
+  set_gl_blend(blend);
+
+  glBegin(GL_LINES);
+
+  glColor4f(color.r, color.g, color.b, color.a);
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+  {
+    glVertex2f(points[i].x, points[i].y);
+    glVertex2f(points[i + 1].x, points[i + 1].y);
+  }
+
+  glEnd();
+
+  glDisable(GL_BLEND);
+}
+
 void
 GLRenderer::start_draw(Texture* texture)
 {
-  Renderer::start_draw();
+  Renderer::start_draw(texture);
 
   auto* gl_texture = dynamic_cast<GLTexture*>(texture);
 
@@ -327,6 +437,98 @@ GLRenderer::set_gl_blend(const Blend& blend)
   }
 }
 
+void
+GLRenderer::release_font(unsigned font_id)
+{
+  auto it = m_atlases.find(font_id);
+  if (it == m_atlases.end())
+    return;
+
+  glDeleteTextures(1, &it->second.texture);
+  m_atlases.erase(it);
+}
+
+GLuint
+GLRenderer::get_atlas_texture(Font& font)
+{
+  auto& atlas = m_atlases[font.get_id()];
+
+  if (atlas.texture && atlas.version == font.get_atlas_version())
+    return atlas.texture;
+
+  if (!atlas.texture)
+  {
+    glGenTextures(1, &atlas.texture);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Distance fields are interpolated; bitmap glyphs are drawn 1:1
+    const GLfloat filter = font.is_sdf() ? GL_LINEAR : GL_NEAREST;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  }
+  else
+  {
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+  }
+
+  // The atlas is SDL_PIXELFORMAT_RGBA32, which is GL_RGBA byte for byte
+  SDL_Surface* surface = font.get_atlas();
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface->w, surface->h, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, surface->pixels);
+  atlas.version = font.get_atlas_version();
+
+  return atlas.texture;
+}
+
+GLuint
+GLRenderer::get_sdf_program()
+{
+  if (m_sdf_program_loaded)
+    return m_sdf_program;
+
+  m_sdf_program_loaded = true;
+
+  if (!g_gl_shaders.load())
+  {
+    log_warn << "OpenGL shaders unavailable, SDF text will be alpha-tested"
+             << std::endl;
+    return 0;
+  }
+
+  GLuint vertex = compile_shader(GL_VERTEX_SHADER, SDF_VERTEX_SHADER);
+  GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, SDF_FRAGMENT_SHADER);
+
+  if (vertex && fragment)
+  {
+    GLuint program = g_gl_shaders.CreateProgram();
+    g_gl_shaders.AttachShader(program, vertex);
+    g_gl_shaders.AttachShader(program, fragment);
+    g_gl_shaders.LinkProgram(program);
+
+    GLint linked = GL_FALSE;
+    g_gl_shaders.GetProgramiv(program, GL_LINK_STATUS, &linked);
+
+    if (linked)
+      m_sdf_program = program;
+    else
+      g_gl_shaders.DeleteProgram(program);
+  }
+
+  if (vertex)
+    g_gl_shaders.DeleteShader(vertex);
+  if (fragment)
+    g_gl_shaders.DeleteShader(fragment);
+
+  if (!m_sdf_program)
+  {
+    log_warn << "Could not build the SDF text shader, SDF text will be "
+             << "alpha-tested" << std::endl;
+  }
+
+  return m_sdf_program;
+}
+
 bool
 GLRenderer::check_gl_error() const
 {
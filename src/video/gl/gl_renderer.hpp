@@ -19,6 +19,9 @@
 
 #include "video/renderer.hpp"
 
+#include <unordered_map>
+#include <vector>
+
 #include "SDL_opengl.h"
 
 class GLWindow;
@@ -38,21 +41,46 @@ public:
                             const Color& color, const Blend& blend) override;
   virtual void draw_text(const std::string& text, const Vector& pos,
                          const Rect& clip, TextAlign align,
-                         const std::string& fontfile, int size,
-                         const Color& color, const Blend& blend) override;
+                         const Font::Handle& font, const Color& color,
+                         const Blend& blend) override;
   virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
                          const Blend& blend) override;
+  virtual void draw_lines(const std::vector<Vector>& points, const Color& color,
+                          const Blend& blend) override;
   virtual void start_draw(Texture* texture = nullptr) override;
   virtual void end_draw() override;
 
+protected:
+  virtual void release_font(unsigned font_id) override;
+
+private:
+  struct AtlasTexture
+  {
+    GLuint texture;
+    unsigned version;
+  };
+
 private:
   void set_gl_blend(const Blend& blend);
   bool check_gl_error() const;
+  /** Uploads the glyph atlas of @p font if it changed since the last call. */
+  GLuint get_atlas_texture(Font& font);
+  /**
+   * Compiles the program drawing SDF glyphs the first time it's called.
+   *
+   * @returns The program, or 0 if the context can't run GLSL shaders.
+   */
+  GLuint get_sdf_program();
 
 private:
   GLWindow& m_glwindow;
   SDL_GLContext m_gl_renderer;
   GLuint m_target;
+  /** Glyph atlas textures, by font ID. */
+  std::unordered_map<unsigned, AtlasTexture> m_atlases;
+  std::vector<Font::GlyphQuad> m_glyph_quads;
+  GLuint m_sdf_program;
+  bool m_sdf_program_loaded;
 
 private:
   GLRenderer(const GLRenderer&) = delete;
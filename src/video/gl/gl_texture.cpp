@@ -21,7 +21,9 @@
 
 #include "SDL_image.h"
 
+#include "util/archive.hpp"
 #include "video/gl/gl_window.hpp"
+#include "video/texture_file.hpp"
 
 GLTexture::GLTexture(GLWindow& window, const Size& size) :
   Texture(size),
@@ -40,20 +42,107 @@ GLTexture::GLTexture(GLWindow& window, const Size& size) :
 }
 
 GLTexture::GLTexture(GLWindow& window, const std::string& file) :
-  Texture(Size()),
+  Texture(Size(), file),
   m_renderer(window.get_glrenderer()),
   m_gl_texture(),
   m_sdl_surface(nullptr)
 {
-  SDL_Surface* image = IMG_Load(file.c_str());
+  SDL_Surface* image = IMG_Load_RW(Archive::open_rw(file), 1);
 
   if (!image)
   {
     throw std::runtime_error("GLTexture could not load image: " + file);
   }
 
-  m_sdl_surface = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ABGR8888, 0);
+  try
+  {
+    upload(image);
+  }
+  catch (...)
+  {
+    SDL_FreeSurface(image);
+    throw;
+  }
+
   SDL_FreeSurface(image);
+}
+
+GLTexture::GLTexture(GLWindow& window, SDL_Surface* surface,
+                     const std::string& file) :
+  Texture(Size(), file),
+  m_renderer(window.get_glrenderer()),
+  m_gl_texture(),
+  m_sdl_surface(nullptr)
+{
+  upload(surface);
+}
+
+GLTexture::GLTexture(GLWindow& window, const TextureFile& image,
+                     const std::string& file) :
+  Texture(Size(), file),
+  m_renderer(window.get_glrenderer()),
+  m_gl_texture(),
+  m_sdl_surface(nullptr)
+{
+  upload(image);
+}
+
+GLTexture::~GLTexture()
+{
+  glDeleteTextures(1, &m_gl_texture);
+
+  if (m_sdl_surface)
+  {
+    SDL_FreeSurface(m_sdl_surface);
+  }
+}
+
+GLuint
+GLTexture::get_gl_texture() const
+{
+  return m_gl_texture;
+}
+
+void
+GLTexture::replace(SDL_Surface* surface)
+{
+  glDeleteTextures(1, &m_gl_texture);
+  m_gl_texture = 0;
+
+  if (m_sdl_surface)
+  {
+    SDL_FreeSurface(m_sdl_surface);
+    m_sdl_surface = nullptr;
+  }
+
+  upload(surface);
+}
+
+void
+GLTexture::replace(const TextureFile& image)
+{
+  glDeleteTextures(1, &m_gl_texture);
+  m_gl_texture = 0;
+
+  if (m_sdl_surface)
+  {
+    SDL_FreeSurface(m_sdl_surface);
+    m_sdl_surface = nullptr;
+  }
+
+  upload(image);
+}
+
+void
+GLTexture::upload(SDL_Surface* image)
+{
+  m_sdl_surface = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ABGR8888, 0);
+
+  if (!m_sdl_surface)
+  {
+    throw std::runtime_error("GLTexture could not convert image: "
+                             + std::string(SDL_GetError()));
+  }
 
   m_size.w = static_cast<float>(m_sdl_surface->w);
   m_size.h = static_cast<float>(m_sdl_surface->h);
@@ -70,18 +159,40 @@ GLTexture::GLTexture(GLWindow& window, const std::string& file) :
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 }
 
-GLTexture::~GLTexture()
+void
+GLTexture::upload(const TextureFile& image)
 {
-  glDeleteTextures(1, &m_gl_texture);
+  if (image.get_format() != TextureFile::Format::RGBA32)
+  {
+    throw std::runtime_error("GLTexture can't upload the format of: "
+                             + m_file);
+  }
 
-  if (m_sdl_surface)
+  const auto& levels = image.get_levels();
+  m_size.w = static_cast<float>(levels[0].width);
+  m_size.h = static_cast<float>(levels[0].height);
+
+  glGenTextures(1, &m_gl_texture);
+  glBindTexture(GL_TEXTURE_2D, m_gl_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, TextureFile::ROW_ALIGNMENT);
+
+  for (size_t i = 0; i < levels.size(); i++)
   {
-    SDL_FreeSurface(m_sdl_surface);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,
+                  static_cast<GLint>(levels[i].pitch / 4));
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA,
+                 static_cast<GLsizei>(levels[i].width),
+                 static_cast<GLsizei>(levels[i].height), 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, levels[i].pixels);
   }
-}
 
-GLuint
-GLTexture::get_gl_texture() const
-{
-  return m_gl_texture;
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  static_cast<GLint>(levels.size() - 1));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  levels.size() > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
 }
@@ -25,6 +25,8 @@
 
 #include "video/gl/gl_renderer.hpp"
 
+class TextureFile;
+
 /**
  * Class that represents a readable texture.
  */
@@ -34,10 +36,24 @@ class GLTexture final :
 public:
   GLTexture(GLWindow& window, const Size& size);
   GLTexture(GLWindow& window, const std::string& file);
+  /** Uploads @p surface, which the caller keeps ownership of. */
+  GLTexture(GLWindow& window, SDL_Surface* surface, const std::string& file);
+  /** Uploads every level of @p image, with no conversion. */
+  GLTexture(GLWindow& window, const TextureFile& image,
+            const std::string& file);
   virtual ~GLTexture() override;
 
   GLuint get_gl_texture() const;
 
+  virtual void replace(SDL_Surface* surface) override;
+  virtual void replace(const TextureFile& image) override;
+
+private:
+  /** Converts @p image to RGBA, keeping a copy, and uploads it. */
+  void upload(SDL_Surface* image);
+  /** Uploads every level of @p image, with no conversion. */
+  void upload(const TextureFile& image);
+
 private:
   GLRenderer& m_renderer;
   GLuint m_gl_texture;
@@ -20,6 +20,7 @@
 
 #include "SDL_image.h"
 
+#include "util/archive.hpp"
 #include "util/vector.hpp"
 #include "video/gl/gl_texture.hpp"
 
@@ -47,25 +48,30 @@ GLWindow::~GLWindow()
   SDL_DestroyWindow(m_sdl_window);
 }
 
-Texture&
-GLWindow::load_texture(const std::string& file)
+std::shared_ptr<Texture>
+GLWindow::create_texture(const Size& size)
 {
-  const auto& texture_ptr = m_texture_cache[std::string(file)];
+  return std::make_shared<GLTexture>(*this, size);
+}
 
-  if (!texture_ptr)
-  {
-    auto new_texture = std::make_unique<GLTexture>(*this, file);
-    m_texture_cache[std::string(file)] = std::move(new_texture);
-    return *m_texture_cache[std::string(file)];
-  }
+std::shared_ptr<Texture>
+GLWindow::create_texture_from_surface(SDL_Surface* surface,
+                                      const std::string& file)
+{
+  return std::make_shared<GLTexture>(*this, surface, file);
+}
 
-  return *texture_ptr;
+std::shared_ptr<Texture>
+GLWindow::create_texture_from_file(const std::string& file)
+{
+  return std::make_shared<GLTexture>(*this, file);
 }
 
 std::shared_ptr<Texture>
-GLWindow::create_texture(const Size& size)
+GLWindow::create_texture_from_image(const TextureFile& image,
+                                    const std::string& file)
 {
-  return std::make_shared<GLTexture>(*this, size);
+  return std::make_shared<GLTexture>(*this, image, file);
 }
 
 Renderer&
@@ -245,7 +251,7 @@ GLWindow::set_icon(const std::string& filename)
 {
   m_icon_path = filename;
 
-  SDL_Surface* surface = IMG_Load(filename.c_str());
+  SDL_Surface* surface = IMG_Load_RW(Archive::open_rw(filename), 1);
 
   if (!surface)
   {
@@ -0,0 +1,53 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/null_renderer.hpp"
+
+void
+NullRenderer::draw_filled_rect(const Rect& /* rect */,
+                               const Color& /* color */,
+                               const Blend& /* blend */)
+{
+}
+
+void
+NullRenderer::draw_texture(const Texture& /* texture */,
+                           const Rect& /* srcrect */,
+                           const Rect& /* dstrect */, float /* angle */,
+                           const Color& /* color */, const Blend& /* blend */)
+{
+}
+
+void
+NullRenderer::draw_text(const std::string& /* text */,
+                        const Vector& /* pos */, const Rect& /* clip */,
+                        TextAlign /* align */,
+                        const Font::Handle& /* font */,
+                        const Color& /* color */, const Blend& /* blend */)
+{
+}
+
+void
+NullRenderer::draw_line(const Vector& /* p1 */, const Vector& /* p2 */,
+                        const Color& /* color */, const Blend& /* blend */)
+{
+}
+
+void
+NullRenderer::draw_lines(const std::vector<Vector>& /* points */,
+                         const Color& /* color */, const Blend& /* blend */)
+{
+}
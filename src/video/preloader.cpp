@@ -0,0 +1,288 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "video/preloader.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "SDL.h"
+#include "SDL_mixer.h"
+
+#include "util/archive.hpp"
+#include "util/log.hpp"
+#include "util/stage_timer.hpp"
+#include "util/thread_pool.hpp"
+#include "video/font.hpp"
+#include "video/texture_file.hpp"
+#include "video/window.hpp"
+
+namespace {
+
+/** Glyphs rasterized ahead of time for preloaded fonts. */
+const std::string PRELOAD_GLYPHS =
+  " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+  "abcdefghijklmnopqrstuvwxyz{|}~";
+
+std::string
+resolve(const std::string& root, const std::string& path)
+{
+  if (root.empty() || path.empty() || path[0] == '/')
+    return path;
+
+  return root + "/" + path;
+}
+
+} // namespace
+
+std::vector<Preloader::Entry>
+Preloader::parse_manifest(const std::string& file)
+{
+  // The manifest may itself be packed in an archive
+  SDL_RWops* rw = Archive::open_rw(file);
+
+  if (!rw)
+  {
+    throw std::runtime_error("Could not open preload manifest " + file + ": "
+                             + std::string(SDL_GetError()));
+  }
+
+  std::string contents(static_cast<size_t>(SDL_RWsize(rw)), '\0');
+  size_t read = contents.empty() ? 0 : SDL_RWread(rw, &contents[0], 1,
+                                                  contents.size());
+  SDL_RWclose(rw);
+
+  if (read != contents.size())
+    throw std::runtime_error("Could not read preload manifest " + file);
+
+  size_t slash = file.find_last_of('/');
+  std::istringstream in(contents);
+  return parse_manifest(in, slash == std::string::npos ? ""
+                                                       : file.substr(0, slash));
+}
+
+std::vector<Preloader::Entry>
+Preloader::parse_manifest(std::istream& in, const std::string& root)
+{
+  std::vector<Entry> entries;
+  std::string line;
+  int line_number = 0;
+
+  while (std::getline(in, line))
+  {
+    line_number++;
+
+    std::istringstream words(line);
+    std::string kind, path;
+
+    if (!(words >> kind) || kind[0] == '#')
+      continue;
+
+    if (!(words >> path))
+    {
+      throw std::runtime_error("Missing path in preload manifest, line "
+                               + std::to_string(line_number));
+    }
+
+    Entry entry{ Kind::TEXTURE, resolve(root, path), 0, false };
+
+    if (kind == "texture")
+    {
+      entry.kind = Kind::TEXTURE;
+    }
+    else if (kind == "sound")
+    {
+      entry.kind = Kind::SOUND;
+    }
+    else if (kind == "font")
+    {
+      entry.kind = Kind::FONT;
+
+      std::string option;
+      if (!(words >> entry.size) || entry.size <= 0)
+      {
+        throw std::runtime_error("Missing or invalid font size in preload "
+                                 "manifest, line "
+                                 + std::to_string(line_number));
+      }
+
+      if (words >> option)
+      {
+        if (option != "sdf")
+        {
+          throw std::runtime_error("Unknown font option '" + option
+                                   + "' in preload manifest, line "
+                                   + std::to_string(line_number));
+        }
+
+        entry.sdf = true;
+      }
+    }
+    else
+    {
+      throw std::runtime_error("Unknown asset kind '" + kind
+                               + "' in preload manifest, line "
+                               + std::to_string(line_number));
+    }
+
+    entries.push_back(entry);
+  }
+
+  return entries;
+}
+
+Preloader::Preloader(const std::vector<Entry>& entries, ThreadPool& pool) :
+  m_pending(),
+  m_sounds()
+{
+  for (const auto& entry : entries)
+  {
+    if (entry.kind == Kind::FONT)
+    {
+      // The font registry isn't thread-safe, but the glyphs are rasterized by
+      // the font rasterizer, if any
+      try
+      {
+        Font::get_font(Font::get_handle(entry.file, entry.size, entry.sdf))
+          .is_text_ready(PRELOAD_GLYPHS);
+      }
+      catch (const std::exception& e)
+      {
+        log_warn << "Could not preload font '" << entry.file << "': "
+                 << e.what() << std::endl;
+      }
+
+      continue;
+    }
+
+    Entry copy = entry;
+    auto result = pool.submit([copy]() {
+      auto start = std::chrono::steady_clock::now();
+      Decoded decoded{ nullptr, nullptr, 0.f };
+
+      if (copy.kind == Kind::TEXTURE)
+      {
+        // Texture files need no decoding; finish() maps them as they are
+        if (!TextureFile::is_texture_file(copy.file))
+          decoded.surface = Window::decode_image(copy.file);
+      }
+      else
+      {
+        decoded.sound = Mix_LoadWAV_RW(Archive::open_rw(copy.file), 1);
+
+        if (!decoded.sound)
+          throw std::runtime_error(Mix_GetError());
+      }
+
+      std::chrono::duration<float, std::milli> elapsed =
+                                      std::chrono::steady_clock::now() - start;
+      decoded.time = elapsed.count();
+      return decoded;
+    });
+
+    m_pending.push_back({ entry, std::move(result) });
+  }
+}
+
+Preloader::~Preloader()
+{
+  // Jobs still running must be waited for, their results are ours to free
+  for (auto& pending : m_pending)
+  {
+    try
+    {
+      Decoded decoded = pending.result.get();
+      SDL_FreeSurface(decoded.surface);
+      Mix_FreeChunk(decoded.sound);
+    }
+    catch (...)
+    {
+    }
+  }
+
+  for (const auto& sound : m_sounds)
+    Mix_FreeChunk(sound.second);
+}
+
+void
+Preloader::finish(Window& window, StageTimer& timer)
+{
+  timer.begin("preload: wait for workers");
+
+  for (auto& pending : m_pending)
+    pending.result.wait();
+
+  timer.begin("preload: upload textures");
+
+  float decode_time = 0.f;
+  size_t loaded = 0;
+
+  for (auto& pending : m_pending)
+  {
+    const Entry& entry = pending.entry;
+
+    try
+    {
+      Decoded decoded = pending.result.get();
+      decode_time += decoded.time;
+      loaded++;
+
+      if (entry.kind == Kind::TEXTURE && !decoded.surface)
+        window.load_texture(entry.file);
+
+      if (decoded.surface)
+      {
+        try
+        {
+          window.load_texture(entry.file, decoded.surface);
+        }
+        catch (...)
+        {
+          SDL_FreeSurface(decoded.surface);
+          throw;
+        }
+
+        SDL_FreeSurface(decoded.surface);
+      }
+
+      if (decoded.sound)
+      {
+        Mix_Chunk*& sound = m_sounds[entry.file];
+        Mix_FreeChunk(sound);
+        sound = decoded.sound;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Could not preload '" << entry.file << "': " << e.what()
+               << std::endl;
+    }
+  }
+
+  m_pending.clear();
+  timer.end();
+
+  timer.add_parallel("preload: decode " + std::to_string(loaded) + " assets",
+                     decode_time);
+}
+
+Mix_Chunk*
+Preloader::get_sound(const std::string& file) const
+{
+  auto it = m_sounds.find(file);
+  return it == m_sounds.end() ? nullptr : it->second;
+}
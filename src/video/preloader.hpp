@@ -0,0 +1,113 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_VIDEO_PRELOADER_HPP
+#define _HEADER_HARBOR_VIDEO_PRELOADER_HPP
+
+#include <future>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class StageTimer;
+class ThreadPool;
+class Window;
+struct Mix_Chunk;
+struct SDL_Surface;
+
+/**
+ * Loads the assets listed in a preload manifest on worker threads, so that
+ * the engine can keep starting up (e.g. create its window) meanwhile, and so
+ * that the first frames don't have to load them.
+ *
+ * A manifest lists one asset per line; paths are relative to the manifest,
+ * and lines starting with '#' are comments:
+ *
+ *     texture images/missing.png
+ *     font fonts/SuperTux-Medium.ttf 16
+ *     font fonts/SuperTux-Medium.ttf 32 sdf
+ *     sound music/chipdisko.wav
+ */
+class Preloader final
+{
+public:
+  enum class Kind {
+    TEXTURE,
+    FONT,
+    SOUND
+  };
+
+  struct Entry
+  {
+    Kind kind;
+    std::string file;
+    /** Font size; unused for other assets. */
+    int size;
+    bool sdf;
+  };
+
+public:
+  static std::vector<Entry> parse_manifest(const std::string& file);
+  /** @param root Directory relative paths are resolved against. */
+  static std::vector<Entry> parse_manifest(std::istream& in,
+                                           const std::string& root);
+
+public:
+  /**
+   * Starts decoding textures and sounds on @p pool, and requests the glyphs
+   * of the fonts from the font rasterizer. Sounds need the audio device to be
+   * opened already.
+   */
+  Preloader(const std::vector<Entry>& entries, ThreadPool& pool);
+  ~Preloader();
+
+  /**
+   * Waits for the assets to be decoded, then uploads the textures to the
+   * cache of @p window. Assets that fail to load are skipped with a warning.
+   */
+  void finish(Window& window, StageTimer& timer);
+
+  /**
+   * @returns The preloaded sound for @p file, owned by the preloader, or
+   *          nullptr. Only available after finish().
+   */
+  Mix_Chunk* get_sound(const std::string& file) const;
+
+private:
+  struct Decoded
+  {
+    SDL_Surface* surface;
+    Mix_Chunk* sound;
+    /** Time spent decoding, in milliseconds. */
+    float time;
+  };
+
+  struct Pending
+  {
+    Entry entry;
+    std::future<Decoded> result;
+  };
+
+private:
+  std::vector<Pending> m_pending;
+  std::unordered_map<std::string, Mix_Chunk*> m_sounds;
+
+private:
+  Preloader(const Preloader&) = delete;
+  Preloader& operator=(const Preloader&) = delete;
+};
+
+#endif
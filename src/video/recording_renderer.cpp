@@ -0,0 +1,608 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/recording_renderer.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "util/color.hpp"
+#include "util/rect.hpp"
+#include "util/vector.hpp"
+#include "video/texture.hpp"
+
+namespace {
+
+class BufferReader final
+{
+public:
+  BufferReader(const uint8_t* data, size_t size) :
+    m_data(data),
+    m_size(size),
+    m_pos(0)
+  {
+  }
+
+  bool done() const
+  {
+    return m_pos >= m_size;
+  }
+
+  size_t remaining() const
+  {
+    return m_pos < m_size ? m_size - m_pos : 0;
+  }
+
+  template<typename T>
+  T read()
+  {
+    if (m_pos + sizeof(T) > m_size)
+      throw std::runtime_error("Truncated RecordingRenderer buffer");
+
+    T value;
+    std::memcpy(&value, m_data + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+  }
+
+  std::string read_string()
+  {
+    uint32_t length = read<uint32_t>();
+
+    if (m_pos + length > m_size)
+      throw std::runtime_error("Truncated RecordingRenderer buffer");
+
+    std::string str(reinterpret_cast<const char*>(m_data + m_pos), length);
+    m_pos += length;
+    return str;
+  }
+
+  Renderer::Blend read_blend()
+  {
+    auto blend = static_cast<Renderer::Blend>(read<int32_t>());
+
+    switch (blend)
+    {
+      case Renderer::Blend::NONE:
+      case Renderer::Blend::BLEND:
+      case Renderer::Blend::ADD:
+      case Renderer::Blend::MODULATE:
+        return blend;
+
+      default:
+        throw std::runtime_error("Invalid blend mode in RecordingRenderer "
+                                 "buffer");
+    }
+  }
+
+  Renderer::TextAlign read_align()
+  {
+    uint8_t align = read<uint8_t>();
+
+    if (align > static_cast<uint8_t>(Renderer::TextAlign::BOTTOM_RIGHT))
+    {
+      throw std::runtime_error("Invalid text alignment in RecordingRenderer "
+                               "buffer");
+    }
+
+    return static_cast<Renderer::TextAlign>(align);
+  }
+
+  Vector read_vector()
+  {
+    float x = read<float>();
+    float y = read<float>();
+    return Vector(x, y);
+  }
+
+  Rect read_rect()
+  {
+    float x1 = read<float>();
+    float y1 = read<float>();
+    float x2 = read<float>();
+    float y2 = read<float>();
+    return Rect(x1, y1, x2, y2);
+  }
+
+  Color read_color()
+  {
+    float r = read<float>();
+    float g = read<float>();
+    float b = read<float>();
+    float a = read<float>();
+    return Color(r, g, b, a);
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+};
+
+} // namespace
+
+RecordingRenderer::FontKey::FontKey() :
+  file(),
+  size(0),
+  sdf(false)
+{
+}
+
+RecordingRenderer::FontKey::FontKey(const std::string& font_file,
+                                    int font_size, bool font_sdf) :
+  file(font_file),
+  size(font_size),
+  sdf(font_sdf)
+{
+}
+
+bool
+RecordingRenderer::FontKey::operator<(const FontKey& key) const
+{
+  if (file != key.file)
+    return file < key.file;
+
+  if (size != key.size)
+    return size < key.size;
+
+  return sdf < key.sdf;
+}
+
+bool
+RecordingRenderer::FontKey::operator==(const FontKey& key) const
+{
+  return file == key.file && size == key.size && sdf == key.sdf;
+}
+
+void
+RecordingRenderer::replay(const uint8_t* data, size_t size, Renderer& renderer,
+                          const std::vector<Texture*>& textures,
+                          const std::vector<FontKey>& fonts)
+{
+  BufferReader in(data, size);
+
+  std::vector<Font::Handle> handles;
+  handles.reserve(fonts.size());
+  for (const auto& font : fonts)
+    handles.push_back(Font::get_handle(font.file, font.size, font.sdf));
+
+  auto read_texture = [&in, &textures]() -> Texture* {
+    uint32_t index = in.read<uint32_t>();
+
+    if (index == NO_TEXTURE)
+      return nullptr;
+
+    if (index >= textures.size() || !textures[index])
+      throw std::runtime_error("Recorded texture index out of range");
+
+    return textures[index];
+  };
+
+  while (!in.done())
+  {
+    switch (static_cast<Command>(in.read<uint8_t>()))
+    {
+      case Command::START_DRAW:
+        renderer.start_draw(read_texture());
+        break;
+
+      case Command::END_DRAW:
+        renderer.end_draw();
+        break;
+
+      case Command::FILLED_RECT:
+      {
+        Rect rect = in.read_rect();
+        Color color = in.read_color();
+        Blend blend = in.read_blend();
+        renderer.draw_filled_rect(rect, color, blend);
+        break;
+      }
+
+      case Command::TEXTURE:
+      {
+        Texture* texture = read_texture();
+        Rect srcrect = in.read_rect();
+        Rect dstrect = in.read_rect();
+        float angle = in.read<float>();
+        Color color = in.read_color();
+        Blend blend = in.read_blend();
+
+        if (!texture)
+          throw std::runtime_error("Recorded draw_texture without texture");
+
+        renderer.draw_texture(*texture, srcrect, dstrect, angle, color, blend);
+        break;
+      }
+
+      case Command::TEXT:
+      {
+        std::string text = in.read_string();
+        Vector pos = in.read_vector();
+        Rect clip = in.read_rect();
+        TextAlign align = in.read_align();
+        uint32_t font = in.read<uint32_t>();
+        Color color = in.read_color();
+        Blend blend = in.read_blend();
+
+        if (font >= handles.size())
+          throw std::runtime_error("Recorded font index out of range");
+
+        renderer.draw_text(text, pos, clip, align, handles[font], color,
+                           blend);
+        break;
+      }
+
+      case Command::LINE:
+      {
+        Vector p1 = in.read_vector();
+        Vector p2 = in.read_vector();
+        Color color = in.read_color();
+        Blend blend = in.read_blend();
+        renderer.draw_line(p1, p2, color, blend);
+        break;
+      }
+
+      case Command::LINES:
+      {
+        uint32_t count = in.read<uint32_t>();
+        if (count > in.remaining() / (2 * sizeof(float)))
+          throw std::runtime_error("Truncated RecordingRenderer buffer");
+
+        std::vector<Vector> points(count);
+        for (auto& point : points)
+          point = in.read_vector();
+        Color color = in.read_color();
+        Blend blend = in.read_blend();
+        renderer.draw_lines(points, color, blend);
+        break;
+      }
+
+      default:
+        throw std::runtime_error("Unknown command in RecordingRenderer "
+                                 "buffer");
+    }
+  }
+}
+
+RecordingRenderer::RecordingRenderer() :
+  m_buffer(),
+  m_command_count(0),
+  m_textures(),
+  m_texture_indices(),
+  m_fonts(),
+  m_font_indices()
+{
+}
+
+void
+RecordingRenderer::draw_filled_rect(const Rect& rect, const Color& color,
+                                    const Blend& blend)
+{
+  write_command(Command::FILLED_RECT);
+  write_rect(rect);
+  write_color(color);
+  write_blend(blend);
+}
+
+void
+RecordingRenderer::draw_texture(const Texture& texture, const Rect& srcrect,
+                                const Rect& dstrect, float angle,
+                                const Color& color, const Blend& blend)
+{
+  write_command(Command::TEXTURE);
+  write_texture(&texture);
+  write_rect(srcrect);
+  write_rect(dstrect);
+  write_float(angle);
+  write_color(color);
+  write_blend(blend);
+}
+
+void
+RecordingRenderer::draw_text(const std::string& text, const Vector& pos,
+                             const Rect& clip, TextAlign align,
+                             const Font::Handle& font, const Color& color,
+                             const Blend& blend)
+{
+  write_command(Command::TEXT);
+  write_string(text);
+  write_vector(pos);
+  write_rect(clip);
+  m_buffer.push_back(static_cast<uint8_t>(align));
+  write_font(font);
+  write_color(color);
+  write_blend(blend);
+}
+
+void
+RecordingRenderer::draw_line(const Vector& p1, const Vector& p2,
+                             const Color& color, const Blend& blend)
+{
+  write_command(Command::LINE);
+  write_vector(p1);
+  write_vector(p2);
+  write_color(color);
+  write_blend(blend);
+}
+
+void
+RecordingRenderer::draw_lines(const std::vector<Vector>& points,
+                              const Color& color, const Blend& blend)
+{
+  write_command(Command::LINES);
+  write_uint(static_cast<uint32_t>(points.size()));
+  for (const auto& point : points)
+    write_vector(point);
+  write_color(color);
+  write_blend(blend);
+}
+
+void
+RecordingRenderer::start_draw(Texture* texture)
+{
+  Renderer::start_draw(texture);
+
+  write_command(Command::START_DRAW);
+  write_texture(texture);
+}
+
+void
+RecordingRenderer::end_draw()
+{
+  Renderer::end_draw();
+
+  write_command(Command::END_DRAW);
+}
+
+const std::vector<uint8_t>&
+RecordingRenderer::get_buffer() const
+{
+  return m_buffer;
+}
+
+size_t
+RecordingRenderer::get_command_count() const
+{
+  return m_command_count;
+}
+
+const std::vector<RecordingRenderer::TextureInfo>&
+RecordingRenderer::get_textures() const
+{
+  return m_textures;
+}
+
+const std::vector<RecordingRenderer::FontKey>&
+RecordingRenderer::get_fonts() const
+{
+  return m_fonts;
+}
+
+void
+RecordingRenderer::clear()
+{
+  m_buffer.clear();
+  m_command_count = 0;
+}
+
+std::string
+RecordingRenderer::dump() const
+{
+  std::stringstream out;
+  BufferReader in(m_buffer.data(), m_buffer.size());
+
+  while (!in.done())
+  {
+    switch (static_cast<Command>(in.read<uint8_t>()))
+    {
+      case Command::START_DRAW:
+        out << "start_draw("
+            << (in.read<uint32_t>() == NO_TEXTURE ? "nullptr" : "...")
+            << ");\n";
+        break;
+
+      case Command::END_DRAW:
+        out << "end_draw();\n";
+        break;
+
+      case Command::FILLED_RECT:
+      {
+        Rect rect = in.read_rect();
+        Color color = in.read_color();
+        int blend = in.read<int32_t>();
+        out << "draw_filled_rect(" << rect << ", " << color << ", " << blend
+            << ");\n";
+        break;
+      }
+
+      case Command::TEXTURE:
+      {
+        in.read<uint32_t>();
+        Rect srcrect = in.read_rect();
+        Rect dstrect = in.read_rect();
+        float angle = in.read<float>();
+        Color color = in.read_color();
+        int blend = in.read<int32_t>();
+        out << "draw_texture(..., " << srcrect << ", " << dstrect << ", "
+            << angle << ", " << color << ", " << blend << ");\n";
+        break;
+      }
+
+      case Command::TEXT:
+      {
+        std::string text = in.read_string();
+        Vector pos = in.read_vector();
+        Rect clip = in.read_rect();
+        int align = in.read<uint8_t>();
+        const FontKey& font = m_fonts.at(in.read<uint32_t>());
+        Color color = in.read_color();
+        int blend = in.read<int32_t>();
+        out << "draw_text(" << text << ", " << pos << ", " << clip << ", "
+            << align << ", " << font.file << ", " << font.size
+            << (font.sdf ? " sdf, " : ", ")
+            << color << ", " << blend << ");\n";
+        break;
+      }
+
+      case Command::LINE:
+      {
+        Vector p1 = in.read_vector();
+        Vector p2 = in.read_vector();
+        Color color = in.read_color();
+        int blend = in.read<int32_t>();
+        out << "draw_line(" << p1 << ", " << p2 << ", " << color << ", "
+            << blend << ");\n";
+        break;
+      }
+
+      case Command::LINES:
+      {
+        uint32_t count = in.read<uint32_t>();
+        out << "draw_lines({";
+        for (uint32_t i = 0; i < count; i++)
+          out << (i ? ", " : "") << in.read_vector();
+        Color color = in.read_color();
+        int blend = in.read<int32_t>();
+        out << "}, " << color << ", " << blend << ");\n";
+        break;
+      }
+
+      default:
+        throw std::runtime_error("Unknown command in RecordingRenderer "
+                                 "buffer");
+    }
+  }
+
+  return out.str();
+}
+
+void
+RecordingRenderer::write_command(Command command)
+{
+  m_buffer.push_back(static_cast<uint8_t>(command));
+  m_command_count++;
+}
+
+void
+RecordingRenderer::write_float(float f)
+{
+  uint8_t bytes[sizeof(f)];
+  std::memcpy(bytes, &f, sizeof(f));
+  m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(f));
+}
+
+void
+RecordingRenderer::write_int(int32_t i)
+{
+  uint8_t bytes[sizeof(i)];
+  std::memcpy(bytes, &i, sizeof(i));
+  m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(i));
+}
+
+void
+RecordingRenderer::write_uint(uint32_t u)
+{
+  uint8_t bytes[sizeof(u)];
+  std::memcpy(bytes, &u, sizeof(u));
+  m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(u));
+}
+
+void
+RecordingRenderer::write_string(const std::string& str)
+{
+  write_uint(static_cast<uint32_t>(str.size()));
+  m_buffer.insert(m_buffer.end(), str.begin(), str.end());
+}
+
+void
+RecordingRenderer::write_texture(const Texture* texture)
+{
+  if (!texture)
+  {
+    write_uint(NO_TEXTURE);
+    return;
+  }
+
+  // A texture may be freed and another one created at the same address (e.g.
+  // a canvas recreated each frame), so entries are only reused if they still
+  // describe the same texture.
+  auto it = m_texture_indices.find(texture);
+  if (it != m_texture_indices.end())
+  {
+    const auto& info = m_textures[it->second];
+    if (info.file == texture->get_file() && info.size == texture->get_size())
+    {
+      write_uint(it->second);
+      return;
+    }
+  }
+
+  uint32_t index = static_cast<uint32_t>(m_textures.size());
+  m_textures.push_back({ texture, texture->get_file(), texture->get_size() });
+  m_texture_indices[texture] = index;
+  write_uint(index);
+}
+
+void
+RecordingRenderer::write_font(const Font::Handle& font)
+{
+  FontKey key(font.get_file(), font.get_size(), font.is_sdf());
+  auto it = m_font_indices.find(key);
+
+  if (it != m_font_indices.end())
+  {
+    write_uint(it->second);
+    return;
+  }
+
+  uint32_t index = static_cast<uint32_t>(m_fonts.size());
+  m_fonts.push_back(key);
+  m_font_indices[key] = index;
+  write_uint(index);
+}
+
+void
+RecordingRenderer::write_vector(const Vector& v)
+{
+  write_float(v.x);
+  write_float(v.y);
+}
+
+void
+RecordingRenderer::write_rect(const Rect& rect)
+{
+  write_float(rect.x1);
+  write_float(rect.y1);
+  write_float(rect.x2);
+  write_float(rect.y2);
+}
+
+void
+RecordingRenderer::write_color(const Color& color)
+{
+  write_float(color.r);
+  write_float(color.g);
+  write_float(color.b);
+  write_float(color.a);
+}
+
+void
+RecordingRenderer::write_blend(const Blend& blend)
+{
+  write_int(static_cast<int32_t>(blend));
+}
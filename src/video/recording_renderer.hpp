@@ -0,0 +1,150 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_RECORDINGRENDERER_HPP
+#define _HEADER_HARBOR_VIDEO_RECORDINGRENDERER_HPP
+
+#include "video/renderer.hpp"
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include "util/size.hpp"
+
+/**
+ * Renderer that serializes every call it receives into a compact byte buffer
+ * instead of drawing. Like NullRenderer it needs no window.
+ *
+ * Each command is one opcode byte followed by its arguments: floats and
+ * integers in native byte order, strings as a 32-bit length and their bytes.
+ * Textures and fonts are written as indices into get_textures() and
+ * get_fonts(); textures are neither owned nor read.
+ */
+class RecordingRenderer final :
+  public Renderer
+{
+public:
+  enum class Command : uint8_t {
+    START_DRAW,
+    END_DRAW,
+    FILLED_RECT,
+    TEXTURE,
+    TEXT,
+    LINE,
+    LINES
+  };
+
+  /** Font file, point size and SDF mode, as given to draw_text(). */
+  struct FontKey
+  {
+    FontKey();
+    FontKey(const std::string& file, int size, bool sdf = false);
+
+    bool operator<(const FontKey& key) const;
+    bool operator==(const FontKey& key) const;
+
+    std::string file;
+    int size;
+    bool sdf;
+  };
+
+  struct TextureInfo
+  {
+    const Texture* texture;
+    std::string file;
+    Size size;
+  };
+
+  /** Texture index written for start_draw(nullptr). */
+  static const uint32_t NO_TEXTURE = 0xFFFFFFFF;
+
+public:
+  /**
+   * Plays a command buffer back on @p renderer. Recorded texture indices are
+   * looked up in @p textures and font indices in @p fonts.
+   *
+   * @throws std::runtime_error if the buffer is malformed or refers to an
+   *         index out of range.
+   */
+  static void replay(const uint8_t* data, size_t size, Renderer& renderer,
+                     const std::vector<Texture*>& textures,
+                     const std::vector<FontKey>& fonts);
+
+public:
+  RecordingRenderer();
+  virtual ~RecordingRenderer() override = default;
+
+  virtual void draw_filled_rect(const Rect& rect, const Color& color,
+                                const Blend& blend) override;
+  virtual void draw_texture(const Texture& texture, const Rect& srcrect,
+                            const Rect& dstrect, float angle,
+                            const Color& color, const Blend& blend) override;
+  virtual void draw_text(const std::string& text, const Vector& pos,
+                         const Rect& clip, TextAlign align,
+                         const Font::Handle& font, const Color& color,
+                         const Blend& blend) override;
+  virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
+                         const Blend& blend) override;
+  virtual void draw_lines(const std::vector<Vector>& points, const Color& color,
+                          const Blend& blend) override;
+  virtual void start_draw(Texture* texture = nullptr) override;
+  virtual void end_draw() override;
+
+  const std::vector<uint8_t>& get_buffer() const;
+  size_t get_command_count() const;
+  const std::vector<TextureInfo>& get_textures() const;
+  const std::vector<FontKey>& get_fonts() const;
+
+  /**
+   * Discards the recorded commands. The texture and font tables are kept, so
+   * that indices stay consistent across buffers from the same renderer.
+   */
+  void clear();
+
+  /**
+   * Decodes the buffer into one line of text per command, for example
+   * "draw_line(Vector(0, 0), Vector(1, 1), Color(1, 1, 1, 1), 1);".
+   */
+  std::string dump() const;
+
+private:
+  void write_command(Command command);
+  void write_float(float f);
+  void write_int(int32_t i);
+  void write_uint(uint32_t u);
+  void write_string(const std::string& str);
+  void write_texture(const Texture* texture);
+  void write_font(const Font::Handle& font);
+  void write_vector(const Vector& v);
+  void write_rect(const Rect& rect);
+  void write_color(const Color& color);
+  void write_blend(const Blend& blend);
+
+private:
+  std::vector<uint8_t> m_buffer;
+  size_t m_command_count;
+  std::vector<TextureInfo> m_textures;
+  std::unordered_map<const Texture*, uint32_t> m_texture_indices;
+  std::vector<FontKey> m_fonts;
+  std::map<FontKey, uint32_t> m_font_indices;
+
+private:
+  RecordingRenderer(const RecordingRenderer&) = delete;
+  RecordingRenderer& operator=(const RecordingRenderer&) = delete;
+};
+
+#endif
@@ -16,18 +16,115 @@
 
 #include "video/renderer.hpp"
 
+#include <cmath>
 #include <stdexcept>
 
 #include "util/size.hpp"
 #include "util/vector.hpp"
+#include "video/drawing_context.hpp"
 #include "video/font.hpp"
+#include "video/window.hpp"
 
 Rect
 Renderer::get_text_rect(const std::string& font, int size, 
                         const std::string& text, const Vector& pos,
                         Renderer::TextAlign align)
 {
-  auto surface = get_font_surface(Font::get_font(font, size), text);
+  return get_text_rect(Font::get_handle(font, size), text, pos, align);
+}
+
+Rect
+Renderer::get_text_rect(const Font::Handle& font, const std::string& text,
+                        const Vector& pos, Renderer::TextAlign align)
+{
+  auto& f = Font::get_font(font);
+
+  // SDF handles of any size share the font at the reference size
+  Size text_size = f.get_text_size(text) * get_text_scale(font, f);
+
+  return Rect(align_text(text_size, pos, align), text_size);
+}
+
+float
+Renderer::get_line_height(const Font::Handle& font)
+{
+  auto& f = Font::get_font(font);
+  return static_cast<float>(f.get_line_skip()) * get_text_scale(font, f);
+}
+
+void
+Renderer::get_caret_offsets(const Font::Handle& font, const std::string& text,
+                            std::vector<float>& offsets)
+{
+  auto& f = Font::get_font(font);
+  f.get_caret_offsets(text, offsets);
+
+  const float scale = get_text_scale(font, f);
+  if (scale != 1.f)
+    for (auto& offset : offsets)
+      offset *= scale;
+}
+
+void
+Renderer::layout_glyphs(Font& font, const std::string& text, const Vector& pos,
+                        TextAlign align, const Rect& clip,
+                        std::vector<Font::GlyphQuad>& quads, float scale)
+{
+  const std::string* shown = &text;
+
+  if (Font::get_rasterizer() &&
+      font.get_placeholder() == Font::Placeholder::PREVIOUS)
+  {
+    auto& previous = m_previous_texts[TextSlot(font.get_id(), pos.x, pos.y,
+                                               static_cast<int>(align))];
+    previous.frame = m_frame;
+
+    if (font.is_text_ready(text))
+      previous.text = text;
+    else if (!previous.text.empty())
+      shown = &previous.text;
+  }
+
+  Size size = font.layout_text(*shown, quads) * scale;
+
+  // Glyphs are drawn on whole pixels to stay sharp
+  Vector corner = align_text(size, pos, align);
+  corner = Vector(std::floor(corner.x), std::floor(corner.y));
+
+  size_t visible = 0;
+  for (auto& quad : quads)
+  {
+    if (scale != 1.f)
+    {
+      quad.dstrect = Rect(quad.dstrect.x1 * scale, quad.dstrect.y1 * scale,
+                          quad.dstrect.x2 * scale, quad.dstrect.y2 * scale);
+    }
+
+    quad.dstrect.move(corner);
+    quad.srcrect = DrawingContext::clip_src_rect(quad.srcrect, quad.dstrect,
+                                                 clip);
+    quad.dstrect.clip(clip);
+
+    if (quad.srcrect.is_valid() && !quad.srcrect.is_null() &&
+        quad.dstrect.is_valid() && !quad.dstrect.is_null())
+    {
+      quads[visible++] = quad;
+    }
+  }
+
+  quads.resize(visible);
+}
+
+float
+Renderer::get_text_scale(const Font::Handle& handle, const Font& font)
+{
+  return static_cast<float>(handle.get_size())
+         / static_cast<float>(font.get_size());
+}
+
+Vector
+Renderer::align_text(const Size& size, const Vector& pos, TextAlign align)
+{
   Vector corner = pos;
 
   switch(align) {
@@ -35,53 +132,55 @@ Renderer::get_text_rect(const std::string& font, int size,
       break;
 
     case TextAlign::TOP_MID:
-      corner.x -= surface->w / 2;
+      corner.x -= size.w / 2;
       break;
 
     case TextAlign::TOP_RIGHT:
-      corner.x -= surface->w;
+      corner.x -= size.w;
       break;
 
     case TextAlign::MID_LEFT:
-      corner.y -= surface->h / 2;
+      corner.y -= size.h / 2;
       break;
 
     case TextAlign::CENTER:
-      corner.x -= surface->w / 2;
-      corner.y -= surface->h / 2;
+      corner.x -= size.w / 2;
+      corner.y -= size.h / 2;
       break;
 
     case TextAlign::MID_RIGHT:
-      corner.x -= surface->w;
-      corner.y -= surface->h / 2;
+      corner.x -= size.w;
+      corner.y -= size.h / 2;
       break;
 
     case TextAlign::BOTTOM_LEFT:
-      corner.y -= surface->h;
+      corner.y -= size.h;
       break;
 
     case TextAlign::BOTTOM_MID:
-      corner.x -= surface->w / 2;
-      corner.y -= surface->h;
+      corner.x -= size.w / 2;
+      corner.y -= size.h;
       break;
 
     case TextAlign::BOTTOM_RIGHT:
-      corner.x -= surface->w;
-      corner.y -= surface->h;
+      corner.x -= size.w;
+      corner.y -= size.h;
       break;
   }
 
-  return Rect(corner, Size(surface->w, surface->h));
+  return corner;
 }
 
-SDL_Surface*
-Renderer::get_font_surface(Font& font, const std::string& text)
+void
+Renderer::draw_lines(const std::vector<Vector>& points, const Color& color,
+                     const Blend& blend)
 {
-  return font.get_sdl_surface(text);
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+    draw_line(points[i], points[i + 1], color, blend);
 }
 
 void
-Renderer::start_draw(Texture* /* texture */)
+Renderer::start_draw(Texture* texture)
 {
   if (m_drawing)
   {
@@ -90,6 +189,15 @@ Renderer::start_draw(Texture* /* texture */)
   }
 
   m_drawing = true;
+  m_drawing_window = !texture;
+
+  m_retired_ids.clear();
+  Font::get_retired_ids(m_retired_cursor, m_retired_ids);
+  for (unsigned font_id : m_retired_ids)
+    release_font(font_id);
+
+  if (m_drawing_window && m_window)
+    m_window->upload_textures();
 }
 
 void
@@ -102,12 +210,43 @@ Renderer::end_draw()
   }
 
   m_drawing = false;
+
+  // Texts that weren't drawn in this frame don't hold their slot anymore
+  if (m_drawing_window)
+  {
+    for (auto it = m_previous_texts.begin(); it != m_previous_texts.end();)
+    {
+      if (it->second.frame != m_frame)
+        it = m_previous_texts.erase(it);
+      else
+        ++it;
+    }
+
+    m_frame++;
+  }
+}
+
+void
+Renderer::release_font(unsigned /* font_id */)
+{
 }
 
 Window&
 Renderer::get_window() const
 {
-  return m_window;
+  if (!m_window)
+  {
+    throw std::runtime_error("Called Renderer::get_window() on renderer "
+                             "without a window");
+  }
+
+  return *m_window;
+}
+
+bool
+Renderer::has_window() const
+{
+  return m_window != nullptr;
 }
 
 bool
@@ -117,7 +256,23 @@ Renderer::is_drawing() const
 }
 
 Renderer::Renderer(Window& window) :
-  m_window(window),
-  m_drawing(false)
+  m_window(&window),
+  m_drawing(false),
+  m_drawing_window(false),
+  m_frame(0),
+  m_previous_texts(),
+  m_retired_cursor(0),
+  m_retired_ids()
+{
+}
+
+Renderer::Renderer() :
+  m_window(nullptr),
+  m_drawing(false),
+  m_drawing_window(false),
+  m_frame(0),
+  m_previous_texts(),
+  m_retired_cursor(0),
+  m_retired_ids()
 {
 }
@@ -17,15 +17,18 @@
 #ifndef _HEADER_HARBOR_VIDEO_RENDERER_HPP
 #define _HEADER_HARBOR_VIDEO_RENDERER_HPP
 
+#include <map>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "SDL.h"
 
 #include "util/rect.hpp"
+#include "video/font.hpp"
 
 class Blend;
 class Color;
-class Font;
 class Texture;
 class Vector;
 class Window;
@@ -54,12 +57,53 @@ public:
   };
 
 public:
+  /** Same as get_text_rect(Font::get_handle(font, size), text, pos, align). */
   static Rect get_text_rect(const std::string& font, int size,
                             const std::string& text, const Vector& pos,
                             TextAlign align);
+  /**
+   * Measures @p text from the font metrics; nothing is rasterized, so layout
+   * passes can call it freely.
+   */
+  static Rect get_text_rect(const Font::Handle& font, const std::string& text,
+                            const Vector& pos, TextAlign align);
+  /** @returns The distance between two baselines of text, in pixels. */
+  static float get_line_height(const Font::Handle& font);
+  /** Font::get_caret_offsets(), scaled to the size of @p font. */
+  static void get_caret_offsets(const Font::Handle& font,
+                                const std::string& text,
+                                std::vector<float>& offsets);
 
 protected:
-  static SDL_Surface* get_font_surface(Font& font, const std::string& text);
+  /**
+   * Lays out @p text to be drawn from the glyph atlas of @p font. For each
+   * visible glyph, @p quads receives its rect in Font::get_atlas() and where
+   * to draw it, aligned on @p pos and clipped to @p clip. Glyph positions
+   * and sizes are multiplied by @p scale, for SDF fonts.
+   *
+   * While glyphs are rasterized in the background, this applies the
+   * placeholder policy of the font.
+   */
+  void layout_glyphs(Font& font, const std::string& text, const Vector& pos,
+                     TextAlign align, const Rect& clip,
+                     std::vector<Font::GlyphQuad>& quads, float scale = 1.f);
+
+  /**
+   * Frees what the renderer keeps for the font @p font_id, such as its glyph
+   * atlas. Called by start_draw() once the font is destroyed, e. g. by
+   * Font::flush_fonts() or a reload; IDs are never reused.
+   */
+  virtual void release_font(unsigned font_id);
+
+  /**
+   * @returns How much glyphs of @p font must be scaled to be drawn at the size
+   *          of @p handle; 1 except for SDF fonts.
+   */
+  static float get_text_scale(const Font::Handle& handle, const Font& font);
+
+  /** @returns The top-left corner of text of size @p size aligned on @p pos. */
+  static Vector align_text(const Size& size, const Vector& pos,
+                           TextAlign align);
 
 public:
   virtual ~Renderer() = default;
@@ -71,22 +115,56 @@ public:
                             const Color& color, const Blend& blend) = 0;
   virtual void draw_text(const std::string& text, const Vector& pos,
                          const Rect& clip, TextAlign align,
-                         const std::string& fontfile, int size,
-                         const Color& color, const Blend& blend) = 0;
+                         const Font::Handle& font, const Color& color,
+                         const Blend& blend) = 0;
   virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
                          const Blend& blend) = 0;
+  /**
+   * Draws many independent line segments at once. @p points holds the
+   * endpoints of each segment in pairs; a trailing unpaired point is ignored.
+   *
+   * The default implementation forwards each segment to draw_line(); backends
+   * should override it to submit the whole batch in one go.
+   */
+  virtual void draw_lines(const std::vector<Vector>& points, const Color& color,
+                          const Blend& blend);
   virtual void start_draw(Texture* texture = nullptr);
   virtual void end_draw();
 
+  /**
+   * @throws std::runtime_error if the renderer isn't bound to a window.
+   */
   Window& get_window() const;
+  bool has_window() const;
   bool is_drawing() const;
 
 protected:
   Renderer(Window& window);
+  /** For renderers that don't draw to a window, such as NullRenderer. */
+  Renderer();
+
+private:
+  /** Font ID, position and alignment of a text drawn in a frame. */
+  typedef std::tuple<unsigned, float, float, int> TextSlot;
+
+  struct PreviousText
+  {
+    std::string text;
+    unsigned frame;
+  };
 
 private:
-  Window& m_window;
+  Window* m_window;
   bool m_drawing;
+  bool m_drawing_window;
+  /** Counts the frames drawn to the window. */
+  unsigned m_frame;
+  /** Last ready text of each slot, for Font::Placeholder::PREVIOUS. */
+  std::map<TextSlot, PreviousText> m_previous_texts;
+  /** Position in Font::get_retired_ids() up to which fonts were released. */
+  size_t m_retired_cursor;
+  /** Reused by start_draw() to avoid allocating every frame. */
+  std::vector<unsigned> m_retired_ids;
 
 private:
   Renderer(const Renderer&) = delete;
@@ -17,6 +17,7 @@
 #include "video/sdl/sdl_renderer.hpp"
 
 #include <stdexcept>
+#include <vector>
 
 #include "SDL.h"
 
@@ -30,7 +31,9 @@
 
 SDLRenderer::SDLRenderer(SDLWindow& window) :
   Renderer(window),
-  m_sdl_renderer(SDL_CreateRenderer(window.get_sdl_window(), -1, 0))
+  m_sdl_renderer(SDL_CreateRenderer(window.get_sdl_window(), -1, 0)),
+  m_atlases(),
+  m_glyph_quads()
 {
   if (!m_sdl_renderer)
   {
@@ -41,6 +44,9 @@ SDLRenderer::SDLRenderer(SDLWindow& window) :
 
 SDLRenderer::~SDLRenderer()
 {
+  for (const auto& atlas : m_atlases)
+    SDL_DestroyTexture(atlas.second.texture);
+
   SDL_DestroyRenderer(m_sdl_renderer);
 }
 
@@ -118,8 +124,8 @@ SDLRenderer::draw_texture(const Texture& texture, const Rect& srcrect,
 void
 SDLRenderer::draw_text(const std::string& text, const Vector& pos,
                        const Rect& clip, TextAlign align,
-                       const std::string& fontfile, int size,
-                       const Color& color, const Blend& blend)
+                       const Font::Handle& handle, const Color& color,
+                       const Blend& blend)
 {
   if (!is_drawing())
   {
@@ -130,10 +136,18 @@ SDLRenderer::draw_text(const std::string& text, const Vector& pos,
   if (text.empty())
     return;
 
-  auto& font = Font::get_font(fontfile, size);
+  // SDL_Renderer has no programmable stage to threshold distance fields, so
+  // SDF text is drawn with the bitmap font of the same size instead
+  auto& font = Font::get_font(handle.is_sdf()
+                              ? Font::get_handle(handle.get_file(),
+                                                 handle.get_size())
+                              : handle);
+  layout_glyphs(font, text, pos, align, clip, m_glyph_quads);
+
+  if (m_glyph_quads.empty())
+    return;
 
-  SDL_Surface* surface = get_font_surface(font, text);
-  SDL_Texture* texture = SDL_CreateTextureFromSurface(m_sdl_renderer, surface);
+  SDL_Texture* texture = get_atlas_texture(font);
 
   SDL_SetTextureColorMod(texture,
                          static_cast<Uint8>(color.r * 255.f),
@@ -142,70 +156,23 @@ SDLRenderer::draw_text(const std::string& text, const Vector& pos,
   SDL_SetTextureBlendMode(texture, static_cast<SDL_BlendMode>(blend));
   SDL_SetTextureAlphaMod(texture, static_cast<Uint8>(color.a * 255.f));
 
-  SDL_Rect dst;
-  dst.x = static_cast<int>(pos.x);
-  dst.y = static_cast<int>(pos.y);
-  dst.w = surface->w;
-  dst.h = surface->h;
-
-  switch(align) {
-    case TextAlign::TOP_LEFT:
-      break;
-
-    case TextAlign::TOP_MID:
-      dst.x -= surface->w / 2.f;
-      break;
-
-    case TextAlign::TOP_RIGHT:
-      dst.x -= surface->w;
-      break;
-
-    case TextAlign::MID_LEFT:
-      dst.y -= surface->h / 2.f;
-      break;
-
-    case TextAlign::CENTER:
-      dst.x -= surface->w / 2.f;
-      dst.y -= surface->h / 2.f;
-      break;
-
-    case TextAlign::MID_RIGHT:
-      dst.x -= surface->w;
-      dst.y -= surface->h / 2.f;
-      break;
-
-    case TextAlign::BOTTOM_LEFT:
-      dst.y -= surface->h;
-      break;
-
-    case TextAlign::BOTTOM_MID:
-      dst.x -= surface->w / 2.f;
-      dst.y -= surface->h;
-      break;
-
-    case TextAlign::BOTTOM_RIGHT:
-      dst.x -= surface->w;
-      dst.y -= surface->h;
-      break;
+  // SDL batches consecutive copies from the same texture into one draw call
+  for (const auto& quad : m_glyph_quads)
+  {
+    SDL_Rect src;
+    src.x = static_cast<int>(quad.srcrect.x1);
+    src.y = static_cast<int>(quad.srcrect.y1);
+    src.w = static_cast<int>(quad.srcrect.width());
+    src.h = static_cast<int>(quad.srcrect.height());
+
+    SDL_FRect dst;
+    dst.x = quad.dstrect.x1;
+    dst.y = quad.dstrect.y1;
+    dst.w = quad.dstrect.width();
+    dst.h = quad.dstrect.height();
+
+    SDL_RenderCopyF(m_sdl_renderer, texture, &src, &dst);
   }
-
-  Rect srcrect(Vector(), Size(surface->w, surface->h));
-  Rect dstrect(Vector(dst.x, dst.y), Size(dst.w, dst.h));
-  srcrect = DrawingContext::clip_src_rect(srcrect, dstrect, clip);
-
-  SDL_Rect src;
-  src.x = static_cast<int>(srcrect.x1);
-  src.y = static_cast<int>(srcrect.y1);
-  src.w = static_cast<int>(srcrect.width());
-  src.h = static_cast<int>(srcrect.height());
-
-  dstrect.clip(clip);
-  dst.x = dstrect.x1;
-  dst.y = dstrect.y1;
-  dst.w = dstrect.width();
-  dst.h = dstrect.height();
-
-  SDL_RenderCopy(m_sdl_renderer, texture, &src, &dst);
 }
 
 void
@@ -228,10 +195,55 @@ SDLRenderer::draw_line(const Vector& p1, const Vector& p2, const Color& color,
   SDL_RenderDrawLineF(m_sdl_renderer, p1.x, p1.y, p2.x, p2.y);
 }
 
+void
+SDLRenderer::draw_lines(const std::vector<Vector>& points, const Color& color,
+                        const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SDLRenderer::draw_lines while not "
+                             "drawing");
+  }
+
+  SDL_SetRenderDrawColor(m_sdl_renderer,
+                         static_cast<Uint8>(color.r * 255.f),
+                         static_cast<Uint8>(color.g * 255.f),
+                         static_cast<Uint8>(color.b * 255.f),
+                         static_cast<Uint8>(color.a * 255.f));
+  SDL_SetRenderDrawBlendMode(m_sdl_renderer, static_cast<SDL_BlendMode>(blend));
+
+  // Segments that continue where the previous one ended are merged into a
+  // single strip, so that polylines reach SDL as one SDL_RenderDrawLinesF call.
+  std::vector<SDL_FPoint> strip;
+  strip.reserve(points.size());
+
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+  {
+    const Vector& p1 = points[i];
+    const Vector& p2 = points[i + 1];
+
+    if (strip.empty() || strip.back().x != p1.x || strip.back().y != p1.y)
+    {
+      if (strip.size() > 1)
+        SDL_RenderDrawLinesF(m_sdl_renderer, strip.data(),
+                             static_cast<int>(strip.size()));
+
+      strip.clear();
+      strip.push_back({ p1.x, p1.y });
+    }
+
+    strip.push_back({ p2.x, p2.y });
+  }
+
+  if (strip.size() > 1)
+    SDL_RenderDrawLinesF(m_sdl_renderer, strip.data(),
+                         static_cast<int>(strip.size()));
+}
+
 void
 SDLRenderer::start_draw(Texture* texture)
 {
-  Renderer::start_draw();
+  Renderer::start_draw(texture);
 
   auto* sdl_texture = dynamic_cast<SDLTexture*>(texture);
 
@@ -269,3 +281,50 @@ SDLRenderer::get_sdl_renderer() const
 {
   return m_sdl_renderer;
 }
+
+void
+SDLRenderer::release_font(unsigned font_id)
+{
+  auto it = m_atlases.find(font_id);
+  if (it == m_atlases.end())
+    return;
+
+  SDL_DestroyTexture(it->second.texture);
+  m_atlases.erase(it);
+}
+
+SDL_Texture*
+SDLRenderer::get_atlas_texture(Font& font)
+{
+  SDL_Surface* surface = font.get_atlas();
+  auto& atlas = m_atlases[font.get_id()];
+
+  if (atlas.texture && atlas.version == font.get_atlas_version())
+    return atlas.texture;
+
+  int w = 0, h = 0;
+  if (atlas.texture)
+    SDL_QueryTexture(atlas.texture, nullptr, nullptr, &w, &h);
+
+  if (!atlas.texture || w != surface->w || h != surface->h)
+  {
+    if (atlas.texture)
+      SDL_DestroyTexture(atlas.texture);
+
+    atlas.texture = SDL_CreateTexture(m_sdl_renderer, SDL_PIXELFORMAT_RGBA32,
+                                      SDL_TEXTUREACCESS_STATIC, surface->w,
+                                      surface->h);
+
+    if (!atlas.texture)
+    {
+      std::string error(SDL_GetError());
+      throw std::runtime_error("Could not create glyph atlas texture: "
+                               + error);
+    }
+  }
+
+  SDL_UpdateTexture(atlas.texture, nullptr, surface->pixels, surface->pitch);
+  atlas.version = font.get_atlas_version();
+
+  return atlas.texture;
+}
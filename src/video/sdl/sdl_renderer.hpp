@@ -19,6 +19,9 @@
 
 #include "video/renderer.hpp"
 
+#include <unordered_map>
+#include <vector>
+
 class SDLWindow;
 
 class SDLRenderer final :
@@ -36,17 +39,36 @@ public:
                             const Color& color, const Blend& blend) override;
   virtual void draw_text(const std::string& text, const Vector& pos,
                          const Rect& clip, TextAlign align,
-                         const std::string& fontfile, int size,
-                         const Color& color, const Blend& blend) override;
+                         const Font::Handle& font, const Color& color,
+                         const Blend& blend) override;
   virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
                          const Blend& blend) override;
+  virtual void draw_lines(const std::vector<Vector>& points, const Color& color,
+                          const Blend& blend) override;
   virtual void start_draw(Texture* texture = nullptr) override;
   virtual void end_draw() override;
 
   SDL_Renderer* get_sdl_renderer() const;
 
+protected:
+  virtual void release_font(unsigned font_id) override;
+
+private:
+  struct AtlasTexture
+  {
+    SDL_Texture* texture;
+    unsigned version;
+  };
+
+private:
+  /** Uploads the glyph atlas of @p font if it changed since the last call. */
+  SDL_Texture* get_atlas_texture(Font& font);
+
 private:
   SDL_Renderer* m_sdl_renderer;
+  /** Glyph atlas textures, by font ID. */
+  std::unordered_map<unsigned, AtlasTexture> m_atlases;
+  std::vector<Font::GlyphQuad> m_glyph_quads;
 
 private:
   SDLRenderer(const SDLRenderer&) = delete;
@@ -24,6 +24,9 @@
 #include "SDL.h"
 #include "SDL_image.h"
 
+#include "util/archive.hpp"
+#include "video/texture_file.hpp"
+
 SDLTexture::SDLTexture(SDLWindow& window, const Size& size) :
   Texture(size),
   m_renderer(window.get_sdlrenderer()),
@@ -41,9 +44,10 @@ SDLTexture::SDLTexture(SDLWindow& window, const Size& size) :
 }
 
 SDLTexture::SDLTexture(SDLWindow& window, const std::string& file) :
-  Texture(Size()),
+  Texture(Size(), file),
   m_renderer(window.get_sdlrenderer()),
-  m_sdl_texture(IMG_LoadTexture(m_renderer.get_sdl_renderer(), file.c_str()))
+  m_sdl_texture(IMG_LoadTexture_RW(m_renderer.get_sdl_renderer(),
+                                   Archive::open_rw(file), 1))
 {
   if (!m_sdl_texture)
   {
@@ -57,6 +61,30 @@ SDLTexture::SDLTexture(SDLWindow& window, const std::string& file) :
   m_size.h = static_cast<float>(h);
 }
 
+SDLTexture::SDLTexture(SDLWindow& window, SDL_Surface* surface,
+                       const std::string& file) :
+  Texture(Size(static_cast<float>(surface->w), static_cast<float>(surface->h)),
+          file),
+  m_renderer(window.get_sdlrenderer()),
+  m_sdl_texture(SDL_CreateTextureFromSurface(m_renderer.get_sdl_renderer(),
+                                             surface))
+{
+  if (!m_sdl_texture)
+  {
+    throw std::runtime_error("Could not create SDL Texture: " +
+                              std::string(SDL_GetError()));
+  }
+}
+
+SDLTexture::SDLTexture(SDLWindow& window, const TextureFile& image,
+                       const std::string& file) :
+  Texture(Size(), file),
+  m_renderer(window.get_sdlrenderer()),
+  m_sdl_texture(nullptr)
+{
+  m_sdl_texture = upload(image);
+}
+
 SDLTexture::~SDLTexture()
 {
   if (m_sdl_texture)
@@ -70,3 +98,71 @@ SDLTexture::get_sdl_texture() const
 {
   return m_sdl_texture;
 }
+
+void
+SDLTexture::replace(SDL_Surface* surface)
+{
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(
+                                          m_renderer.get_sdl_renderer(),
+                                          surface);
+
+  if (!texture)
+  {
+    throw std::runtime_error("Could not replace SDL Texture: " +
+                              std::string(SDL_GetError()));
+  }
+
+  if (m_sdl_texture)
+    SDL_DestroyTexture(m_sdl_texture);
+
+  m_sdl_texture = texture;
+  m_size.w = static_cast<float>(surface->w);
+  m_size.h = static_cast<float>(surface->h);
+}
+
+void
+SDLTexture::replace(const TextureFile& image)
+{
+  SDL_Texture* texture = upload(image);
+
+  if (m_sdl_texture)
+    SDL_DestroyTexture(m_sdl_texture);
+
+  m_sdl_texture = texture;
+}
+
+SDL_Texture*
+SDLTexture::upload(const TextureFile& image)
+{
+  if (image.get_format() != TextureFile::Format::RGBA32)
+  {
+    throw std::runtime_error("SDLTexture can't upload the format of: "
+                             + m_file);
+  }
+
+  const auto& level = image.get_levels()[0];
+
+  SDL_Texture* texture = SDL_CreateTexture(m_renderer.get_sdl_renderer(),
+                                           SDL_PIXELFORMAT_RGBA32,
+                                           SDL_TEXTUREACCESS_STATIC,
+                                           static_cast<int>(level.width),
+                                           static_cast<int>(level.height));
+
+  if (!texture)
+  {
+    throw std::runtime_error("Could not create SDL Texture: " +
+                              std::string(SDL_GetError()));
+  }
+
+  if (SDL_UpdateTexture(texture, nullptr, level.pixels,
+                        static_cast<int>(level.pitch)) != 0)
+  {
+    SDL_DestroyTexture(texture);
+    throw std::runtime_error("Could not upload SDL Texture: " +
+                              std::string(SDL_GetError()));
+  }
+
+  m_size.w = static_cast<float>(level.width);
+  m_size.h = static_cast<float>(level.height);
+  return texture;
+}
@@ -23,6 +23,7 @@
 
 #include "video/sdl/sdl_renderer.hpp"
 
+class TextureFile;
 struct SDL_Renderer;
 struct SDL_Surface;
 struct SDL_Texture;
@@ -36,10 +37,26 @@ class SDLTexture final :
 public:
   SDLTexture(SDLWindow& window, const Size& size);
   SDLTexture(SDLWindow& window, const std::string& file);
+  /** Uploads @p surface, which the caller keeps ownership of. */
+  SDLTexture(SDLWindow& window, SDL_Surface* surface, const std::string& file);
+  /**
+   * Uploads the full-size level of @p image straight from its pixels, into a
+   * texture of the same format (SDL_PIXELFORMAT_RGBA32), so that SDL doesn't
+   * convert or copy them first. SDL has no use for the other levels.
+   */
+  SDLTexture(SDLWindow& window, const TextureFile& image,
+             const std::string& file);
   virtual ~SDLTexture() override;
 
   SDL_Texture* get_sdl_texture() const;
 
+  virtual void replace(SDL_Surface* surface) override;
+  virtual void replace(const TextureFile& image) override;
+
+private:
+  /** @returns A new texture holding the full-size level of @p image. */
+  SDL_Texture* upload(const TextureFile& image);
+
 private:
   SDLRenderer& m_renderer;
   SDL_Texture* m_sdl_texture;
@@ -22,6 +22,7 @@
 
 #include "SDL_image.h"
 
+#include "util/archive.hpp"
 #include "util/vector.hpp"
 #include "video/sdl/sdl_texture.hpp"
 
@@ -55,25 +56,30 @@ SDLWindow::~SDLWindow()
   SDL_DestroyWindow(m_sdl_window);
 }
 
-Texture&
-SDLWindow::load_texture(const std::string& file)
+std::shared_ptr<Texture>
+SDLWindow::create_texture(const Size& size)
 {
-  const auto& texture_ptr = m_texture_cache[std::string(file)];
+  return std::make_shared<SDLTexture>(*this, size);
+}
 
-  if (!texture_ptr)
-  {
-    auto new_texture = std::make_unique<SDLTexture>(*this, file);
-    m_texture_cache[std::string(file)] = std::move(new_texture);
-    return *m_texture_cache[std::string(file)];
-  }
+std::shared_ptr<Texture>
+SDLWindow::create_texture_from_surface(SDL_Surface* surface,
+                                       const std::string& file)
+{
+  return std::make_shared<SDLTexture>(*this, surface, file);
+}
 
-  return *texture_ptr;
+std::shared_ptr<Texture>
+SDLWindow::create_texture_from_file(const std::string& file)
+{
+  return std::make_shared<SDLTexture>(*this, file);
 }
 
 std::shared_ptr<Texture>
-SDLWindow::create_texture(const Size& size)
+SDLWindow::create_texture_from_image(const TextureFile& image,
+                                     const std::string& file)
 {
-  return std::make_shared<SDLTexture>(*this, size);
+  return std::make_shared<SDLTexture>(*this, image, file);
 }
 
 Renderer&
@@ -253,7 +259,7 @@ SDLWindow::set_icon(const std::string& filename)
 {
   m_icon_path = filename;
 
-  SDL_Surface* surface = IMG_Load(filename.c_str());
+  SDL_Surface* surface = IMG_Load_RW(Archive::open_rw(filename), 1);
 
   if (!surface)
   {
@@ -30,8 +30,16 @@ public:
   SDLWindow(const Size& size = Size(640, 400), bool visible = true);
   virtual ~SDLWindow();
 
-  virtual Texture& load_texture(const std::string& file) override;
   virtual std::shared_ptr<Texture> create_texture(const Size& size) override;
+  virtual std::shared_ptr<Texture> create_texture_from_surface(
+                                SDL_Surface* surface,
+                                const std::string& file) override;
+  virtual std::shared_ptr<Texture> create_texture_from_file(
+                                const std::string& file) override;
+  /** Uploads the full-size level of @p image, with no conversion. */
+  virtual std::shared_ptr<Texture> create_texture_from_image(
+                                const TextureFile& image,
+                                const std::string& file) override;
   virtual Renderer& get_renderer() override;
 
   virtual std::string get_title() const override;
@@ -0,0 +1,247 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/software/software_blend.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HARBOR_SOFTWARE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "util/color.hpp"
+
+namespace {
+
+/** Rounded a * b / 255, exact for all 8-bit inputs. */
+inline uint32_t
+mul255(uint32_t a, uint32_t b)
+{
+  uint32_t x = a * b + 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+inline uint8_t
+to_byte(float f)
+{
+  return static_cast<uint8_t>(f <= 0.f ? 0 : (f >= 1.f ? 255 : f * 255.f));
+}
+
+#if HARBOR_SOFTWARE_SSE2
+/** 16-bit lanes variant of mul255(). */
+inline __m128i
+mul255_epi16(__m128i a, __m128i b)
+{
+  __m128i x = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/** Copies the alpha lane of each of the two pixels to all of its lanes. */
+inline __m128i
+broadcast_alpha(__m128i px)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)),
+                             _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+/** Blends two pixels, unpacked to 16-bit lanes. */
+inline __m128i
+blend2(__m128i s, __m128i d, Renderer::Blend blend)
+{
+  const __m128i alpha_lanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i full = _mm_set1_epi16(255);
+
+  switch (blend)
+  {
+    case Renderer::Blend::NONE:
+      return s;
+
+    case Renderer::Blend::BLEND:
+    {
+      __m128i a = broadcast_alpha(s);
+      // Source factor is (a, a, a, 1), destination factor is (1 - a) for all
+      __m128i sf = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), alpha_lanes);
+      __m128i df = _mm_sub_epi16(full, a);
+      return _mm_add_epi16(mul255_epi16(s, sf), mul255_epi16(d, df));
+    }
+
+    case Renderer::Blend::ADD:
+    {
+      // Source factor is (a, a, a, 0); the saturating pack clamps overflows
+      __m128i sf = _mm_andnot_si128(alpha_lanes, broadcast_alpha(s));
+      return _mm_add_epi16(mul255_epi16(s, sf), d);
+    }
+
+    case Renderer::Blend::MODULATE:
+      // Multiplying with a source alpha forced to 1 keeps the destination's
+      return mul255_epi16(_mm_or_si128(s, alpha_lanes), d);
+  }
+
+  return s;
+}
+
+/** Blends four packed pixels. */
+inline __m128i
+blend4(__m128i src, __m128i dst, __m128i mod, bool modulate,
+       Renderer::Blend blend)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i s_lo = _mm_unpacklo_epi8(src, zero);
+  __m128i s_hi = _mm_unpackhi_epi8(src, zero);
+
+  if (modulate)
+  {
+    s_lo = mul255_epi16(s_lo, mod);
+    s_hi = mul255_epi16(s_hi, mod);
+  }
+
+  __m128i lo = blend2(s_lo, _mm_unpacklo_epi8(dst, zero), blend);
+  __m128i hi = blend2(s_hi, _mm_unpackhi_epi8(dst, zero), blend);
+
+  return _mm_packus_epi16(lo, hi);
+}
+
+inline __m128i
+unpack_mod(uint32_t mod)
+{
+  return _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(mod)),
+                           _mm_setzero_si128());
+}
+#endif
+
+} // namespace
+
+uint32_t
+SoftwareBlend::pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+  const uint8_t bytes[4] = { r, g, b, a };
+  uint32_t pixel;
+  std::memcpy(&pixel, bytes, sizeof(pixel));
+  return pixel;
+}
+
+uint32_t
+SoftwareBlend::pack(const Color& color)
+{
+  return pack(to_byte(color.r), to_byte(color.g), to_byte(color.b),
+              to_byte(color.a));
+}
+
+void
+SoftwareBlend::unpack(uint32_t pixel, uint8_t& r, uint8_t& g, uint8_t& b,
+                      uint8_t& a)
+{
+  uint8_t bytes[4];
+  std::memcpy(bytes, &pixel, sizeof(pixel));
+  r = bytes[0];
+  g = bytes[1];
+  b = bytes[2];
+  a = bytes[3];
+}
+
+void
+SoftwareBlend::fill(uint32_t* dst, size_t count, uint32_t color,
+                    Renderer::Blend blend)
+{
+  size_t i = 0;
+
+#if HARBOR_SOFTWARE_SSE2
+  const __m128i src = _mm_set1_epi32(static_cast<int>(color));
+  const __m128i mod = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+    _mm_storeu_si128(p, blend4(src, _mm_loadu_si128(p), mod, false, blend));
+  }
+#endif
+
+  span_scalar(dst + i, &color, count - i, 0, pack(255, 255, 255, 255), blend);
+}
+
+void
+SoftwareBlend::span(uint32_t* dst, const uint32_t* src, size_t count,
+                    uint32_t mod, Renderer::Blend blend)
+{
+  size_t i = 0;
+
+#if HARBOR_SOFTWARE_SSE2
+  const bool modulate = mod != pack(255, 255, 255, 255);
+  const __m128i mod16 = unpack_mod(mod);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(p, blend4(s, _mm_loadu_si128(p), mod16, modulate, blend));
+  }
+#endif
+
+  span_scalar(dst + i, src + i, count - i, 1, mod, blend);
+}
+
+void
+SoftwareBlend::span_scalar(uint32_t* dst, const uint32_t* src, size_t count,
+                           size_t src_step, uint32_t mod, Renderer::Blend blend)
+{
+  uint8_t mr, mg, mb, ma;
+  unpack(mod, mr, mg, mb, ma);
+
+  for (size_t i = 0; i < count; i++, src += src_step)
+  {
+    uint8_t sr, sg, sb, sa, dr, dg, db, da;
+    unpack(*src, sr, sg, sb, sa);
+    unpack(dst[i], dr, dg, db, da);
+
+    uint32_t r = mul255(sr, mr), g = mul255(sg, mg), b = mul255(sb, mb),
+             a = mul255(sa, ma);
+
+    switch (blend)
+    {
+      case Renderer::Blend::NONE:
+        break;
+
+      case Renderer::Blend::BLEND:
+        r = mul255(r, a) + mul255(dr, 255 - a);
+        g = mul255(g, a) + mul255(dg, 255 - a);
+        b = mul255(b, a) + mul255(db, 255 - a);
+        a = a + mul255(da, 255 - a);
+        break;
+
+      case Renderer::Blend::ADD:
+        r = mul255(r, a) + dr;
+        g = mul255(g, a) + dg;
+        b = mul255(b, a) + db;
+        a = da;
+        break;
+
+      case Renderer::Blend::MODULATE:
+        r = mul255(r, dr);
+        g = mul255(g, dg);
+        b = mul255(b, db);
+        a = da;
+        break;
+    }
+
+    dst[i] = pack(static_cast<uint8_t>(r > 255 ? 255 : r),
+                  static_cast<uint8_t>(g > 255 ? 255 : g),
+                  static_cast<uint8_t>(b > 255 ? 255 : b),
+                  static_cast<uint8_t>(a > 255 ? 255 : a));
+  }
+}
@@ -0,0 +1,62 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWAREBLEND_HPP
+#define _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWAREBLEND_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "video/renderer.hpp"
+
+class Color;
+
+/**
+ * Pixel blending kernels for the software renderer. Pixels are 32-bit values
+ * with the bytes laid out in memory as R, G, B, A (SDL_PIXELFORMAT_RGBA32).
+ *
+ * The kernels follow the equations SDL documents for each SDL_BlendMode, and
+ * process four pixels per iteration with SSE2 when the compiler targets it.
+ */
+class SoftwareBlend final
+{
+public:
+  static uint32_t pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+  static uint32_t pack(const Color& color);
+  static void unpack(uint32_t pixel, uint8_t& r, uint8_t& g, uint8_t& b,
+                     uint8_t& a);
+
+  /**
+   * Blends @p count copies of @p color onto @p dst.
+   */
+  static void fill(uint32_t* dst, size_t count, uint32_t color,
+                   Renderer::Blend blend);
+
+  /**
+   * Blends @p count pixels from @p src onto @p dst, after multiplying each
+   * source channel with the matching channel of @p mod (color and alpha
+   * modulation, as done by SDL_SetTextureColorMod/SDL_SetTextureAlphaMod).
+   */
+  static void span(uint32_t* dst, const uint32_t* src, size_t count,
+                   uint32_t mod, Renderer::Blend blend);
+
+  /** Same as span(), without any SIMD; used for tails and as a reference. */
+  static void span_scalar(uint32_t* dst, const uint32_t* src, size_t count,
+                          size_t src_step, uint32_t mod,
+                          Renderer::Blend blend);
+};
+
+#endif
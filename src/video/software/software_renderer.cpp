@@ -0,0 +1,503 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/software/software_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "make_unique.hpp"
+
+#include "SDL.h"
+
+#include "util/color.hpp"
+#include "util/rect.hpp"
+#include "util/vector.hpp"
+#include "video/drawing_context.hpp"
+#include "video/font.hpp"
+#include "video/software/software_blend.hpp"
+#include "video/software/software_texture.hpp"
+#include "video/software/software_window.hpp"
+
+#ifndef M_PI
+#define M_PI 3.1415926535898
+#endif
+
+namespace {
+
+/**
+ * Index of the first pixel whose center lies at or after @p edge. A pixel is
+ * covered by a shape if its center is within the shape, like in SDL.
+ */
+inline int
+first_pixel(float edge)
+{
+  return static_cast<int>(std::ceil(edge - .5f));
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(SoftwareWindow& window) :
+  Renderer(window),
+  m_software_window(window),
+  m_target(nullptr),
+  m_row(),
+  m_atlases(),
+  m_glyph_quads()
+{
+}
+
+void
+SoftwareRenderer::draw_filled_rect(const Rect& rect, const Color& color,
+                                   const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SoftwareRenderer::draw_filled_rect "
+                             "while not drawing");
+  }
+
+  int x1 = std::max(first_pixel(rect.x1), 0);
+  int y1 = std::max(first_pixel(rect.y1), 0);
+  int x2 = std::min(first_pixel(rect.x2), m_target->get_width());
+  int y2 = std::min(first_pixel(rect.y2), m_target->get_height());
+
+  if (x1 >= x2 || y1 >= y2)
+    return;
+
+  uint32_t pixel = SoftwareBlend::pack(color);
+  uint32_t* pixels = m_target->get_pixels();
+  const int width = m_target->get_width();
+
+  for (int y = y1; y < y2; y++)
+  {
+    SoftwareBlend::fill(pixels + y * width + x1, static_cast<size_t>(x2 - x1),
+                        pixel, blend);
+  }
+}
+
+void
+SoftwareRenderer::draw_texture(const Texture& texture, const Rect& srcrect,
+                               const Rect& dstrect, float angle,
+                               const Color& color, const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SoftwareRenderer::draw_texture while "
+                             "not drawing");
+  }
+
+  const SoftwareTexture* t = dynamic_cast<const SoftwareTexture*>(&texture);
+
+  if (!t)
+  {
+    throw std::runtime_error("Attempt to use SoftwareRenderer::draw_texture() "
+                             "with a non-software texture");
+  }
+
+  blit(*t, srcrect, dstrect, angle, SoftwareBlend::pack(color), blend);
+}
+
+void
+SoftwareRenderer::draw_text(const std::string& text, const Vector& pos,
+                            const Rect& clip, TextAlign align,
+                            const Font::Handle& handle, const Color& color,
+                            const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SoftwareRenderer::draw_text while not "
+                             "drawing");
+  }
+
+  if (text.empty())
+    return;
+
+  auto& font = Font::get_font(handle);
+  const float scale = get_text_scale(handle, font);
+  layout_glyphs(font, text, pos, align, clip, m_glyph_quads, scale);
+
+  if (m_glyph_quads.empty())
+    return;
+
+  const SoftwareTexture& atlas = get_atlas_texture(font);
+  const uint32_t mod = SoftwareBlend::pack(color);
+
+  for (const auto& quad : m_glyph_quads)
+  {
+    if (font.is_sdf())
+      blit_sdf(atlas, quad.srcrect, quad.dstrect, scale, mod, blend);
+    else
+      blit(atlas, quad.srcrect, quad.dstrect, 0.f, mod, blend);
+  }
+}
+
+void
+SoftwareRenderer::draw_line(const Vector& p1, const Vector& p2,
+                            const Color& color, const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SoftwareRenderer::draw_line while not "
+                             "drawing");
+  }
+
+  plot_line(p1, p2, SoftwareBlend::pack(color), blend);
+}
+
+void
+SoftwareRenderer::draw_lines(const std::vector<Vector>& points,
+                             const Color& color, const Blend& blend)
+{
+  if (!is_drawing())
+  {
+    throw std::runtime_error("Call to SoftwareRenderer::draw_lines while not "
+                             "drawing");
+  }
+
+  uint32_t pixel = SoftwareBlend::pack(color);
+
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+    plot_line(points[i], points[i + 1], pixel, blend);
+}
+
+void
+SoftwareRenderer::start_draw(Texture* texture)
+{
+  Renderer::start_draw(texture);
+
+  auto* software_texture = dynamic_cast<SoftwareTexture*>(texture);
+
+  if (texture && !software_texture)
+  {
+    throw std::runtime_error("Attempt to call SoftwareRenderer::start_draw() "
+                             "with non-null but non-software texture");
+  }
+
+  m_target = texture ? software_texture : &m_software_window.get_back_buffer();
+}
+
+void
+SoftwareRenderer::end_draw()
+{
+  Renderer::end_draw();
+
+  if (m_target == &m_software_window.get_back_buffer())
+  {
+    m_software_window.present();
+  }
+
+  m_target = nullptr;
+}
+
+void
+SoftwareRenderer::release_font(unsigned font_id)
+{
+  m_atlases.erase(font_id);
+}
+
+const SoftwareTexture&
+SoftwareRenderer::get_atlas_texture(Font& font)
+{
+  auto& atlas = m_atlases[font.get_id()];
+
+  if (!atlas.texture)
+  {
+    atlas.texture = std::make_unique<SoftwareTexture>(font.get_atlas());
+  }
+  else if (atlas.version != font.get_atlas_version())
+  {
+    atlas.texture->load_surface(font.get_atlas());
+  }
+
+  atlas.version = font.get_atlas_version();
+  return *atlas.texture;
+}
+
+void
+SoftwareRenderer::blit(const SoftwareTexture& texture, const Rect& srcrect,
+                       const Rect& dstrect, float angle, uint32_t mod,
+                       Blend blend)
+{
+  if (texture.get_width() == 0 || texture.get_height() == 0 ||
+      dstrect.width() <= 0.f || dstrect.height() <= 0.f)
+    return;
+
+  const int target_w = m_target->get_width();
+  const int target_h = m_target->get_height();
+  uint32_t* target = m_target->get_pixels();
+  const uint32_t* source = texture.get_pixels();
+
+  // Source texels per destination pixel
+  const float step_x = srcrect.width() / dstrect.width();
+  const float step_y = srcrect.height() / dstrect.height();
+
+  const int src_x1 = std::max(static_cast<int>(srcrect.x1), 0);
+  const int src_y1 = std::max(static_cast<int>(srcrect.y1), 0);
+  const int src_x2 = std::min(static_cast<int>(std::ceil(srcrect.x2)),
+                              texture.get_width()) - 1;
+  const int src_y2 = std::min(static_cast<int>(std::ceil(srcrect.y2)),
+                              texture.get_height()) - 1;
+
+  if (src_x1 > src_x2 || src_y1 > src_y2)
+    return;
+
+  if (angle == 0.f)
+  {
+    int x1 = std::max(first_pixel(dstrect.x1), 0);
+    int y1 = std::max(first_pixel(dstrect.y1), 0);
+    int x2 = std::min(first_pixel(dstrect.x2), target_w);
+    int y2 = std::min(first_pixel(dstrect.y2), target_h);
+
+    if (x1 >= x2 || y1 >= y2)
+      return;
+
+    const size_t count = static_cast<size_t>(x2 - x1);
+
+    // Unscaled, pixel-aligned blits read straight from the source rows
+    const float sx1 = srcrect.x1 + (static_cast<float>(x1) + .5f - dstrect.x1)
+                                   * step_x;
+    const bool direct = step_x == 1.f && sx1 - std::floor(sx1) == .5f &&
+                        static_cast<int>(sx1) >= src_x1 &&
+                        static_cast<int>(sx1) + static_cast<int>(count) - 1
+                          <= src_x2;
+
+    if (!direct)
+      m_row.resize(count);
+
+    for (int y = y1; y < y2; y++)
+    {
+      float sy = srcrect.y1 + (static_cast<float>(y) + .5f - dstrect.y1)
+                              * step_y;
+      int ty = std::min(std::max(static_cast<int>(sy), src_y1), src_y2);
+      const uint32_t* src_row = source + ty * texture.get_width();
+
+      if (direct)
+      {
+        SoftwareBlend::span(target + y * target_w + x1,
+                            src_row + static_cast<int>(sx1), count, mod, blend);
+        continue;
+      }
+
+      float sx = sx1;
+      for (size_t i = 0; i < count; i++, sx += step_x)
+      {
+        int tx = std::min(std::max(static_cast<int>(sx), src_x1), src_x2);
+        m_row[i] = src_row[tx];
+      }
+
+      SoftwareBlend::span(target + y * target_w + x1, m_row.data(), count,
+                          mod, blend);
+    }
+
+    return;
+  }
+
+  // Rotated blits map every pixel of the bounding box back into the
+  // destination rectangle; SDL rotates clockwise around the center.
+  const Vector center = dstrect.mid();
+  const float rad = angle * static_cast<float>(M_PI) / 180.f;
+  const float cos_a = std::cos(rad), sin_a = std::sin(rad);
+  const float half_w = dstrect.width() / 2.f, half_h = dstrect.height() / 2.f;
+  const float extent_x = std::abs(half_w * cos_a) + std::abs(half_h * sin_a);
+  const float extent_y = std::abs(half_w * sin_a) + std::abs(half_h * cos_a);
+
+  int x1 = std::max(first_pixel(center.x - extent_x), 0);
+  int y1 = std::max(first_pixel(center.y - extent_y), 0);
+  int x2 = std::min(first_pixel(center.x + extent_x), target_w);
+  int y2 = std::min(first_pixel(center.y + extent_y), target_h);
+
+  if (x1 >= x2 || y1 >= y2)
+    return;
+
+  m_row.resize(static_cast<size_t>(x2 - x1));
+
+  for (int y = y1; y < y2; y++)
+  {
+    const float py = static_cast<float>(y) + .5f - center.y;
+
+    // The rectangle is convex, so the covered pixels of a row are contiguous
+    int run_start = -1, run_length = 0;
+
+    for (int x = x1; x < x2; x++)
+    {
+      const float px = static_cast<float>(x) + .5f - center.x;
+      const float lx = px * cos_a + py * sin_a + half_w;
+      const float ly = -px * sin_a + py * cos_a + half_h;
+
+      if (lx < 0.f || ly < 0.f || lx >= dstrect.width() ||
+          ly >= dstrect.height())
+      {
+        if (run_start >= 0)
+          break;
+
+        continue;
+      }
+
+      if (run_start < 0)
+        run_start = x;
+
+      int tx = std::min(std::max(static_cast<int>(srcrect.x1 + lx * step_x),
+                                 src_x1), src_x2);
+      int ty = std::min(std::max(static_cast<int>(srcrect.y1 + ly * step_y),
+                                 src_y1), src_y2);
+      m_row[static_cast<size_t>(run_length++)] = source[ty * texture.get_width()
+                                                        + tx];
+    }
+
+    if (run_length > 0)
+    {
+      SoftwareBlend::span(target + y * target_w + run_start, m_row.data(),
+                          static_cast<size_t>(run_length), mod, blend);
+    }
+  }
+}
+
+void
+SoftwareRenderer::blit_sdf(const SoftwareTexture& atlas, const Rect& srcrect,
+                           const Rect& dstrect, float scale, uint32_t mod,
+                           Blend blend)
+{
+  if (atlas.get_width() == 0 || atlas.get_height() == 0 ||
+      dstrect.width() <= 0.f || dstrect.height() <= 0.f)
+    return;
+
+  const int target_w = m_target->get_width();
+  const int target_h = m_target->get_height();
+  uint32_t* target = m_target->get_pixels();
+  const uint32_t* source = atlas.get_pixels();
+  const int source_w = atlas.get_width();
+
+  const float step_x = srcrect.width() / dstrect.width();
+  const float step_y = srcrect.height() / dstrect.height();
+
+  // Bilinear samples stay within the glyph so neighbours don't bleed in
+  const float min_x = srcrect.x1, max_x = srcrect.x2 - 1.f;
+  const float min_y = srcrect.y1, max_y = srcrect.y2 - 1.f;
+
+  if (max_x < min_x || max_y < min_y)
+    return;
+
+  int x1 = std::max(first_pixel(dstrect.x1), 0);
+  int y1 = std::max(first_pixel(dstrect.y1), 0);
+  int x2 = std::min(first_pixel(dstrect.x2), target_w);
+  int y2 = std::min(first_pixel(dstrect.y2), target_h);
+
+  if (x1 >= x2 || y1 >= y2)
+    return;
+
+  const size_t count = static_cast<size_t>(x2 - x1);
+  m_row.resize(count);
+
+  // An alpha of 0.5 is the edge and every 1 / (2 * spread) away from it is
+  // one pixel at the reference size, hence scale pixels on the target.
+  const float sharpness = 2.f * static_cast<float>(Font::SDF_SPREAD) * scale;
+
+  auto alpha = [source, source_w](int x, int y) {
+    uint8_t r, g, b, a;
+    SoftwareBlend::unpack(source[y * source_w + x], r, g, b, a);
+    return static_cast<float>(a) / 255.f;
+  };
+
+  for (int y = y1; y < y2; y++)
+  {
+    float sy = srcrect.y1 + (static_cast<float>(y) + .5f - dstrect.y1) * step_y
+               - .5f;
+    sy = std::min(std::max(sy, min_y), max_y);
+    const int ty = static_cast<int>(sy);
+    const int ty2 = std::min(ty + 1, static_cast<int>(max_y));
+    const float fy = sy - static_cast<float>(ty);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      float sx = srcrect.x1 + (static_cast<float>(x1 + static_cast<int>(i))
+                               + .5f - dstrect.x1) * step_x - .5f;
+      sx = std::min(std::max(sx, min_x), max_x);
+      const int tx = static_cast<int>(sx);
+      const int tx2 = std::min(tx + 1, static_cast<int>(max_x));
+      const float fx = sx - static_cast<float>(tx);
+
+      const float top = alpha(tx, ty) * (1.f - fx) + alpha(tx2, ty) * fx;
+      const float bottom = alpha(tx, ty2) * (1.f - fx) + alpha(tx2, ty2) * fx;
+      const float distance = top * (1.f - fy) + bottom * fy;
+
+      const float coverage = std::min(std::max(.5f + (distance - .5f)
+                                                     * sharpness, 0.f), 1.f);
+      m_row[i] = SoftwareBlend::pack(255, 255, 255,
+                                     static_cast<uint8_t>(coverage * 255.f
+                                                          + .5f));
+    }
+
+    SoftwareBlend::span(target + y * target_w + x1, m_row.data(), count, mod,
+                        blend);
+  }
+}
+
+void
+SoftwareRenderer::plot_line(const Vector& p1, const Vector& p2, uint32_t color,
+                            Blend blend)
+{
+  const int target_w = m_target->get_width();
+  const int target_h = m_target->get_height();
+
+  // Clipping first keeps far off-screen lines from stepping through pixels
+  // that would all be discarded anyway.
+  Rect bounds(-1.f, -1.f, static_cast<float>(target_w) + 1.f,
+              static_cast<float>(target_h) + 1.f);
+  auto clipped = bounds.clip_line(p1, p2);
+
+  // Rect::clip_line() returns two null vectors for lines entirely outside
+  if (clipped.first == Vector() && clipped.second == Vector() &&
+      !(p1 == Vector() && p2 == Vector()))
+    return;
+
+  if (!bounds.contains(clipped.first) || !bounds.contains(clipped.second))
+    return;
+
+  int x = static_cast<int>(std::floor(clipped.first.x));
+  int y = static_cast<int>(std::floor(clipped.first.y));
+  const int x_end = static_cast<int>(std::floor(clipped.second.x));
+  const int y_end = static_cast<int>(std::floor(clipped.second.y));
+
+  // Bresenham, endpoints included as SDL_RenderDrawLine does
+  const int dx = std::abs(x_end - x), sx = x < x_end ? 1 : -1;
+  const int dy = -std::abs(y_end - y), sy = y < y_end ? 1 : -1;
+  int err = dx + dy;
+  uint32_t* pixels = m_target->get_pixels();
+
+  while (true)
+  {
+    if (x >= 0 && y >= 0 && x < target_w && y < target_h)
+      SoftwareBlend::fill(pixels + y * target_w + x, 1, color, blend);
+
+    if (x == x_end && y == y_end)
+      break;
+
+    int e2 = 2 * err;
+    if (e2 >= dy)
+    {
+      err += dy;
+      x += sx;
+    }
+    if (e2 <= dx)
+    {
+      err += dx;
+      y += sy;
+    }
+  }
+}
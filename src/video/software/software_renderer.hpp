@@ -0,0 +1,99 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWARERENDERER_HPP
+#define _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWARERENDERER_HPP
+
+#include "video/renderer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "video/software/software_texture.hpp"
+
+class SoftwareWindow;
+
+/**
+ * Renderer that rasterizes on the CPU into a SoftwareTexture. It needs neither
+ * a display nor a GPU, which makes it suitable for servers, CI and tests.
+ */
+class SoftwareRenderer final :
+  public Renderer
+{
+public:
+  SoftwareRenderer() = delete;
+  SoftwareRenderer(SoftwareWindow& window);
+  virtual ~SoftwareRenderer() override = default;
+
+  virtual void draw_filled_rect(const Rect& rect, const Color& color,
+                                const Blend& blend) override;
+  virtual void draw_texture(const Texture& texture, const Rect& srcrect,
+                            const Rect& dstrect, float angle,
+                            const Color& color, const Blend& blend) override;
+  virtual void draw_text(const std::string& text, const Vector& pos,
+                         const Rect& clip, TextAlign align,
+                         const Font::Handle& font, const Color& color,
+                         const Blend& blend) override;
+  virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
+                         const Blend& blend) override;
+  virtual void draw_lines(const std::vector<Vector>& points, const Color& color,
+                          const Blend& blend) override;
+  virtual void start_draw(Texture* texture = nullptr) override;
+  virtual void end_draw() override;
+
+protected:
+  virtual void release_font(unsigned font_id) override;
+
+private:
+  struct AtlasTexture
+  {
+    std::unique_ptr<SoftwareTexture> texture;
+    unsigned version;
+  };
+
+private:
+  /** Converts the glyph atlas of @p font if it changed since the last call. */
+  const SoftwareTexture& get_atlas_texture(Font& font);
+  void blit(const SoftwareTexture& texture, const Rect& srcrect,
+            const Rect& dstrect, float angle, uint32_t mod, Blend blend);
+  /**
+   * Draws a glyph of an SDF atlas magnified by @p scale, turning the
+   * bilinearly sampled distance into coverage around the 0.5 threshold.
+   */
+  void blit_sdf(const SoftwareTexture& atlas, const Rect& srcrect,
+                const Rect& dstrect, float scale, uint32_t mod, Blend blend);
+  void plot_line(const Vector& p1, const Vector& p2, uint32_t color,
+                 Blend blend);
+
+private:
+  SoftwareWindow& m_software_window;
+  SoftwareTexture* m_target;
+
+  /** Scratch row for scaled and rotated blits, kept to avoid reallocating. */
+  std::vector<uint32_t> m_row;
+
+  /** Glyph atlas textures, by font ID. */
+  std::unordered_map<unsigned, AtlasTexture> m_atlases;
+  std::vector<Font::GlyphQuad> m_glyph_quads;
+
+private:
+  SoftwareRenderer(const SoftwareRenderer&) = delete;
+  SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+};
+
+#endif
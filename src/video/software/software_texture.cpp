@@ -0,0 +1,154 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/software/software_texture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "SDL.h"
+#include "SDL_image.h"
+
+#include "util/archive.hpp"
+
+SoftwareTexture::SoftwareTexture(const Size& size) :
+  Texture(size),
+  m_width(static_cast<int>(size.w)),
+  m_height(static_cast<int>(size.h)),
+  m_pixels(static_cast<size_t>(m_width > 0 && m_height > 0
+                               ? m_width * m_height : 0), 0)
+{
+}
+
+SoftwareTexture::SoftwareTexture(const std::string& file) :
+  Texture(Size(), file),
+  m_width(0),
+  m_height(0),
+  m_pixels()
+{
+  SDL_Surface* surface = IMG_Load_RW(Archive::open_rw(file), 1);
+
+  if (!surface)
+  {
+    throw std::runtime_error("Could not load software texture: " +
+                             std::string(IMG_GetError()));
+  }
+
+  try
+  {
+    load_surface(surface);
+  }
+  catch (...)
+  {
+    SDL_FreeSurface(surface);
+    throw;
+  }
+
+  SDL_FreeSurface(surface);
+}
+
+SoftwareTexture::SoftwareTexture(SDL_Surface* surface,
+                                 const std::string& file) :
+  Texture(Size(), file),
+  m_width(0),
+  m_height(0),
+  m_pixels()
+{
+  load_surface(surface);
+}
+
+int
+SoftwareTexture::get_width() const
+{
+  return m_width;
+}
+
+int
+SoftwareTexture::get_height() const
+{
+  return m_height;
+}
+
+uint32_t*
+SoftwareTexture::get_pixels()
+{
+  return m_pixels.data();
+}
+
+const uint32_t*
+SoftwareTexture::get_pixels() const
+{
+  return m_pixels.data();
+}
+
+uint32_t
+SoftwareTexture::get_pixel(int x, int y) const
+{
+  if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+    throw std::runtime_error("Software texture pixel out of bounds");
+
+  return m_pixels[static_cast<size_t>(y * m_width + x)];
+}
+
+void
+SoftwareTexture::clear()
+{
+  std::fill(m_pixels.begin(), m_pixels.end(), 0);
+}
+
+void
+SoftwareTexture::replace(SDL_Surface* surface)
+{
+  load_surface(surface);
+}
+
+void
+SoftwareTexture::load_surface(SDL_Surface* surface)
+{
+  // Pre-decoded textures are already in the right format
+  bool convert = surface->format->format != SDL_PIXELFORMAT_RGBA32;
+  SDL_Surface* converted = convert
+                         ? SDL_ConvertSurfaceFormat(surface,
+                                                    SDL_PIXELFORMAT_RGBA32, 0)
+                         : surface;
+
+  if (!converted)
+  {
+    throw std::runtime_error("Could not convert surface for software texture: "
+                             + std::string(SDL_GetError()));
+  }
+
+  m_width = converted->w;
+  m_height = converted->h;
+  m_size = Size(static_cast<float>(m_width), static_cast<float>(m_height));
+  m_pixels.resize(static_cast<size_t>(m_width * m_height));
+
+  SDL_LockSurface(converted);
+
+  for (int y = 0; y < m_height; y++)
+  {
+    std::memcpy(m_pixels.data() + y * m_width,
+                static_cast<const uint8_t*>(converted->pixels)
+                  + y * converted->pitch,
+                static_cast<size_t>(m_width) * sizeof(uint32_t));
+  }
+
+  SDL_UnlockSurface(converted);
+
+  if (convert)
+    SDL_FreeSurface(converted);
+}
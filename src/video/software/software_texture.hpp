@@ -0,0 +1,65 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWARETEXTURE_HPP
+#define _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWARETEXTURE_HPP
+
+#include "video/texture.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SDL_Surface;
+
+/**
+ * Texture stored in system memory, as 32-bit RGBA pixels (see SoftwareBlend).
+ */
+class SoftwareTexture final :
+  public Texture
+{
+public:
+  SoftwareTexture(const Size& size);
+  SoftwareTexture(const std::string& file);
+  SoftwareTexture(SDL_Surface* surface,
+                  const std::string& file = std::string());
+  virtual ~SoftwareTexture() override = default;
+
+  int get_width() const;
+  int get_height() const;
+  uint32_t* get_pixels();
+  const uint32_t* get_pixels() const;
+  uint32_t get_pixel(int x, int y) const;
+
+  /** Sets all pixels to fully transparent black. */
+  void clear();
+
+  /** Replaces the contents with those of @p surface, in any pixel format. */
+  void load_surface(SDL_Surface* surface);
+  using Texture::replace;
+  virtual void replace(SDL_Surface* surface) override;
+
+private:
+  int m_width;
+  int m_height;
+  std::vector<uint32_t> m_pixels;
+
+private:
+  SoftwareTexture(const SoftwareTexture&) = delete;
+  SoftwareTexture& operator=(const SoftwareTexture&) = delete;
+};
+
+#endif
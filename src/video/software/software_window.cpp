@@ -0,0 +1,196 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "video/software/software_window.hpp"
+
+#include <stdexcept>
+
+#include "make_unique.hpp"
+
+SoftwareWindow::SoftwareWindow(const Size& size, bool visible) :
+  m_title(),
+  m_size(size),
+  m_visible(visible),
+  m_pos(),
+  m_bordered(true),
+  m_resizable(false),
+  m_status(Status::NORMAL),
+  m_opacity(1.f),
+  m_icon_path(),
+  m_back_buffer(std::make_unique<SoftwareTexture>(size)),
+  m_frame(std::make_unique<SoftwareTexture>(size)),
+  m_renderer(*this)
+{
+}
+
+std::shared_ptr<Texture>
+SoftwareWindow::create_texture(const Size& size)
+{
+  return std::make_shared<SoftwareTexture>(size);
+}
+
+std::shared_ptr<Texture>
+SoftwareWindow::create_texture_from_surface(SDL_Surface* surface,
+                                            const std::string& file)
+{
+  return std::make_shared<SoftwareTexture>(surface, file);
+}
+
+std::shared_ptr<Texture>
+SoftwareWindow::create_texture_from_file(const std::string& file)
+{
+  return std::make_shared<SoftwareTexture>(file);
+}
+
+Renderer&
+SoftwareWindow::get_renderer()
+{
+  return m_renderer;
+}
+
+std::string
+SoftwareWindow::get_title() const
+{
+  return m_title;
+}
+
+Size
+SoftwareWindow::get_size() const
+{
+  return m_size;
+}
+
+bool
+SoftwareWindow::get_visible() const
+{
+  return m_visible;
+}
+
+Vector
+SoftwareWindow::get_pos() const
+{
+  return m_pos;
+}
+
+bool
+SoftwareWindow::get_bordered() const
+{
+  return m_bordered;
+}
+
+bool
+SoftwareWindow::get_resizable() const
+{
+  return m_resizable;
+}
+
+Window::Status
+SoftwareWindow::get_status() const
+{
+  return m_status;
+}
+
+float
+SoftwareWindow::get_opacity() const
+{
+  return m_opacity;
+}
+
+std::string
+SoftwareWindow::get_icon() const
+{
+  return m_icon_path;
+}
+
+void
+SoftwareWindow::set_size(const Size& size)
+{
+  if (m_renderer.is_drawing())
+  {
+    throw std::runtime_error("Cannot resize software window while drawing");
+  }
+
+  m_size = size;
+  m_back_buffer = std::make_unique<SoftwareTexture>(size);
+  m_frame = std::make_unique<SoftwareTexture>(size);
+}
+
+void
+SoftwareWindow::set_title(const std::string& title)
+{
+  m_title = title;
+}
+
+void
+SoftwareWindow::set_visible(bool visible)
+{
+  m_visible = visible;
+}
+
+void
+SoftwareWindow::set_pos(Vector pos)
+{
+  m_pos = pos;
+}
+
+void
+SoftwareWindow::set_bordered(bool bordered)
+{
+  m_bordered = bordered;
+}
+
+void
+SoftwareWindow::set_resizable(bool resizable)
+{
+  m_resizable = resizable;
+}
+
+void
+SoftwareWindow::set_status(Status status)
+{
+  m_status = status;
+}
+
+void
+SoftwareWindow::set_icon(const std::string& file)
+{
+  m_icon_path = file;
+}
+
+void
+SoftwareWindow::set_opacity(float opacity)
+{
+  m_opacity = opacity;
+}
+
+SoftwareTexture&
+SoftwareWindow::get_back_buffer()
+{
+  return *m_back_buffer;
+}
+
+const SoftwareTexture&
+SoftwareWindow::get_frame() const
+{
+  return *m_frame;
+}
+
+void
+SoftwareWindow::present()
+{
+  std::swap(m_back_buffer, m_frame);
+  m_back_buffer->clear();
+}
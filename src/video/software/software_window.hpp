@@ -0,0 +1,93 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWAREWINDOW_HPP
+#define _HEADER_HARBOR_VIDEO_SOFTWARE_SOFTWAREWINDOW_HPP
+
+#include "video/window.hpp"
+
+#include "util/vector.hpp"
+#include "video/software/software_renderer.hpp"
+#include "video/software/software_texture.hpp"
+
+/**
+ * Headless window: nothing is shown on screen. Each frame drawn to the window
+ * is kept in memory and can be read back with get_frame().
+ */
+class SoftwareWindow final :
+  public Window
+{
+public:
+  SoftwareWindow(const Size& size = Size(640, 400), bool visible = true);
+  virtual ~SoftwareWindow() = default;
+
+  virtual std::shared_ptr<Texture> create_texture(const Size& size) override;
+  virtual std::shared_ptr<Texture> create_texture_from_surface(
+                                SDL_Surface* surface,
+                                const std::string& file) override;
+  virtual std::shared_ptr<Texture> create_texture_from_file(
+                                const std::string& file) override;
+  virtual Renderer& get_renderer() override;
+
+  virtual std::string get_title() const override;
+  virtual Size get_size() const override;
+  virtual bool get_visible() const override;
+  virtual Vector get_pos() const override;
+  virtual bool get_bordered() const override;
+  virtual bool get_resizable() const override;
+  virtual Status get_status() const override;
+  virtual float get_opacity() const override;
+  virtual std::string get_icon() const override;
+
+  virtual void set_size(const Size& size) override;
+  virtual void set_title(const std::string& title) override;
+  virtual void set_visible(bool visible) override;
+  virtual void set_pos(Vector pos) override;
+  virtual void set_bordered(bool bordered) override;
+  virtual void set_resizable(bool resizable) override;
+  virtual void set_status(Status status) override;
+  virtual void set_icon(const std::string& file) override;
+  virtual void set_opacity(float opacity) override;
+
+  /** The buffer being drawn to; cleared each time a frame is presented. */
+  SoftwareTexture& get_back_buffer();
+
+  /** The last frame that was fully drawn to the window. */
+  const SoftwareTexture& get_frame() const;
+
+  /** Makes the back buffer the current frame and starts a new one. */
+  void present();
+
+private:
+  std::string m_title;
+  Size m_size;
+  bool m_visible;
+  Vector m_pos;
+  bool m_bordered;
+  bool m_resizable;
+  Status m_status;
+  float m_opacity;
+  std::string m_icon_path;
+  std::unique_ptr<SoftwareTexture> m_back_buffer;
+  std::unique_ptr<SoftwareTexture> m_frame;
+  SoftwareRenderer m_renderer;
+
+private:
+  SoftwareWindow(const SoftwareWindow&) = delete;
+  SoftwareWindow& operator=(const SoftwareWindow&) = delete;
+};
+
+#endif
@@ -16,8 +16,21 @@
 
 #include "video/texture.hpp"
 
+#include <stdexcept>
+
+#include "SDL.h"
+
+#include "video/texture_file.hpp"
+
 Texture::Texture(const Size& size) :
-  m_size(size)
+  m_size(size),
+  m_file()
+{
+}
+
+Texture::Texture(const Size& size, const std::string& file) :
+  m_size(size),
+  m_file(file)
 {
 }
 
@@ -26,3 +39,39 @@ Texture::get_size() const
 {
   return m_size;
 }
+
+const std::string&
+Texture::get_file() const
+{
+  return m_file;
+}
+
+void
+Texture::replace(SDL_Surface* /* surface */)
+{
+  throw std::runtime_error("This texture can't be replaced");
+}
+
+void
+Texture::replace(const TextureFile& image)
+{
+  SDL_Surface* surface = image.create_surface();
+
+  try
+  {
+    replace(surface);
+  }
+  catch (...)
+  {
+    SDL_FreeSurface(surface);
+    throw;
+  }
+
+  SDL_FreeSurface(surface);
+}
+
+size_t
+Texture::get_memory_size() const
+{
+  return static_cast<size_t>(m_size.w) * static_cast<size_t>(m_size.h) * 4;
+}
@@ -17,9 +17,14 @@
 #ifndef _HEADER_HARBOR_VIDEO_TEXTURE_HPP
 #define _HEADER_HARBOR_VIDEO_TEXTURE_HPP
 
+#include <cstddef>
+#include <string>
+
 #include "util/size.hpp"
 
 class Renderer;
+class TextureFile;
+struct SDL_Surface;
 
 /**
  * Class that represents a readable texture.
@@ -31,12 +36,36 @@ public:
 
 protected:
   Texture(const Size& size);
+  Texture(const Size& size, const std::string& file);
 
 public:
   Size get_size() const;
 
+  /**
+   * @returns The file the texture was loaded from, or an empty string for
+   *          textures created from scratch (e.g. render targets).
+   */
+  const std::string& get_file() const;
+
+  /** @returns An estimate of the memory the texture uses, as RGBA32 pixels. */
+  size_t get_memory_size() const;
+
+  /**
+   * Replaces the contents of the texture with @p surface, which the caller
+   * keeps ownership of. The size follows that of the surface. Textures that
+   * can't be replaced throw.
+   */
+  virtual void replace(SDL_Surface* surface);
+
+  /**
+   * Replaces the contents of the texture with those of @p image. By default,
+   * only the full-size level is used, through replace(SDL_Surface*).
+   */
+  virtual void replace(const TextureFile& image);
+
 protected:
   Size m_size;
+  std::string m_file;
 
 private:
   Texture(const Texture&) = delete;
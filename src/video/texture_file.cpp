@@ -0,0 +1,246 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "video/texture_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "make_unique.hpp"
+
+#include "SDL.h"
+
+#include "util/archive.hpp"
+
+// Layout, in native byte order:
+//   "HTEX", uint32 version, uint32 format, uint32 level count
+//   level count * { uint32 width, uint32 height, uint32 pitch,
+//                   uint32 reserved, uint64 pixels offset }
+//   pixels of each level, aligned on DATA_ALIGNMENT bytes
+// Offsets are from the start of the file.
+
+namespace {
+
+const char MAGIC[4] = { 'H', 'T', 'E', 'X' };
+const size_t DATA_ALIGNMENT = 16;
+const size_t HEADER_SIZE = sizeof(MAGIC) + 3 * sizeof(uint32_t);
+const size_t LEVEL_SIZE = 4 * sizeof(uint32_t) + sizeof(uint64_t);
+const char EXTENSION[] = ".htex";
+
+template<typename T>
+void
+write(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+T
+read(const uint8_t* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+size_t
+align(size_t offset, size_t alignment)
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+size_t
+get_pixel_size(TextureFile::Format format)
+{
+  switch (format)
+  {
+    case TextureFile::Format::RGBA32:
+      return 4;
+
+    default:
+      return 0;
+  }
+}
+
+} // namespace
+
+const uint32_t TextureFile::VERSION = 1;
+const uint32_t TextureFile::ROW_ALIGNMENT = 4;
+
+bool
+TextureFile::is_texture_file(const std::string& file)
+{
+  const size_t length = sizeof(EXTENSION) - 1;
+  return file.size() > length
+         && file.compare(file.size() - length, length, EXTENSION) == 0;
+}
+
+void
+TextureFile::save(const std::string& file, Format format,
+                  const std::vector<Level>& levels)
+{
+  if (levels.empty())
+    throw std::runtime_error("Cannot save a texture file without pixels");
+
+  const size_t pixel_size = get_pixel_size(format);
+  if (!pixel_size)
+    throw std::runtime_error("Cannot save a texture file in an unknown format");
+
+  std::ofstream out(file, std::ios::binary);
+
+  if (!out)
+  {
+    throw std::runtime_error("Could not open texture file for writing: "
+                             + file);
+  }
+
+  std::vector<uint32_t> pitches;
+  std::vector<uint64_t> offsets;
+  size_t offset = HEADER_SIZE + levels.size() * LEVEL_SIZE;
+
+  for (const auto& level : levels)
+  {
+    pitches.push_back(static_cast<uint32_t>(align(level.width * pixel_size,
+                                                  ROW_ALIGNMENT)));
+    offset = align(offset, DATA_ALIGNMENT);
+    offsets.push_back(offset);
+    offset += static_cast<size_t>(pitches.back()) * level.height;
+  }
+
+  out.write(MAGIC, sizeof(MAGIC));
+  write(out, VERSION);
+  write(out, static_cast<uint32_t>(format));
+  write(out, static_cast<uint32_t>(levels.size()));
+
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    write(out, levels[i].width);
+    write(out, levels[i].height);
+    write(out, pitches[i]);
+    write(out, static_cast<uint32_t>(0));
+    write(out, offsets[i]);
+  }
+
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    const size_t row_size = levels[i].width * pixel_size;
+    std::vector<char> padding(DATA_ALIGNMENT + pitches[i] - row_size, 0);
+
+    out.write(padding.data(), static_cast<std::streamsize>(
+                                offsets[i] - static_cast<size_t>(out.tellp())));
+
+    for (uint32_t y = 0; y < levels[i].height; y++)
+    {
+      out.write(reinterpret_cast<const char*>(levels[i].pixels)
+                  + static_cast<size_t>(levels[i].pitch) * y,
+                static_cast<std::streamsize>(row_size));
+      out.write(padding.data(),
+                static_cast<std::streamsize>(pitches[i] - row_size));
+    }
+  }
+
+  if (!out)
+    throw std::runtime_error("Could not write texture file: " + file);
+}
+
+TextureFile::TextureFile(const std::string& file) :
+  m_file(),
+  m_format(Format::RGBA32),
+  m_levels()
+{
+  const uint8_t* data;
+  size_t size;
+
+  if (!Archive::find_mounted(file, data, size))
+  {
+    m_file = std::make_unique<MappedFile>(file);
+    data = m_file->get_data();
+    size = m_file->get_size();
+  }
+
+  if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    throw std::runtime_error("Not a texture file: " + file);
+
+  uint32_t version = read<uint32_t>(data + 4);
+  if (version != VERSION)
+  {
+    throw std::runtime_error("Unsupported texture file version "
+                             + std::to_string(version) + ": " + file);
+  }
+
+  m_format = static_cast<Format>(read<uint32_t>(data + 8));
+  const size_t pixel_size = get_pixel_size(m_format);
+  if (!pixel_size)
+    throw std::runtime_error("Unknown texture file format: " + file);
+
+  uint32_t count = read<uint32_t>(data + 12);
+  if (count == 0 || count > (size - HEADER_SIZE) / LEVEL_SIZE)
+    throw std::runtime_error("Truncated texture file: " + file);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint8_t* entry = data + HEADER_SIZE + i * LEVEL_SIZE;
+    Level level;
+    level.width = read<uint32_t>(entry);
+    level.height = read<uint32_t>(entry + 4);
+    level.pitch = read<uint32_t>(entry + 8);
+    uint64_t offset = read<uint64_t>(entry + 16);
+
+    if (level.pitch < level.width * pixel_size
+        || offset > size
+        || static_cast<uint64_t>(level.pitch) * level.height > size - offset)
+    {
+      throw std::runtime_error("Truncated texture file: " + file);
+    }
+
+    level.pixels = data + offset;
+    m_levels.push_back(level);
+  }
+}
+
+TextureFile::Format
+TextureFile::get_format() const
+{
+  return m_format;
+}
+
+const std::vector<TextureFile::Level>&
+TextureFile::get_levels() const
+{
+  return m_levels;
+}
+
+SDL_Surface*
+TextureFile::create_surface(size_t level) const
+{
+  const Level& l = m_levels.at(level);
+
+  // SDL wants mutable pixels, but only reads them to upload or convert
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+                                          const_cast<uint8_t*>(l.pixels),
+                                          static_cast<int>(l.width),
+                                          static_cast<int>(l.height), 32,
+                                          static_cast<int>(l.pitch),
+                                          SDL_PIXELFORMAT_RGBA32);
+
+  if (!surface)
+  {
+    throw std::runtime_error("Could not wrap texture file pixels: "
+                             + std::string(SDL_GetError()));
+  }
+
+  return surface;
+}
@@ -0,0 +1,86 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#ifndef _HEADER_HARBOR_VIDEO_TEXTUREFILE_HPP
+#define _HEADER_HARBOR_VIDEO_TEXTUREFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.hpp"
+
+struct SDL_Surface;
+
+/**
+ * Pre-decoded texture, stored as pixels ready to be uploaded (`.htex` files,
+ * made with `harbor_texconv`). The file is memory-mapped, or read straight
+ * from a mounted archive, so loading it doesn't decode or copy anything.
+ */
+class TextureFile final
+{
+public:
+  enum class Format : uint32_t {
+    /** 8-bit red, green, blue and alpha, in that order in memory. */
+    RGBA32 = 0
+  };
+
+  /** One mipmap level; level 0 is the full-size image. */
+  struct Level
+  {
+    uint32_t width;
+    uint32_t height;
+    /** Bytes per row, a multiple of ROW_ALIGNMENT. */
+    uint32_t pitch;
+    const uint8_t* pixels;
+  };
+
+public:
+  static const uint32_t VERSION;
+  static const uint32_t ROW_ALIGNMENT;
+
+  /** @returns Whether @p file is named like a texture file. */
+  static bool is_texture_file(const std::string& file);
+
+  /** Writes @p levels, which must hold at least the full-size image. */
+  static void save(const std::string& file, Format format,
+                   const std::vector<Level>& levels);
+
+public:
+  TextureFile(const std::string& file);
+
+  Format get_format() const;
+  const std::vector<Level>& get_levels() const;
+
+  /**
+   * @returns A surface sharing the pixels of @p level, valid as long as this
+   *          object is. It must not be written to; the caller frees it.
+   */
+  SDL_Surface* create_surface(size_t level = 0) const;
+
+private:
+  /** Null when the file was found in a mounted archive. */
+  std::unique_ptr<MappedFile> m_file;
+  Format m_format;
+  std::vector<Level> m_levels;
+
+private:
+  TextureFile(const TextureFile&) = delete;
+  TextureFile& operator=(const TextureFile&) = delete;
+};
+
+#endif
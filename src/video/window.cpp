@@ -16,14 +16,54 @@
 
 #include "video/window.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
 #include "make_unique.hpp"
 
+#include "SDL.h"
+#include "SDL_image.h"
+
+#include "util/archive.hpp"
+#include "util/log.hpp"
+#include "util/thread_pool.hpp"
+#include "video/texture_file.hpp"
+
 #if HARBOR_USE_VIDEO_SDL
 #include "video/sdl/sdl_window.hpp"
 #endif
 #if HARBOR_USE_VIDEO_OPENGL
 #include "video/gl/gl_window.hpp"
 #endif
+#if HARBOR_USE_VIDEO_SOFTWARE
+#include "video/software/software_window.hpp"
+#endif
+
+SDL_Surface*
+Window::decode_image(const std::string& file)
+{
+  // Converting here spares the render thread a conversion pass on upload
+  SDL_Surface* image;
+
+  if (TextureFile::is_texture_file(file))
+    image = TextureFile(file).create_surface();
+  else
+    image = IMG_Load_RW(Archive::open_rw(file), 1);
+
+  if (!image)
+    throw std::runtime_error(IMG_GetError());
+
+  // Also copies texture files, whose pixels are only mapped
+  SDL_Surface* converted = SDL_ConvertSurfaceFormat(image,
+                                                    SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(image);
+
+  if (!converted)
+    throw std::runtime_error(SDL_GetError());
+
+  return converted;
+}
 
 std::unique_ptr<Window>
 Window::create_window(VideoSystem vs)
@@ -40,13 +80,422 @@ Window::create_window(VideoSystem vs)
       return std::make_unique<GLWindow>();
 #endif
 
+#if HARBOR_USE_VIDEO_SOFTWARE
+    case VideoSystem::SOFTWARE:
+      return std::make_unique<SoftwareWindow>();
+#endif
+
     default:
       return nullptr;
   }
 }
 
+Window::Window() :
+  m_texture_cache(),
+  m_texture_lru(),
+  m_texture_memory(0),
+  m_texture_budget(256 * 1024 * 1024),
+  m_pending_textures(),
+  m_pending_reloads(),
+  m_async_textures(),
+  m_async_prune_size(0),
+  m_placeholder(),
+  m_upload_budget(4.f),
+  m_loader(nullptr)
+{
+}
+
+Window::~Window()
+{
+  // The workers may still be decoding; their surfaces are ours to free
+  for (auto& pending : m_pending_textures)
+  {
+    try
+    {
+      SDL_FreeSurface(pending.surface.get());
+    }
+    catch (...)
+    {
+    }
+  }
+
+  for (auto& pending : m_pending_reloads)
+  {
+    try
+    {
+      SDL_FreeSurface(pending.surface.get());
+    }
+    catch (...)
+    {
+    }
+  }
+}
+
+std::shared_ptr<Texture>
+Window::load_texture(const std::string& file)
+{
+  auto cached = m_texture_cache.find(file);
+
+  if (cached != m_texture_cache.end())
+  {
+    m_texture_lru.splice(m_texture_lru.begin(), m_texture_lru,
+                         cached->second.lru);
+    return cached->second.texture;
+  }
+
+  std::shared_ptr<Texture> texture;
+
+  if (TextureFile::is_texture_file(file))
+    texture = create_texture_from_image(TextureFile(file), file);
+  else
+    texture = create_texture_from_file(file);
+
+  cache_texture(file, texture);
+  return texture;
+}
+
+std::shared_ptr<Texture>
+Window::load_texture(const std::string& file, SDL_Surface* surface)
+{
+  auto cached = m_texture_cache.find(file);
+
+  if (cached != m_texture_cache.end())
+  {
+    m_texture_lru.splice(m_texture_lru.begin(), m_texture_lru,
+                         cached->second.lru);
+    return cached->second.texture;
+  }
+
+  auto texture = create_texture_from_surface(surface, file);
+  cache_texture(file, texture);
+  return texture;
+}
+
+std::shared_ptr<Texture>
+Window::create_texture_from_image(const TextureFile& image,
+                                  const std::string& file)
+{
+  SDL_Surface* surface = image.create_surface();
+  std::shared_ptr<Texture> texture;
+
+  try
+  {
+    texture = create_texture_from_surface(surface, file);
+  }
+  catch (...)
+  {
+    SDL_FreeSurface(surface);
+    throw;
+  }
+
+  SDL_FreeSurface(surface);
+  return texture;
+}
+
 void
 Window::flush_texture_cache()
 {
-  m_texture_cache.clear();
+  evict_textures(0);
+}
+
+void
+Window::set_texture_budget(size_t bytes)
+{
+  m_texture_budget = bytes;
+  evict_textures(m_texture_budget);
+}
+
+size_t
+Window::get_texture_budget() const
+{
+  return m_texture_budget;
+}
+
+size_t
+Window::get_texture_memory() const
+{
+  return m_texture_memory;
+}
+
+size_t
+Window::get_cached_texture_count() const
+{
+  return m_texture_cache.size();
+}
+
+std::shared_ptr<AsyncTexture>
+Window::load_texture_async(const std::string& file)
+{
+  auto cached = m_async_textures.find(file);
+
+  if (cached == m_async_textures.end())
+  {
+    prune_async_textures();
+    cached = m_async_textures.insert({ file, {} }).first;
+  }
+  else if (auto texture = cached->second.lock())
+  {
+    return texture;
+  }
+
+  auto texture = std::make_shared<AsyncTexture>(file, m_placeholder);
+  cached->second = texture;
+
+  auto loaded = m_texture_cache.find(file);
+  if (loaded != m_texture_cache.end())
+  {
+    m_texture_lru.splice(m_texture_lru.begin(), m_texture_lru,
+                         loaded->second.lru);
+    texture->m_texture = loaded->second.texture;
+    return texture;
+  }
+
+  if (TextureFile::is_texture_file(file))
+  {
+    try
+    {
+      texture->m_texture = load_texture(file);
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Could not load texture '" << file << "': " << e.what()
+               << std::endl;
+      texture->m_failed = true;
+    }
+
+    return texture;
+  }
+
+  auto surface = get_loader().submit([file]() {
+    return decode_image(file);
+  });
+
+  m_pending_textures.push_back({ texture, std::move(surface) });
+  return texture;
+}
+
+bool
+Window::reload_texture(const std::string& file)
+{
+  if (m_texture_cache.find(file) == m_texture_cache.end())
+    return false;
+
+  std::future<SDL_Surface*> surface;
+
+  // Texture files need no decoding; upload_textures() maps them itself
+  if (TextureFile::is_texture_file(file))
+  {
+    std::promise<SDL_Surface*> none;
+    none.set_value(nullptr);
+    surface = none.get_future();
+  }
+  else
+  {
+    surface = get_loader().submit([file]() {
+      return decode_image(file);
+    });
+  }
+
+  m_pending_reloads.push_back({ file, std::move(surface) });
+  return true;
+}
+
+void
+Window::set_placeholder_texture(const std::string& file)
+{
+  if (file.empty())
+  {
+    m_placeholder.reset();
+    return;
+  }
+
+  m_placeholder = load_texture(file);
+}
+
+void
+Window::set_upload_budget(float ms)
+{
+  m_upload_budget = ms;
+}
+
+float
+Window::get_upload_budget() const
+{
+  return m_upload_budget;
+}
+
+void
+Window::set_loader(ThreadPool& pool)
+{
+  m_loader = &pool;
+}
+
+void
+Window::prune_async_textures()
+{
+  if (m_async_textures.size() < m_async_prune_size)
+    return;
+
+  for (auto it = m_async_textures.begin(); it != m_async_textures.end();)
+  {
+    if (it->second.expired())
+      it = m_async_textures.erase(it);
+    else
+      ++it;
+  }
+
+  m_async_prune_size = std::max<size_t>(16, 2 * m_async_textures.size());
+}
+
+ThreadPool&
+Window::get_loader()
+{
+  // Created on first use, so that windows that never load asynchronously
+  // don't start any threads
+  if (!m_loader)
+  {
+#ifdef EMSCRIPTEN
+    // Builds without pthreads can't start workers; decode on this thread
+    static ThreadPool sync_loader(0);
+    m_loader = &sync_loader;
+#else
+    m_loader = &ThreadPool::get_default();
+#endif
+  }
+
+  return *m_loader;
+}
+
+void
+Window::upload_textures()
+{
+  const auto start = std::chrono::steady_clock::now();
+  bool uploaded = false;
+
+  auto over_budget = [&]() {
+    std::chrono::duration<float, std::milli> elapsed =
+                                      std::chrono::steady_clock::now() - start;
+    return uploaded && elapsed.count() >= m_upload_budget;
+  };
+
+  // Reloads swap the pixels of cached textures in place, so that every handle
+  // sees them. This runs before the frame is drawn, never in the middle of it.
+  for (auto it = m_pending_reloads.begin(); it != m_pending_reloads.end();)
+  {
+    if (it->surface.wait_for(std::chrono::seconds(0))
+          != std::future_status::ready)
+    {
+      ++it;
+      continue;
+    }
+
+    if (over_budget())
+      return;
+
+    SDL_Surface* surface = nullptr;
+
+    try
+    {
+      surface = it->surface.get();
+
+      // The texture may have been evicted since; it will be loaded anew then
+      auto cached = m_texture_cache.find(it->file);
+      if (cached != m_texture_cache.end())
+      {
+        Texture& texture = *cached->second.texture;
+        m_texture_memory -= texture.get_memory_size();
+
+        if (surface)
+          texture.replace(surface);
+        else
+          texture.replace(TextureFile(it->file));
+
+        m_texture_memory += texture.get_memory_size();
+      }
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Could not reload texture '" << it->file << "': "
+               << e.what() << std::endl;
+    }
+
+    if (surface)
+      SDL_FreeSurface(surface);
+
+    it = m_pending_reloads.erase(it);
+    uploaded = true;
+  }
+
+  for (auto it = m_pending_textures.begin(); it != m_pending_textures.end();)
+  {
+    if (it->surface.wait_for(std::chrono::seconds(0))
+          != std::future_status::ready)
+    {
+      ++it;
+      continue;
+    }
+
+    if (over_budget())
+      break;
+
+    AsyncTexture& texture = *it->texture;
+    SDL_Surface* surface = nullptr;
+
+    try
+    {
+      surface = it->surface.get();
+
+      // Reuses the texture if it was loaded synchronously in the meantime
+      texture.m_texture = load_texture(texture.get_file(), surface);
+    }
+    catch (const std::exception& e)
+    {
+      log_warn << "Could not load texture '" << texture.get_file() << "': "
+               << e.what() << std::endl;
+      texture.m_failed = true;
+    }
+
+    if (surface)
+      SDL_FreeSurface(surface);
+
+    it = m_pending_textures.erase(it);
+    uploaded = true;
+  }
+}
+
+size_t
+Window::get_loading_count() const
+{
+  return m_pending_textures.size() + m_pending_reloads.size();
+}
+
+void
+Window::cache_texture(const std::string& file,
+                      const std::shared_ptr<Texture>& texture)
+{
+  m_texture_lru.push_front(file);
+  m_texture_cache[file] = { texture, m_texture_lru.begin() };
+  m_texture_memory += texture->get_memory_size();
+
+  evict_textures(m_texture_budget);
+}
+
+void
+Window::evict_textures(size_t budget)
+{
+  auto it = m_texture_lru.end();
+
+  while (m_texture_memory > budget && it != m_texture_lru.begin())
+  {
+    --it;
+    auto cached = m_texture_cache.find(*it);
+
+    // Evicting a texture in use would only duplicate it on the next load
+    if (cached->second.texture.use_count() > 1)
+      continue;
+
+    m_texture_memory -= cached->second.texture->get_memory_size();
+    m_texture_cache.erase(cached);
+    it = m_texture_lru.erase(it);
+  }
 }
@@ -17,14 +17,21 @@
 #ifndef _HEADER_HARBOR_VIDEO_WINDOW_HPP
 #define _HEADER_HARBOR_VIDEO_WINDOW_HPP
 
+#include <future>
+#include <list>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "util/size.hpp"
+#include "video/async_texture.hpp"
 #include "video/texture.hpp"
 
 class Renderer;
+class TextureFile;
+class ThreadPool;
+struct SDL_Surface;
 
 class Window
 {
@@ -42,17 +49,41 @@ public:
 #endif
 #if HARBOR_USE_VIDEO_OPENGL
     GL,
+#endif
+#if HARBOR_USE_VIDEO_SOFTWARE
+    SOFTWARE,
 #endif
   };
 
 public:
   static std::unique_ptr<Window> create_window(VideoSystem vs);
 
+  /**
+   * Decodes @p file, an image or a texture file, to an RGBA32 surface, which
+   * the caller frees. Safe to call from any thread. Texture files only get
+   * their full-size level copied; load_texture() and reload_texture() map them
+   * instead, without going through here.
+   */
+  static SDL_Surface* decode_image(const std::string& file);
+
 public:
-  virtual ~Window() = default;
+  virtual ~Window();
 
-  virtual Texture& load_texture(const std::string& file) = 0;
   virtual std::shared_ptr<Texture> create_texture(const Size& size) = 0;
+  /** Loads @p file, bypassing the texture cache. */
+  virtual std::shared_ptr<Texture> create_texture_from_file(
+                                                const std::string& file) = 0;
+  /**
+   * Uploads a pre-decoded texture. By default, only the full-size level is
+   * uploaded, through create_texture_from_surface().
+   */
+  virtual std::shared_ptr<Texture> create_texture_from_image(
+                                                const TextureFile& image,
+                                                const std::string& file);
+  /** Uploads @p surface, which the caller keeps ownership of. */
+  virtual std::shared_ptr<Texture> create_texture_from_surface(
+                                                  SDL_Surface* surface,
+                                                  const std::string& file) = 0;
   virtual Renderer& get_renderer() = 0;
 
   virtual std::string get_title() const = 0;
@@ -75,13 +106,142 @@ public:
   virtual void set_icon(const std::string& file) = 0;
   virtual void set_opacity(float opacity) = 0;
 
+  /**
+   * Loads @p file, or returns the cached texture. Texture files (`.htex`) are
+   * uploaded as they are; other files are decoded. Textures stay valid for as
+   * long as they are referenced; once they aren't anymore, the cache keeps
+   * them until it exceeds its budget.
+   */
+  std::shared_ptr<Texture> load_texture(const std::string& file);
+
+  /**
+   * Caches @p surface, decoded from @p file beforehand (see decode_image()),
+   * unless @p file is cached already. The caller keeps ownership of @p surface.
+   */
+  std::shared_ptr<Texture> load_texture(const std::string& file,
+                                        SDL_Surface* surface);
+
+  /**
+   * Drops every cached texture that isn't referenced outside the cache.
+   * Textures still in use are kept so that they are shared by later loads.
+   */
   void flush_texture_cache();
 
-protected:
-  Window() = default;
+  /**
+   * Sets how many bytes of unreferenced textures the cache may keep. The least
+   * recently used ones are evicted first. Referenced textures are never
+   * evicted, so the cache may go over budget while they are in use.
+   */
+  void set_texture_budget(size_t bytes);
+  size_t get_texture_budget() const;
+
+  /** @returns The memory used by the cached textures, in bytes. */
+  size_t get_texture_memory() const;
+  size_t get_cached_texture_count() const;
+
+  /**
+   * Starts loading @p file in the background: the image is decoded by the
+   * loader pool, then uploaded by upload_textures(). Requesting a file that is
+   * still referenced returns the same handle. Texture files (`.htex`) need no
+   * decoding, so they are loaded right away.
+   */
+  std::shared_ptr<AsyncTexture> load_texture_async(const std::string& file);
+
+  /**
+   * Loads the texture drawn in place of textures that are still loading, for
+   * the handles created from now on. An empty string means none.
+   */
+  void set_placeholder_texture(const std::string& file);
+
+  /**
+   * Sets how long upload_textures() may take per call, in milliseconds. At
+   * least one texture is uploaded per call, however long it takes.
+   */
+  void set_upload_budget(float ms);
+  float get_upload_budget() const;
+
+  /**
+   * Sets the pool decoding images. By default, ThreadPool::get_default() is
+   * used, once an image is first loaded asynchronously; on Emscripten, images
+   * are decoded synchronously instead.
+   */
+  void set_loader(ThreadPool& pool);
+
+  /**
+   * Uploads the textures decoded or reloaded since the last call, within the
+   * upload budget. Renderers call it when they start drawing a frame to the
+   * window.
+   */
+  void upload_textures();
+
+  /**
+   * Decodes @p file again in the background if it is cached. upload_textures()
+   * then swaps the new pixels into the cached texture, so that the handles
+   * already given out show the new version. Texture files (`.htex`) aren't
+   * decoded; upload_textures() uploads them again as they are, mipmaps
+   * included.
+   *
+   * @returns Whether @p file was cached; other files are left alone.
+   */
+  bool reload_texture(const std::string& file);
+
+  /**
+   * @returns The number of textures waiting to be decoded or uploaded,
+   *          reloads included.
+   */
+  size_t get_loading_count() const;
 
 protected:
-  std::unordered_map<std::string, std::unique_ptr<Texture>> m_texture_cache;
+  Window();
+
+private:
+  struct CachedTexture
+  {
+    std::shared_ptr<Texture> texture;
+    /** Position in m_texture_lru. */
+    std::list<std::string>::iterator lru;
+  };
+
+  struct PendingTexture
+  {
+    std::shared_ptr<AsyncTexture> texture;
+    std::future<SDL_Surface*> surface;
+  };
+
+  struct PendingReload
+  {
+    std::string file;
+    std::future<SDL_Surface*> surface;
+  };
+
+private:
+  void cache_texture(const std::string& file,
+                     const std::shared_ptr<Texture>& texture);
+  void evict_textures(size_t budget);
+  /**
+   * Forgets the handles that are no longer in use, once m_async_textures has
+   * doubled since the last time, so that the cost stays constant per load.
+   */
+  void prune_async_textures();
+  ThreadPool& get_loader();
+
+private:
+  std::unordered_map<std::string, CachedTexture> m_texture_cache;
+  /** Cached files, from the most to the least recently used. */
+  std::list<std::string> m_texture_lru;
+  size_t m_texture_memory;
+  size_t m_texture_budget;
+  /** Pending loads, in the order they were requested. */
+  std::vector<PendingTexture> m_pending_textures;
+  std::vector<PendingReload> m_pending_reloads;
+  /** Handles by file, to share them while they are in use. */
+  std::unordered_map<std::string, std::weak_ptr<AsyncTexture>> m_async_textures;
+  /** Size of m_async_textures at which prune_async_textures() runs next. */
+  size_t m_async_prune_size;
+  std::shared_ptr<Texture> m_placeholder;
+  float m_upload_budget;
+  /** Null until set_loader() or the first asynchronous load. */
+  ThreadPool* m_loader;
 
 private:
   Window(const Window&) = delete;
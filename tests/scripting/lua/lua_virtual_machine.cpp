@@ -0,0 +1,306 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "util/log.hpp"
+
+#define private public
+#define protected public
+#define final
+
+#include "scripting/lua/lua_virtual_machine.hpp"
+#include "scripting/scriptable.hpp"
+
+#undef private
+#undef protected
+#undef final
+
+class LuaScriptTest :
+  public Scriptable
+{
+public:
+  LuaScriptTest() = default;
+
+  virtual std::string get_classname() const override
+  {
+    return "LuaScriptTest";
+  }
+};
+
+TEST(Scripting_Lua_LuaVirtualMachine, profiling)
+{
+  LuaVirtualMachine vm;
+
+  ASSERT_NO_THROW({
+    vm.expose_function({"nap", VirtualMachine::bind(
+      std::function<void()>([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      })
+    )});
+  });
+
+  // Enough instructions on both sides of the native call to take samples
+  ASSERT_NO_THROW({
+    vm.run_code("function spin()"
+                "  local n = 0"
+                "  for i = 1, 100000 do n = n + i end"
+                "  return n "
+                "end "
+                "function work()"
+                "  spin()"
+                "  nap()"
+                "  spin()"
+                "end", "<declarations>");
+  });
+
+  vm.set_profiling(true);
+
+  ASSERT_NO_THROW({ vm.call_function("work", {}); });
+
+  // Idle time between two calls isn't charged to the next one
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  ASSERT_NO_THROW({ vm.call_function("work", {}); });
+
+  vm.set_profiling(false);
+
+  auto entries = vm.get_profiler().get_entries();
+  const ScriptProfiler::Entry* nap = nullptr;
+  size_t samples = 0;
+  double lua_time = 0.;
+
+  for (const auto& entry : entries)
+  {
+    if (entry.name == "nap (native)")
+    {
+      nap = &entry;
+    }
+    else
+    {
+      samples += entry.samples;
+      lua_time += entry.exclusive;
+    }
+  }
+
+  ASSERT_NE(nap, nullptr);
+  EXPECT_EQ(nap->calls, 2u);
+  EXPECT_GE(nap->exclusive, 100.);
+
+  // Neither the idle time nor the native calls count as Lua time
+  EXPECT_GT(samples, 0u);
+  EXPECT_LT(lua_time, 100.);
+}
+
+TEST(Scripting_Lua_LuaVirtualMachine, cache)
+{
+  std::string code_a = "out('A')";
+  std::string code_b = "out('B')";
+  std::string file_a, file_b;
+
+  auto run = [](const std::string& code) {
+    LuaVirtualMachine vm;
+    std::string out;
+    vm.expose_function({"out", VirtualMachine::bind(
+      std::function<void(std::string)>([&out](std::string s) { out += s; })
+    )});
+    vm.set_cache_dir(".");
+    vm.run_code(code, "<test>");
+    return out;
+  };
+
+  {
+    LuaVirtualMachine vm;
+    vm.set_cache_dir(".");
+    file_a = vm.get_cache_file(code_a, "<test>", "luac");
+    file_b = vm.get_cache_file(code_b, "<test>", "luac");
+    ASSERT_NE(file_a, file_b);
+    ASSERT_NE(file_a, vm.get_cache_file(code_a, "<other>", "luac"));
+  }
+
+  std::remove(file_a.c_str());
+  std::remove(file_b.c_str());
+
+  // The first run compiles the source and caches it
+  ASSERT_EQ(run(code_a), "A");
+  ASSERT_EQ(run(code_b), "B");
+  ASSERT_TRUE(std::ifstream(file_a).good());
+  ASSERT_TRUE(std::ifstream(file_b).good());
+
+  // Later runs load the bytecode instead of the source
+  {
+    std::ifstream in(file_b, std::ios::binary);
+    std::ofstream out(file_a, std::ios::binary);
+    out << in.rdbuf();
+  }
+  ASSERT_EQ(run(code_a), "B");
+
+  std::ostream* old_log = Log::s_log;
+  std::stringstream log;
+  Log::s_log = &log;
+
+  // Only binary chunks are loaded, never source code
+  {
+    std::ofstream out(file_a, std::ios::binary);
+    out << code_b;
+  }
+  ASSERT_EQ(run(code_a), "A");
+
+  // Files that merely start like bytecode, which is all that is checked on
+  // Lua 5.1 before loading, are rejected too, and so are empty files
+  {
+    std::ofstream out(file_a, std::ios::binary);
+    out << LUA_SIGNATURE[0] << "garbage";
+  }
+  ASSERT_EQ(run(code_a), "A");
+  {
+    std::ofstream out(file_a, std::ios::binary);
+  }
+  ASSERT_EQ(run(code_a), "A");
+
+  // Falling back to the source rewrote the cache
+  ASSERT_EQ(run(code_a), "A");
+  Log::s_log = old_log;
+
+  std::remove(file_a.c_str());
+  std::remove(file_b.c_str());
+}
+
+TEST(Scripting_Lua_LuaVirtualMachine, get_callable)
+{
+  LuaVirtualMachine vm;
+
+  ASSERT_NO_THROW({
+    vm.run_code("counter = 0 "
+                "function add(i)"
+                "  counter = counter + i"
+                "  return counter "
+                "end "
+                "obj = { value = 7 } "
+                "function obj.get()"
+                "  return obj.value "
+                "end", "<declarations>");
+  });
+
+  int top = lua_gettop(vm.m_vm);
+  std::unique_ptr<VirtualMachine::Callable> add, get;
+
+  ASSERT_NO_THROW({ add = vm.get_callable("add"); });
+  ASSERT_NO_THROW({ get = vm.get_callable("obj.get"); });
+
+  ASSERT_THROW({ vm.get_callable("nothing"); }, std::runtime_error);
+  ASSERT_THROW({ vm.get_callable("obj.nothing"); }, std::runtime_error);
+  ASSERT_THROW({ vm.get_callable("counter"); }, std::runtime_error);
+  ASSERT_EQ(lua_gettop(vm.m_vm), top);
+
+  std::vector<VirtualMachine::Value> args;
+  args.push_back(VirtualMachine::Value(3));
+
+  // Lua numbers come back as floats
+  for (int i = 1; i <= 3; i++)
+  {
+    auto r = add->call(args);
+    ASSERT_EQ(r.size(), 1);
+    ASSERT_EQ(r.back().get_float(), 3.f * i);
+  }
+
+  auto r = get->call(std::vector<VirtualMachine::Value>());
+  ASSERT_EQ(r.size(), 1);
+  ASSERT_EQ(r.back().get_float(), 7.f);
+
+  // The reference keeps the function alive once removed from the VM
+  ASSERT_NO_THROW({ vm.remove_entry("add"); });
+  ASSERT_THROW({ vm.call_function("add", args); }, std::runtime_error);
+  r = add->call(args);
+  ASSERT_EQ(r.size(), 1);
+  ASSERT_EQ(r.back().get_float(), 12.f);
+
+  // Errors raised by the function leave the stack as it was
+  ASSERT_THROW({
+    add->call(std::vector<VirtualMachine::Value>());
+  }, std::runtime_error);
+  ASSERT_EQ(lua_gettop(vm.m_vm), top);
+}
+
+TEST(Scripting_Lua_LuaVirtualMachine, call_batch)
+{
+  LuaVirtualMachine vm;
+
+  ASSERT_NO_THROW({
+    vm.run_code("function double(i)"
+                "  return i * 2 "
+                "end "
+                "n = 0 "
+                "function count()"
+                "  n = n + 1"
+                "  return n "
+                "end", "<declarations>");
+  });
+
+  int top = lua_gettop(vm.m_vm);
+  auto twice = vm.get_callable("double");
+  auto count = vm.get_callable("count");
+
+  std::vector<VirtualMachine::Value> values;
+  for (int i = 1; i <= 3; i++)
+    values.push_back(VirtualMachine::Value(i));
+
+  std::vector<VirtualMachine::Arguments> args;
+  for (const auto& value : values)
+    args.push_back(VirtualMachine::Arguments(&value, 1));
+
+  std::vector<Scriptable*> receivers(3, nullptr);
+  std::vector<VirtualMachine::Value> results;
+
+  ASSERT_NO_THROW({ twice->call_batch(receivers, args, results); });
+  ASSERT_EQ(results.size(), 3);
+  for (size_t i = 0; i < results.size(); i++)
+    ASSERT_EQ(results[i].get_float(), 2.f * (i + 1));
+
+  // No argument lists means no arguments for every receiver
+  receivers.push_back(nullptr);
+  ASSERT_NO_THROW({ count->call_batch(receivers, {}, results); });
+  ASSERT_EQ(results.size(), 4);
+  for (size_t i = 0; i < results.size(); i++)
+    ASSERT_EQ(results[i].get_float(), static_cast<float>(i + 1));
+  ASSERT_EQ(lua_gettop(vm.m_vm), top);
+
+  ASSERT_THROW({
+    twice->call_batch(receivers, args, results);
+  }, std::runtime_error);
+
+  // Lua functions can't be called on objects
+  LuaScriptTest st;
+  receivers.assign(3, nullptr);
+  receivers[1] = &st;
+  ASSERT_THROW({
+    twice->call_batch(receivers, args, results);
+  }, std::runtime_error);
+  ASSERT_EQ(lua_gettop(vm.m_vm), top);
+
+  // Errors raised by the function leave the stack as it was
+  receivers.assign(3, nullptr);
+  ASSERT_THROW({
+    twice->call_batch(receivers, {}, results);
+  }, std::runtime_error);
+  ASSERT_EQ(lua_gettop(vm.m_vm), top);
+}
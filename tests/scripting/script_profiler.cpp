@@ -0,0 +1,175 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "scripting/script_profiler.hpp"
+
+namespace {
+
+const ScriptProfiler::Entry*
+find_entry(const std::vector<ScriptProfiler::Entry>& entries,
+           const std::string& name)
+{
+  for (const auto& entry : entries)
+    if (entry.name == name)
+      return &entry;
+
+  return nullptr;
+}
+
+} // namespace
+
+TEST(Scripting_ScriptProfiler, calls)
+{
+  ScriptProfiler profiler;
+  profiler.start();
+
+  profiler.enter("update", "game.nut");
+  for (int i = 0; i < 3; i++)
+  {
+    profiler.enter("move", "native");
+    profiler.leave();
+  }
+
+  // Recursion
+  profiler.enter("update", "game.nut");
+  profiler.leave();
+
+  profiler.enter(nullptr, nullptr);
+  profiler.leave();
+  profiler.leave();
+
+  // Unbalanced calls are ignored
+  profiler.leave();
+
+  auto entries = profiler.get_entries();
+  ASSERT_EQ(entries.size(), 3u);
+
+  auto update = find_entry(entries, "update (game.nut)");
+  auto move = find_entry(entries, "move (native)");
+  ASSERT_NE(update, nullptr);
+  ASSERT_NE(move, nullptr);
+  ASSERT_NE(find_entry(entries, "<anonymous>"), nullptr);
+
+  EXPECT_EQ(update->calls, 2u);
+  EXPECT_EQ(move->calls, 3u);
+  EXPECT_EQ(update->samples, 0u);
+
+  // The recursive call is already part of the outer call
+  EXPECT_LE(update->exclusive, update->inclusive);
+  EXPECT_GE(update->inclusive, move->inclusive);
+  EXPECT_DOUBLE_EQ(move->inclusive, move->exclusive);
+
+  for (size_t i = 1; i < entries.size(); i++)
+    EXPECT_GE(entries[i - 1].exclusive, entries[i].exclusive);
+
+  std::ostringstream out;
+  profiler.print(out);
+  EXPECT_NE(out.str().find("update (game.nut)"), std::string::npos);
+  EXPECT_NE(out.str().find("move (native)"), std::string::npos);
+
+  profiler.clear();
+  EXPECT_TRUE(profiler.get_entries().empty());
+}
+
+TEST(Scripting_ScriptProfiler, samples)
+{
+  ScriptProfiler profiler;
+  profiler.start();
+
+  std::vector<std::string> stack = { "inner", "outer", "inner" };
+  profiler.add_sample(stack);
+  profiler.add_sample({ "outer" });
+
+  auto entries = profiler.get_entries();
+  ASSERT_EQ(entries.size(), 2u);
+
+  auto inner = find_entry(entries, "inner");
+  auto outer = find_entry(entries, "outer");
+  ASSERT_NE(inner, nullptr);
+  ASSERT_NE(outer, nullptr);
+
+  EXPECT_EQ(inner->samples, 1u);
+  EXPECT_EQ(outer->samples, 1u);
+  EXPECT_EQ(inner->calls, 0u);
+
+  // A function that appears twice in a sample only counts once
+  EXPECT_DOUBLE_EQ(inner->inclusive, inner->exclusive);
+  EXPECT_DOUBLE_EQ(outer->inclusive, inner->exclusive + outer->exclusive);
+}
+
+TEST(Scripting_ScriptProfiler, trace)
+{
+  ScriptProfiler profiler;
+
+  profiler.enter("say \"hi\"", "a\\b.nut");
+  profiler.leave();
+  profiler.add_sample({ "sampled" });
+
+  std::ostringstream out;
+  profiler.write_trace(out);
+  std::string trace = out.str();
+
+  EXPECT_EQ(trace.find("{\"traceEvents\":["), 0u);
+  EXPECT_NE(trace.find("\"name\":\"say \\\"hi\\\" (a\\\\b.nut)\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"sampled\",\"cat\":\"sample\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(trace.find("\"dur\":"), std::string::npos);
+
+  // Stopping closes the calls that are still running
+  profiler.enter("open", nullptr);
+  profiler.stop();
+  out.str("");
+  profiler.write_trace(out);
+  EXPECT_NE(out.str().find("\"name\":\"open\""), std::string::npos);
+
+  EXPECT_THROW(profiler.save_trace("/nonexistent/dir/trace.json"),
+               std::runtime_error);
+}
+
+TEST(Scripting_ScriptProfiler, sample_clock)
+{
+  ScriptProfiler profiler;
+  profiler.start();
+
+  // Time spent outside of scripts
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  profiler.reset_sample_clock();
+  profiler.add_sample({ "script" });
+
+  // Time spent in a native function called by the script
+  profiler.enter("native", "native");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  profiler.leave();
+  profiler.add_sample({ "script" });
+
+  auto entries = profiler.get_entries();
+  auto script = find_entry(entries, "script");
+  auto native = find_entry(entries, "native (native)");
+  ASSERT_NE(script, nullptr);
+  ASSERT_NE(native, nullptr);
+
+  EXPECT_LT(script->exclusive, 20.);
+  EXPECT_GE(script->inclusive, 20.);
+  EXPECT_GE(native->exclusive, 20.);
+}
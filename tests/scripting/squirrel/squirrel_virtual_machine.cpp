@@ -16,13 +16,17 @@
 
 #include "gtest/gtest.h"
 
-#include "scripting/scriptable.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "util/log.hpp"
 
 #define private public
 #define protected public
 #define final
 
+#include "scripting/scriptable.hpp"
 #include "scripting/squirrel/squirrel_virtual_machine.hpp"
 
 #undef private
@@ -84,20 +88,10 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, on_compile_error)
 
 TEST(Scripting_Squirrel_SquirrelVirtualMachine, get_vm)
 {
-  // TODO
-}
+  SquirrelVirtualMachine vm1, vm2;
 
-TEST(Scripting_Squirrel_SquirrelVirtualMachine, clear_vms)
-{
-  ASSERT_EQ(SquirrelVirtualMachine::s_vms.size(), 0);
-  SquirrelVirtualMachine vm1;
-  ASSERT_EQ(SquirrelVirtualMachine::s_vms.size(), 1);
-  {
-    ASSERT_EQ(SquirrelVirtualMachine::s_vms.size(), 1);
-    SquirrelVirtualMachine vm2;
-    ASSERT_EQ(SquirrelVirtualMachine::s_vms.size(), 2);
-  }
-  ASSERT_EQ(SquirrelVirtualMachine::s_vms.size(), 1);
+  ASSERT_EQ(SquirrelVirtualMachine::get_vm(vm1.m_vm), &vm1);
+  ASSERT_EQ(SquirrelVirtualMachine::get_vm(vm2.m_vm), &vm2);
 }
 
 TEST(Scripting_Squirrel_SquirrelVirtualMachine, squirrel_call)
@@ -117,6 +111,21 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, squirrel_call)
   });
 
   ASSERT_EQ(e, true);
+
+  // Each closure must dispatch to its own function, however many there are
+  int called = -1;
+  for (int i = 0; i < 200; i++)
+  {
+    vm.expose_function({"test" + std::to_string(i), VirtualMachine::bind(
+      std::function<void()>([&called, i]{ called = i; })
+    )});
+  }
+
+  ASSERT_NO_THROW({
+    vm.run_code("test137();", "<test>");
+  });
+
+  ASSERT_EQ(called, 137);
 }
 
 TEST(Scripting_Squirrel_SquirrelVirtualMachine, ctor_dtor)
@@ -317,6 +326,53 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, expose_function)
   ASSERT_TRUE(a);
 }
 
+template<typename T>
+void
+call_typed(const std::string& arg)
+{
+  SquirrelVirtualMachine vm;
+
+  vm.expose_class("ScriptTest", {});
+  vm.expose_function({"f", VirtualMachine::bind(std::function<void(T)>(
+    [](T){}
+  ))});
+
+  vm.run_code("f(" + arg + ");", "<test>");
+}
+
+TEST(Scripting_Squirrel_SquirrelThunk, argument_types)
+{
+  ASSERT_NO_THROW(call_typed<bool>("true"));
+  ASSERT_NO_THROW(call_typed<int>("3"));
+  ASSERT_NO_THROW(call_typed<float>("1.5"));
+  ASSERT_NO_THROW(call_typed<std::string>("\"str\""));
+  ASSERT_NO_THROW(call_typed<Scriptable*>("ScriptTest()"));
+
+  // Squirrel converts between integers and floats on its own
+  ASSERT_NO_THROW(call_typed<int>("1.5"));
+  ASSERT_NO_THROW(call_typed<float>("3"));
+
+  ASSERT_THROW(call_typed<bool>("3"), std::runtime_error);
+  ASSERT_THROW(call_typed<bool>("1.5"), std::runtime_error);
+  ASSERT_THROW(call_typed<bool>("\"str\""), std::runtime_error);
+  ASSERT_THROW(call_typed<bool>("ScriptTest()"), std::runtime_error);
+  ASSERT_THROW(call_typed<int>("true"), std::runtime_error);
+  ASSERT_THROW(call_typed<int>("\"str\""), std::runtime_error);
+  ASSERT_THROW(call_typed<int>("ScriptTest()"), std::runtime_error);
+  ASSERT_THROW(call_typed<float>("true"), std::runtime_error);
+  ASSERT_THROW(call_typed<float>("\"str\""), std::runtime_error);
+  ASSERT_THROW(call_typed<float>("ScriptTest()"), std::runtime_error);
+  ASSERT_THROW(call_typed<std::string>("true"), std::runtime_error);
+  ASSERT_THROW(call_typed<std::string>("3"), std::runtime_error);
+  ASSERT_THROW(call_typed<std::string>("ScriptTest()"), std::runtime_error);
+  ASSERT_THROW(call_typed<Scriptable*>("true"), std::runtime_error);
+  ASSERT_THROW(call_typed<Scriptable*>("3"), std::runtime_error);
+  ASSERT_THROW(call_typed<Scriptable*>("\"str\""), std::runtime_error);
+
+  // Missing arguments
+  ASSERT_THROW(call_typed<int>(""), std::runtime_error);
+}
+
 TEST(Scripting_Squirrel_SquirrelVirtualMachine, expose_bool)
 {
   SquirrelVirtualMachine vm;
@@ -495,47 +551,44 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, call_function)
   });
 
   ASSERT_NO_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Integer>(2));
-    args.push_back(std::make_unique<VirtualMachine::String>("Hello"));
-    args.push_back(std::make_unique<VirtualMachine::Boolean>(true));
-    args.push_back(std::make_unique<VirtualMachine::Float>(5.6f));
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st1));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(2));
+    args.push_back(VirtualMachine::Value("Hello"));
+    args.push_back(VirtualMachine::Value(true));
+    args.push_back(VirtualMachine::Value(5.6f));
+    args.push_back(VirtualMachine::Value(&st1));
     auto r1 = vm.call_function("method1", std::move(args));
 
     ASSERT_EQ(r1.size(), 1);
-    auto val = dynamic_cast<VirtualMachine::Boolean*>(r1.back().get());
-    ASSERT_NE(val, nullptr);
-    ASSERT_EQ(val->m_value, true);
+    ASSERT_EQ(r1.back().get_type(), VirtualMachine::Types::BOOLEAN);
+    ASSERT_EQ(r1.back().get_bool(), true);
   });
 
   ASSERT_NO_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Integer>(7));
-    args.push_back(std::make_unique<VirtualMachine::String>("World!"));
-    args.push_back(std::make_unique<VirtualMachine::Boolean>(false));
-    args.push_back(std::make_unique<VirtualMachine::Float>(7.8f));
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st2));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(7));
+    args.push_back(VirtualMachine::Value("World!"));
+    args.push_back(VirtualMachine::Value(false));
+    args.push_back(VirtualMachine::Value(7.8f));
+    args.push_back(VirtualMachine::Value(&st2));
     auto r2 = vm.call_function("method2", std::move(args));
 
     ASSERT_EQ(r2.size(), 1);
-    auto val = dynamic_cast<VirtualMachine::Integer*>(r2.back().get());
-    ASSERT_NE(val, nullptr);
-    ASSERT_EQ(val->m_value, 92);
+    ASSERT_EQ(r2.back().get_type(), VirtualMachine::Types::INTEGER);
+    ASSERT_EQ(r2.back().get_int(), 92);
   });
 
   ASSERT_NO_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Integer>(176));
-    args.push_back(std::make_unique<VirtualMachine::String>("=)"));
-    args.push_back(std::make_unique<VirtualMachine::Boolean>(true));
-    args.push_back(std::make_unique<VirtualMachine::Float>(72.25f));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(176));
+    args.push_back(VirtualMachine::Value("=)"));
+    args.push_back(VirtualMachine::Value(true));
+    args.push_back(VirtualMachine::Value(72.25f));
     auto r3 = vm.call_function("method3", std::move(args), &st3, true);
 
     ASSERT_EQ(r3.size(), 1);
-    auto val = dynamic_cast<VirtualMachine::Object*>(r3.back().get());
-    ASSERT_NE(val, nullptr);
-    ASSERT_EQ(val->m_value, &st3);
+    ASSERT_EQ(r3.back().get_type(), VirtualMachine::Types::OBJECT);
+    ASSERT_EQ(r3.back().get_object(), &st3);
   });
 
   EXPECT_TRUE(a);
@@ -569,16 +622,16 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, push_instance)
 
   // No class 'ScriptTest' in VM
   ASSERT_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st1));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(&st1));
     vm.call_function("method_no_st", std::move(args));
   }, std::runtime_error);
 
   // 'ScriptTest' is not a classname
   vm.expose_bool("ScriptTest", true);
   ASSERT_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st1));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(&st1));
     vm.call_function("method_no_st", std::move(args));
   }, std::runtime_error);
   vm.remove_entry("ScriptTest");
@@ -600,8 +653,8 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, push_instance)
   });
 
   ASSERT_NO_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st1));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(&st1));
     vm.call_function("method_no_st", std::move(args));
   });
 
@@ -610,8 +663,271 @@ TEST(Scripting_Squirrel_SquirrelVirtualMachine, push_instance)
   });
 
   ASSERT_NO_THROW({
-    std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-    args.push_back(std::make_unique<VirtualMachine::Object>(&st2));
+    std::vector<VirtualMachine::Value> args;
+    args.push_back(VirtualMachine::Value(&st2));
     vm.call_function("method_no_st", std::move(args));
   });
-}
\ No newline at end of file
+}
+
+TEST(Scripting_Squirrel_SquirrelVirtualMachine, cache)
+{
+  std::string code_a = "print(\"A\");";
+  std::string code_b = "print(\"B\");";
+  std::string file_a, file_b;
+
+  auto run = [](const std::string& code) {
+    SquirrelVirtualMachine vm;
+    std::stringstream ss;
+    vm.set_print(&ss);
+    vm.set_cache_dir(".");
+    vm.run_code(code, "<test>");
+    return ss.str();
+  };
+
+  {
+    SquirrelVirtualMachine vm;
+    vm.set_cache_dir(".");
+    file_a = vm.get_cache_file(code_a, "<test>", "cnut");
+    file_b = vm.get_cache_file(code_b, "<test>", "cnut");
+    ASSERT_NE(file_a, file_b);
+    ASSERT_NE(file_a, vm.get_cache_file(code_a, "<other>", "cnut"));
+  }
+
+  std::remove(file_a.c_str());
+  std::remove(file_b.c_str());
+
+  // The first run compiles the source and caches it
+  ASSERT_EQ(run(code_a), "A\n");
+  ASSERT_EQ(run(code_b), "B\n");
+  ASSERT_TRUE(std::ifstream(file_a).good());
+  ASSERT_TRUE(std::ifstream(file_b).good());
+
+  // Later runs load the bytecode instead of the source
+  {
+    std::ifstream in(file_b, std::ios::binary);
+    std::ofstream out(file_a, std::ios::binary);
+    out << in.rdbuf();
+  }
+  ASSERT_EQ(run(code_a), "B\n");
+
+  // Invalid bytecode falls back to the source
+  std::ostream* old_log = Log::s_log;
+  std::stringstream log;
+  Log::s_log = &log;
+  {
+    std::ofstream out(file_a, std::ios::binary);
+    out << "garbage";
+  }
+  ASSERT_EQ(run(code_a), "A\n");
+  ASSERT_EQ(run(code_a), "A\n");
+  Log::s_log = old_log;
+
+  std::remove(file_a.c_str());
+  std::remove(file_b.c_str());
+}
+
+TEST(Scripting_Squirrel_SquirrelVirtualMachine, get_callable)
+{
+  SquirrelVirtualMachine vm;
+  ScriptTest st;
+
+  ASSERT_NO_THROW({
+    vm.expose_class("MyClass", {
+      {"activate", VirtualMachine::bind(std::function<void(Scriptable*)>(
+        [](Scriptable* o){
+          if (auto o2 = dynamic_cast<ScriptTest*>(o))
+          {
+            o2->activate();
+          }
+        }
+      ))}
+    });
+  });
+
+  ASSERT_NO_THROW({ vm.expose_instance("MyClass", "st", &st); });
+
+  ASSERT_NO_THROW({
+    vm.run_code("counter <- 0;"
+                "function add(i) {"
+                "  counter += i;"
+                "  return counter;"
+                "}"
+                "obj <- {"
+                "  value = 7,"
+                "  function get() {"
+                "    return value;"
+                "  }"
+                "};"
+                "function poke() {"
+                "  this.activate();"
+                "}", "<declarations>");
+  });
+
+  std::unique_ptr<VirtualMachine::Callable> add, get, poke;
+
+  ASSERT_NO_THROW({ add = vm.get_callable("add"); });
+  ASSERT_NO_THROW({ get = vm.get_callable("obj.get"); });
+  ASSERT_NO_THROW({ poke = vm.get_callable("poke", &st); });
+
+  ASSERT_THROW({ vm.get_callable("nothing"); }, std::runtime_error);
+  ASSERT_THROW({ vm.get_callable("counter"); }, std::runtime_error);
+
+  std::vector<VirtualMachine::Value> args;
+  args.push_back(VirtualMachine::Value(3));
+
+  for (int i = 1; i <= 3; i++)
+  {
+    auto r = add->call(args);
+    ASSERT_EQ(r.size(), 1);
+    ASSERT_EQ(r.back().get_int(), 3 * i);
+  }
+
+  // The function is called on the table containing it
+  auto r = get->call(std::vector<VirtualMachine::Value>());
+  ASSERT_EQ(r.size(), 1);
+  ASSERT_EQ(r.back().get_int(), 7);
+
+  ASSERT_NO_THROW({ poke->call(std::vector<VirtualMachine::Value>()); });
+  EXPECT_TRUE(st.activated());
+
+  // The handle keeps the function alive once removed from the VM
+  ASSERT_NO_THROW({ vm.remove_entry("add"); });
+  ASSERT_THROW({ vm.call_function("add", args); }, std::runtime_error);
+  r = add->call(args);
+  ASSERT_EQ(r.size(), 1);
+  ASSERT_EQ(r.back().get_int(), 12);
+
+  // Errors raised by the function are reported the same way
+  ASSERT_THROW({
+    add->call(std::vector<VirtualMachine::Value>());
+  }, std::runtime_error);
+}
+
+TEST(Scripting_Squirrel_SquirrelVirtualMachine, call_batch)
+{
+  SquirrelVirtualMachine vm;
+  ScriptTest st1, st2, st3;
+
+  ASSERT_NO_THROW({
+    vm.expose_class("ScriptTest", {
+      {"activate", VirtualMachine::bind(std::function<void(Scriptable*)>(
+        [](Scriptable* o){
+          if (auto o2 = dynamic_cast<ScriptTest*>(o))
+          {
+            o2->activate();
+          }
+        }
+      ))}
+    });
+  });
+
+  ASSERT_NO_THROW({
+    vm.run_code("function update(i) {"
+                "  this.activate();"
+                "  return i * 2;"
+                "}"
+                "n <- 0;"
+                "function count() {"
+                "  n++;"
+                "  return n;"
+                "}", "<declarations>");
+  });
+
+  std::unique_ptr<VirtualMachine::Callable> update, count;
+  ASSERT_NO_THROW({ update = vm.get_callable("update"); });
+  ASSERT_NO_THROW({ count = vm.get_callable("count"); });
+
+  std::vector<Scriptable*> receivers = { &st1, &st2, &st3 };
+  std::vector<std::vector<VirtualMachine::Value>> values(3);
+  std::vector<VirtualMachine::Arguments> args;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i].push_back(VirtualMachine::Value(static_cast<int>(i) + 1));
+    args.push_back(VirtualMachine::Arguments(values[i]));
+  }
+
+  std::vector<VirtualMachine::Value> results;
+  auto top = sq_gettop(vm.m_vm);
+
+  ASSERT_NO_THROW({ update->call_batch(receivers, args, results); });
+  ASSERT_EQ(results.size(), 3);
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    ASSERT_EQ(results[i].get_int(), 2 * (static_cast<int>(i) + 1));
+  }
+
+  EXPECT_TRUE(st1.activated());
+  EXPECT_TRUE(st2.activated());
+  EXPECT_TRUE(st3.activated());
+
+  // Null receivers are called on the object the function was resolved on
+  std::vector<Scriptable*> no_receivers(4, nullptr);
+  ASSERT_NO_THROW({ count->call_batch(no_receivers, {}, results); });
+  ASSERT_EQ(results.size(), 4);
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    ASSERT_EQ(results[i].get_int(), static_cast<int>(i) + 1);
+  }
+
+  // One argument list per receiver
+  args.pop_back();
+  ASSERT_THROW({
+    update->call_batch(receivers, args, results);
+  }, std::runtime_error);
+
+  // A failing call leaves the stack as it was
+  ASSERT_THROW({
+    update->call_batch(no_receivers, {}, results);
+  }, std::runtime_error);
+
+  ASSERT_EQ(sq_gettop(vm.m_vm), top);
+}
+
+TEST(Scripting_Squirrel_SquirrelVirtualMachine, profiling)
+{
+  SquirrelVirtualMachine vm;
+
+  ASSERT_NO_THROW({
+    vm.expose_function({"native_work", VirtualMachine::bind(
+      std::function<int(int)>([](int i) { return i + 1; })
+    )});
+  });
+
+  ASSERT_NO_THROW({
+    vm.run_code("function work(i) {"
+                "  return native_work(i);"
+                "}", "<declarations>");
+  });
+
+  vm.set_profiling(true);
+  EXPECT_TRUE(vm.is_profiling());
+
+  std::vector<VirtualMachine::Value> args;
+  args.push_back(VirtualMachine::Value(1));
+  for (int i = 0; i < 3; i++)
+  {
+    ASSERT_NO_THROW({ vm.call_function("work", args); });
+  }
+
+  vm.set_profiling(false);
+
+  // Not recorded
+  ASSERT_NO_THROW({ vm.call_function("work", args); });
+
+  auto entries = vm.get_profiler().get_entries();
+  size_t work_calls = 0, native_calls = 0;
+  for (const auto& entry : entries)
+  {
+    if (entry.name == "work (<declarations>)")
+      work_calls = entry.calls;
+    if (entry.name == "native_work (native)")
+      native_calls = entry.calls;
+  }
+
+  EXPECT_EQ(work_calls, 3u);
+  EXPECT_EQ(native_calls, 3u);
+
+  std::stringstream trace;
+  vm.get_profiler().write_trace(trace);
+  EXPECT_NE(trace.str().find("native_work (native)"), std::string::npos);
+}
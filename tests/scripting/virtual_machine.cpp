@@ -28,45 +28,50 @@
 #undef protected
 #undef final
 
-#define COMMA ,
-#define COMMA1 COMMA
-
-template<typename T, typename V>
-void
-test_type()
+TEST(Scripting_VirtualMachine_Value, strings)
 {
-  auto bound = VirtualMachine::bind(std::function<void(T)>([](T){}));
-  std::vector<std::unique_ptr<VirtualMachine::Type>> args;
-  args.push_back(std::make_unique<V>());
-  bound.first(args);
+  std::string small("Hello");
+  std::string large("This string is too long to be stored inline");
+
+  VirtualMachine::Value a(small);
+  VirtualMachine::Value b(large);
+
+  ASSERT_EQ(a.get_type(), VirtualMachine::Types::STRING);
+  ASSERT_EQ(std::string(a.get_string()), small);
+  ASSERT_EQ(std::string(b.get_string()), large);
+  ASSERT_NE(b.get_string(), large.c_str());
+  ASSERT_EQ(b.get_string_size(), large.size());
+
+  VirtualMachine::Value d(b);
+  ASSERT_EQ(std::string(d.get_string()), large);
+  ASSERT_NE(d.get_string(), b.get_string());
+
+  VirtualMachine::Value e(std::move(d));
+  ASSERT_EQ(std::string(e.get_string()), large);
+  ASSERT_EQ(d.get_type(), VirtualMachine::Types::NONE);
+
+  e = a;
+  ASSERT_EQ(std::string(e.get_string()), small);
+  a = 4;
+  ASSERT_EQ(a.get_int(), 4);
+  ASSERT_THROW(a.get_string(), std::runtime_error);
 }
 
-TEST(Scripting_VirtualMachine_SingleArg, parse)
+TEST(Scripting_VirtualMachine, bind)
 {
-  ASSERT_NO_THROW((test_type<bool, VirtualMachine::Boolean>()));
-  ASSERT_NO_THROW((test_type<float, VirtualMachine::Float>()));
-  ASSERT_NO_THROW((test_type<int, VirtualMachine::Integer>()));
-  ASSERT_NO_THROW((test_type<Scriptable*, VirtualMachine::Object>()));
-  ASSERT_NO_THROW((test_type<std::string, VirtualMachine::String>()));
+  auto bound = VirtualMachine::bind(std::function<std::string(int, std::string)>(
+    [](int i, std::string s) { return s + std::to_string(i); }
+  ));
+
+  auto func = static_cast<std::function<std::string(int, std::string)>*>(
+                bound.m_callable.get());
+  ASSERT_NE(func, nullptr);
+  ASSERT_EQ((*func)(7, "Value"), "Value7");
 
-  ASSERT_THROW((test_type<bool, VirtualMachine::Float>()), std::runtime_error);
-  ASSERT_THROW((test_type<bool, VirtualMachine::Integer>()), std::runtime_error);
-  ASSERT_THROW((test_type<bool, VirtualMachine::Object>()), std::runtime_error);
-  ASSERT_THROW((test_type<bool, VirtualMachine::String>()), std::runtime_error);
-  ASSERT_THROW((test_type<float, VirtualMachine::Boolean>()), std::runtime_error);
-  ASSERT_THROW((test_type<float, VirtualMachine::Integer>()), std::runtime_error);
-  ASSERT_THROW((test_type<float, VirtualMachine::Object>()), std::runtime_error);
-  ASSERT_THROW((test_type<float, VirtualMachine::String>()), std::runtime_error);
-  ASSERT_THROW((test_type<int, VirtualMachine::Boolean>()), std::runtime_error);
-  ASSERT_THROW((test_type<int, VirtualMachine::Float>()), std::runtime_error);
-  ASSERT_THROW((test_type<int, VirtualMachine::Object>()), std::runtime_error);
-  ASSERT_THROW((test_type<int, VirtualMachine::String>()), std::runtime_error);
-  ASSERT_THROW((test_type<Scriptable*, VirtualMachine::Boolean>()), std::runtime_error);
-  ASSERT_THROW((test_type<Scriptable*, VirtualMachine::Float>()), std::runtime_error);
-  ASSERT_THROW((test_type<Scriptable*, VirtualMachine::Integer>()), std::runtime_error);
-  ASSERT_THROW((test_type<Scriptable*, VirtualMachine::String>()), std::runtime_error);
-  ASSERT_THROW((test_type<std::string, VirtualMachine::Boolean>()), std::runtime_error);
-  ASSERT_THROW((test_type<std::string, VirtualMachine::Float>()), std::runtime_error);
-  ASSERT_THROW((test_type<std::string, VirtualMachine::Integer>()), std::runtime_error);
-  ASSERT_THROW((test_type<std::string, VirtualMachine::Object>()), std::runtime_error);
+#if HARBOR_USE_SCRIPTING_SQUIRREL
+  ASSERT_NE(bound.m_squirrel_thunk, nullptr);
+#endif
+#if HARBOR_USE_SCRIPTING_LUA
+  ASSERT_NE(bound.m_lua_thunk, nullptr);
+#endif
 }
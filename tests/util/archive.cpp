@@ -0,0 +1,96 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "util/archive.hpp"
+
+namespace {
+
+void
+write_file(const std::string& file, const std::string& contents)
+{
+  std::ofstream out(file, std::ios::binary);
+  out << contents;
+}
+
+std::string
+find_string(const Archive& archive, const std::string& path)
+{
+  const uint8_t* data;
+  size_t size;
+
+  if (!archive.find(path, data, size))
+    return "<missing>";
+
+  return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+} // namespace
+
+TEST(Util_Archive, create_and_find)
+{
+  write_file("archive_test_a.txt", "Hello, world!");
+  write_file("archive_test_b.txt", "");
+  write_file("archive_test_c.txt", std::string(100, 'c'));
+
+  std::map<std::string, std::string> files;
+  files["images/b.png"] = "archive_test_b.txt";
+  files["a.txt"] = "archive_test_a.txt";
+  files["images/c.png"] = "archive_test_c.txt";
+  files["images"] = "archive_test_a.txt";
+  Archive::create("archive_test.hpak", files);
+
+  {
+    Archive archive("archive_test.hpak");
+    ASSERT_EQ(archive.get_entry_count(), 4u);
+    EXPECT_EQ(find_string(archive, "a.txt"), "Hello, world!");
+    EXPECT_EQ(find_string(archive, "images"), "Hello, world!");
+    EXPECT_EQ(find_string(archive, "images/b.png"), "");
+    EXPECT_EQ(find_string(archive, "images/c.png"), std::string(100, 'c'));
+    EXPECT_EQ(find_string(archive, "images/"), "<missing>");
+    EXPECT_EQ(find_string(archive, "a.tx"), "<missing>");
+    EXPECT_EQ(find_string(archive, "z"), "<missing>");
+
+    const uint8_t* data;
+    size_t size;
+    ASSERT_TRUE(archive.find("images/c.png", data, size));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % 16, 0u);
+  }
+
+  std::remove("archive_test.hpak");
+  std::remove("archive_test_a.txt");
+  std::remove("archive_test_b.txt");
+  std::remove("archive_test_c.txt");
+}
+
+TEST(Util_Archive, invalid)
+{
+  ASSERT_THROW(Archive("archive_test_missing.hpak"), std::runtime_error);
+
+  write_file("archive_test_invalid.hpak", "HPAK");
+  ASSERT_THROW(Archive("archive_test_invalid.hpak"), std::runtime_error);
+
+  write_file("archive_test_invalid.hpak", "Not an archive at all");
+  ASSERT_THROW(Archive("archive_test_invalid.hpak"), std::runtime_error);
+
+  std::remove("archive_test_invalid.hpak");
+}
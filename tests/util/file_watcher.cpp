@@ -0,0 +1,92 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/file_watcher.hpp"
+
+#ifdef __linux__
+
+namespace {
+
+std::vector<std::string>
+wait_for_changes(FileWatcher& watcher)
+{
+  for (int i = 0; i < 200; i++)
+  {
+    auto changes = watcher.poll_changes();
+    if (!changes.empty())
+      return changes;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return {};
+}
+
+} // namespace
+
+TEST(Util_FileWatcher, changes)
+{
+  ASSERT_TRUE(FileWatcher::is_supported());
+
+  mkdir("file_watcher_test", 0755);
+  mkdir("file_watcher_test/sub", 0755);
+
+  {
+    FileWatcher watcher("file_watcher_test/");
+    ASSERT_TRUE(watcher.poll_changes().empty());
+
+    std::ofstream("file_watcher_test/sub/a.txt") << "a";
+    auto changes = wait_for_changes(watcher);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], "file_watcher_test/sub/a.txt");
+
+    // Directories created after the watcher started are watched too
+    mkdir("file_watcher_test/new", 0755);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::ofstream("file_watcher_test/new/b.txt") << "b";
+    changes = wait_for_changes(watcher);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], "file_watcher_test/new/b.txt");
+  }
+
+  std::remove("file_watcher_test/new/b.txt");
+  std::remove("file_watcher_test/sub/a.txt");
+  rmdir("file_watcher_test/new");
+  rmdir("file_watcher_test/sub");
+  rmdir("file_watcher_test");
+}
+
+#else
+
+TEST(Util_FileWatcher, unsupported)
+{
+  ASSERT_FALSE(FileWatcher::is_supported());
+}
+
+#endif
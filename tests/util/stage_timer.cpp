@@ -0,0 +1,47 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "util/stage_timer.hpp"
+
+TEST(Util_StageTimer, stages)
+{
+  StageTimer timer;
+  timer.begin("first");
+  timer.begin("second");
+  timer.add_parallel("workers", 1000.f);
+  timer.end();
+  timer.end();
+
+  const auto& stages = timer.get_stages();
+  ASSERT_EQ(stages.size(), 3u);
+  EXPECT_EQ(stages[0].name, "first");
+  EXPECT_EQ(stages[1].name, "second");
+  EXPECT_FALSE(stages[1].parallel);
+  EXPECT_TRUE(stages[2].parallel);
+  EXPECT_EQ(stages[2].time, 1000.f);
+
+  // Parallel work doesn't count towards the total
+  EXPECT_LT(timer.get_total(), 1000.f);
+  EXPECT_FLOAT_EQ(timer.get_total(), stages[0].time + stages[1].time);
+
+  std::ostringstream out;
+  timer.print(out);
+  EXPECT_NE(out.str().find("workers"), std::string::npos);
+  EXPECT_NE(out.str().find("total"), std::string::npos);
+}
@@ -0,0 +1,66 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "util/thread_pool.hpp"
+
+TEST(Util_ThreadPool, submit)
+{
+  ThreadPool pool(4);
+  std::atomic<int> count(0);
+  std::vector<std::future<int>> results;
+
+  for (int i = 0; i < 100; i++)
+  {
+    results.push_back(pool.submit([&count, i] {
+      count++;
+      return i * 2;
+    }));
+  }
+
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(results[i].get(), i * 2);
+
+  pool.wait_idle();
+  EXPECT_EQ(count, 100);
+  EXPECT_EQ(pool.get_queued_count(), 0u);
+}
+
+TEST(Util_ThreadPool, exceptions)
+{
+  ThreadPool pool(1);
+  auto result = pool.submit([]() -> int {
+    throw std::runtime_error("failed");
+  });
+
+  EXPECT_THROW(result.get(), std::runtime_error);
+}
+
+TEST(Util_ThreadPool, synchronous)
+{
+  ThreadPool pool(0);
+  bool ran = false;
+
+  pool.submit([&ran] { ran = true; });
+
+  EXPECT_EQ(pool.get_thread_count(), 0u);
+  EXPECT_TRUE(ran);
+}
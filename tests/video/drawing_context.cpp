@@ -16,75 +16,8 @@
 
 #include "gtest/gtest.h"
 
-#include <sstream>
-
 #include "video/drawing_context.hpp"
-#include "video/sdl/sdl_window.hpp"
-
-#if 0
-static SDLWindow w;
-
-class MockRenderer :
-  public Renderer
-{
-public:
-  MockRenderer() :
-    Renderer(w)
-  {
-  }
-
-  virtual ~MockRenderer() = default;
-
-  virtual void draw_filled_rect(const Rect& rect, const Color& color,
-                                const Blend& blend) override
-  {
-    m_log << "draw_filled_rect(" << rect << ", " << color << ", "
-          << static_cast<int>(blend) << ");\n";
-  }
-
-  virtual void draw_texture(const Texture& /* texture */, const Rect& srcrect,
-                            const Rect& dstrect, float angle,
-                            const Color& color, const Blend& blend) override
-  {
-    m_log << "draw_texture(..., " << srcrect << ", " << dstrect << ", "
-          << angle << ", " << color << ", " << static_cast<int>(blend)
-          << ");\n";
-  }
-
-  virtual void draw_text(const std::string& text, const Vector& pos,
-                         const Rect& clip, TextAlign align,
-                         const std::string& fontfile, int size,
-                         const Color& color, const Blend& blend) override
-  {
-    m_log << "draw_text(" << text << ", " << pos << ", " << clip << ", "
-          << static_cast<int>(align) << ", " << fontfile << ", " << size
-          << ", " << color << ", " << static_cast<int>(blend) << ");\n";
-  }
-
-  virtual void draw_line(const Vector& p1, const Vector& p2, const Color& color,
-                         const Blend& blend) override
-  {
-    m_log << "draw_text(" << p1 << ", " << p2 << ", " << color << ", "
-          << static_cast<int>(blend) << ");\n";
-  }
-
-  virtual void start_draw(Texture* texture = nullptr)
-  {
-    m_log << "start_draw(" << (texture ? "..." : "nullptr") << ");\n";
-  }
-
-  virtual void end_draw()
-  {
-    m_log << "end_draw();\n";
-  }
-
-public:
-  std::stringstream m_log;
-
-private:
-  MockRenderer(const MockRenderer&) = delete;
-  MockRenderer& operator=(const MockRenderer&) = delete;
-};
+#include "video/recording_renderer.hpp"
 
 TEST(Video_DrawingContext, clip_src_rect)
 {
@@ -121,13 +54,13 @@ TEST(Video_DrawingContext, clip_src_rect)
 
 TEST(Video_DrawingContext, ctor_dtor)
 {
-  MockRenderer r;
+  RecordingRenderer r;
   DrawingContext dc(r);
 }
 
-TEST(DrawingContext, _stress_test)
+TEST(Video_DrawingContext, _stress_test)
 {
-  MockRenderer r;
+  RecordingRenderer r;
   DrawingContext dc(r);
 
   dc.get_transform().move(Vector(10, 10));
@@ -141,7 +74,24 @@ TEST(DrawingContext, _stress_test)
 
   dc.render();
 
-  EXPECT_EQ(r.m_log.str(), "start_draw(nullptr);\ndraw_filled_rect(Rect(20, 23,"
-                           " 110, 35), Color(1, 1, 1, 1), 1);\nend_draw();\n");
+  EXPECT_EQ(r.dump(), "start_draw(nullptr);\ndraw_filled_rect(Rect(20, 23,"
+                      " 110, 35), Color(1, 1, 1, 1), 1);\nend_draw();\n");
+}
+
+TEST(Video_DrawingContext, draw_polyline)
+{
+  RecordingRenderer r;
+  DrawingContext dc(r);
+
+  dc.draw_polyline({ Vector(0, 0), Vector(10, 0), Vector(10, 10) },
+                   Color(1, 0, 0), Renderer::Blend::NONE, 0, true);
+  dc.draw_polyline({ Vector(5, 5) }, Color(1, 0, 0), Renderer::Blend::NONE, 0);
+
+  dc.render();
+
+  EXPECT_EQ(r.get_command_count(), 3u);
+  EXPECT_EQ(r.dump(), "start_draw(nullptr);\ndraw_lines({Vector(0, 0), "
+                      "Vector(10, 0), Vector(10, 0), Vector(10, 10), "
+                      "Vector(10, 10), Vector(0, 0)}, Color(1, 0, 0, 1), 0);\n"
+                      "end_draw();\n");
 }
-#endif
@@ -0,0 +1,64 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "video/font.hpp"
+
+TEST(Video_Font, handles)
+{
+  Font::Handle invalid;
+  EXPECT_FALSE(invalid.is_valid());
+  EXPECT_THROW(invalid.get_file(), std::runtime_error);
+
+  // Registering a font must not open it
+  auto a = Font::get_handle("missing.ttf", 12);
+  auto b = Font::get_handle("missing.ttf", 14);
+  auto c = Font::get_handle("other.ttf", 12);
+
+  EXPECT_TRUE(a.is_valid());
+  EXPECT_EQ(a, Font::get_handle("missing.ttf", 12));
+  EXPECT_NE(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(b.get_file(), "missing.ttf");
+  EXPECT_EQ(b.get_size(), 14);
+
+  auto sdf = Font::get_handle("missing.ttf", 12, true);
+  EXPECT_NE(a, sdf);
+  EXPECT_TRUE(sdf.is_sdf());
+  EXPECT_FALSE(a.is_sdf());
+  EXPECT_EQ(sdf.get_size(), 12);
+  EXPECT_EQ(sdf, Font::get_handle("missing.ttf", 12, true));
+
+  Font::flush_fonts();
+  EXPECT_FALSE(a.is_valid());
+  EXPECT_THROW(Font::get_font(a), std::runtime_error);
+  EXPECT_TRUE(Font::get_handle("missing.ttf", 12).is_valid());
+}
+
+TEST(Video_Font, get_caret_at)
+{
+  std::vector<float> offsets{ 0.f, 5.f, 10.f, 10.f, 20.f };
+
+  EXPECT_EQ(Font::get_caret_at(offsets, -3.f), 0u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 2.f), 0u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 2.5f), 0u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 3.f), 1u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 11.f), 2u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 16.f), 4u);
+  EXPECT_EQ(Font::get_caret_at(offsets, 100.f), 4u);
+  EXPECT_EQ(Font::get_caret_at(std::vector<float>(), 1.f), 0u);
+}
@@ -0,0 +1,108 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "video/drawing_context.hpp"
+#include "video/frame_capture.hpp"
+#include "video/recording_renderer.hpp"
+#include "video/texture.hpp"
+
+namespace {
+
+class DummyTexture final :
+  public Texture
+{
+public:
+  DummyTexture(const Size& size, const std::string& file) :
+    Texture(size, file)
+  {
+  }
+};
+
+} // namespace
+
+TEST(Video_FrameCapture, save_load_replay)
+{
+  RecordingRenderer r;
+  DrawingContext dc(r);
+  DummyTexture image(Size(16, 8), "image.png"), canvas(Size(4, 4), "");
+
+  FrameCapture capture;
+
+  dc.draw_filled_rect(Rect(0, 0, 4, 4), Color(1, 0, 0), Renderer::Blend::NONE,
+                      0);
+  capture.record(dc, &canvas);
+  dc.clear();
+
+  dc.draw_texture(image, Rect(0, 0, 16, 8), Rect(0, 0, 32, 16), 0.f,
+                  Color(1, 1, 1), Renderer::Blend::BLEND, 0);
+  dc.draw_texture(canvas, Rect(0, 0, 4, 4), Rect(0, 0, 4, 4), 0.f,
+                  Color(1, 1, 1), Renderer::Blend::BLEND, 1);
+  dc.draw_text("Hello", Vector(1, 2), Renderer::TextAlign::TOP_LEFT,
+               "font.ttf", 16, Color(1, 1, 1), Renderer::Blend::BLEND, 2);
+  capture.record(dc);
+  capture.end_frame();
+
+  capture.record(dc);
+  capture.end_frame();
+
+  ASSERT_EQ(capture.get_frame_count(), 2u);
+  ASSERT_EQ(capture.get_textures().size(), 2u);
+  EXPECT_EQ(capture.get_textures()[0].file, "");
+  EXPECT_EQ(capture.get_textures()[1].file, "image.png");
+  EXPECT_EQ(capture.get_textures()[1].size, Size(16, 8));
+  ASSERT_EQ(capture.get_fonts().size(), 1u);
+
+  const std::string file = "harbor_test_capture.hbrc";
+  capture.save(file);
+  FrameCapture loaded(file);
+  std::remove(file.c_str());
+
+  ASSERT_EQ(loaded.get_frame_count(), 2u);
+  EXPECT_EQ(loaded.get_textures()[1].file, "image.png");
+  EXPECT_EQ(loaded.get_fonts(), capture.get_fonts());
+  ASSERT_THROW(loaded.record(dc), std::runtime_error);
+
+  RecordingRenderer expected, replayed;
+  std::vector<Texture*> textures = { &canvas, &image };
+  capture.replay(0, expected, textures);
+  loaded.replay(0, replayed, textures);
+
+  EXPECT_EQ(replayed.dump(), expected.dump());
+  EXPECT_EQ(replayed.get_command_count(), 8u);
+  ASSERT_THROW(loaded.replay(2, replayed, textures), std::runtime_error);
+}
+
+TEST(Video_FrameCapture, invalid_file)
+{
+  ASSERT_THROW(FrameCapture("harbor_test_missing.hbrc"), std::runtime_error);
+
+  // Counts larger than the file are rejected before allocating
+  const std::string file = "harbor_test_corrupt.hbrc";
+  {
+    std::ofstream out(file, std::ios::binary);
+    const uint32_t version = FrameCapture::VERSION, count = 0xFFFFFFFF;
+    out.write("HBRC", 4);
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  EXPECT_THROW(FrameCapture capture(file), std::runtime_error);
+  std::remove(file.c_str());
+}
@@ -0,0 +1,104 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+#include "SDL.h"
+
+#include "util/stage_timer.hpp"
+#include "util/thread_pool.hpp"
+#include "video/preloader.hpp"
+
+#if HARBOR_USE_VIDEO_SOFTWARE
+#include "video/software/software_window.hpp"
+#endif
+
+TEST(Video_Preloader, parse_manifest)
+{
+  std::istringstream in(
+    "# Comment\n"
+    "\n"
+    "texture images/a.png\n"
+    "  font fonts/b.ttf 16\n"
+    "font /abs/c.ttf 32 sdf\n"
+    "sound music/d.wav\n");
+
+  auto entries = Preloader::parse_manifest(in, "data");
+  ASSERT_EQ(entries.size(), 4u);
+
+  EXPECT_EQ(entries[0].kind, Preloader::Kind::TEXTURE);
+  EXPECT_EQ(entries[0].file, "data/images/a.png");
+  EXPECT_EQ(entries[1].kind, Preloader::Kind::FONT);
+  EXPECT_EQ(entries[1].file, "data/fonts/b.ttf");
+  EXPECT_EQ(entries[1].size, 16);
+  EXPECT_FALSE(entries[1].sdf);
+  EXPECT_EQ(entries[2].file, "/abs/c.ttf");
+  EXPECT_EQ(entries[2].size, 32);
+  EXPECT_TRUE(entries[2].sdf);
+  EXPECT_EQ(entries[3].kind, Preloader::Kind::SOUND);
+  EXPECT_EQ(entries[3].file, "data/music/d.wav");
+}
+
+TEST(Video_Preloader, parse_manifest_errors)
+{
+  std::istringstream unknown("model a.obj\n");
+  ASSERT_THROW(Preloader::parse_manifest(unknown, ""), std::runtime_error);
+
+  std::istringstream no_path("texture\n");
+  ASSERT_THROW(Preloader::parse_manifest(no_path, ""), std::runtime_error);
+
+  std::istringstream no_size("font a.ttf\n");
+  ASSERT_THROW(Preloader::parse_manifest(no_size, ""), std::runtime_error);
+
+  std::istringstream bad_option("font a.ttf 12 bold\n");
+  ASSERT_THROW(Preloader::parse_manifest(bad_option, ""), std::runtime_error);
+}
+
+#if HARBOR_USE_VIDEO_SOFTWARE
+TEST(Video_Preloader, textures)
+{
+  SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, 4, 2, 32,
+                                                  SDL_PIXELFORMAT_RGBA32);
+  SDL_SaveBMP(s, "preloader_test.bmp");
+  SDL_FreeSurface(s);
+
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  StageTimer timer;
+
+  std::vector<Preloader::Entry> entries = {
+    { Preloader::Kind::TEXTURE, "preloader_test.bmp", 0, false },
+    { Preloader::Kind::TEXTURE, "preloader_missing.bmp", 0, false }
+  };
+
+  Preloader preloader(entries, pool);
+  preloader.finish(w, timer);
+
+  // The missing texture is skipped; the other one is in the cache
+  ASSERT_EQ(w.get_cached_texture_count(), 1u);
+  ASSERT_EQ(w.load_texture("preloader_test.bmp")->get_size(), Size(4, 2));
+  ASSERT_EQ(w.get_cached_texture_count(), 1u);
+  ASSERT_EQ(preloader.get_sound("preloader_test.bmp"), nullptr);
+
+  ASSERT_FALSE(timer.get_stages().empty());
+  ASSERT_TRUE(timer.get_stages().back().parallel);
+
+  std::remove("preloader_test.bmp");
+}
+#endif
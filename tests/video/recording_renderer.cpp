@@ -0,0 +1,129 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+#include "util/color.hpp"
+#include "util/rect.hpp"
+#include "util/vector.hpp"
+#include "video/null_renderer.hpp"
+#include "video/recording_renderer.hpp"
+
+TEST(Video_NullRenderer, no_window)
+{
+  NullRenderer r;
+
+  ASSERT_FALSE(r.has_window());
+  ASSERT_THROW(r.get_window(), std::runtime_error);
+
+  r.start_draw();
+  ASSERT_NO_THROW(r.draw_filled_rect(Rect(0, 0, 1, 1), Color(1, 1, 1),
+                                     Renderer::Blend::NONE));
+  r.end_draw();
+  ASSERT_THROW(r.end_draw(), std::runtime_error);
+}
+
+TEST(Video_RecordingRenderer, command_stream)
+{
+  RecordingRenderer r;
+
+  r.start_draw();
+  r.draw_line(Vector(1, 2), Vector(3, 4), Color(0, 1, 0),
+              Renderer::Blend::ADD);
+  r.draw_text("Hi", Vector(5, 6), Rect(0, 0, 10, 10),
+              Renderer::TextAlign::CENTER, Font::get_handle("font.ttf", 12),
+              Color(1, 1, 1), Renderer::Blend::BLEND);
+  r.end_draw();
+
+  EXPECT_EQ(r.get_command_count(), 4u);
+  EXPECT_EQ(r.dump(), "start_draw(nullptr);\n"
+                      "draw_line(Vector(1, 2), Vector(3, 4), Color(0, 1, 0, 1),"
+                      " 2);\n"
+                      "draw_text(Hi, Vector(5, 6), Rect(0, 0, 10, 10), 4, "
+                      "font.ttf, 12, Color(1, 1, 1, 1), 1);\n"
+                      "end_draw();\n");
+
+  // 1 + 4 bytes for start_draw, 1 + 16 + 16 + 4 for the line, ...
+  const size_t text_size = 1 + (4 + 2) + 8 + 16 + 1 + 4 + 16 + 4;
+  EXPECT_EQ(r.get_buffer().size(), 5u + 37u + text_size + 1u);
+  ASSERT_EQ(r.get_fonts().size(), 1u);
+  EXPECT_EQ(r.get_fonts()[0], RecordingRenderer::FontKey("font.ttf", 12));
+
+  r.clear();
+  EXPECT_EQ(r.get_command_count(), 0u);
+  EXPECT_EQ(r.dump(), "");
+
+  // Fonts keep their index after clearing
+  r.draw_text("Ho", Vector(), Rect(), Renderer::TextAlign::TOP_LEFT,
+              Font::get_handle("font.ttf", 12), Color(1, 1, 1),
+              Renderer::Blend::BLEND);
+  EXPECT_EQ(r.get_fonts().size(), 1u);
+}
+
+TEST(Video_RecordingRenderer, replay)
+{
+  RecordingRenderer r1, r2;
+
+  r1.start_draw();
+  r1.draw_filled_rect(Rect(1, 2, 3, 4), Color(1, 0, 1),
+                      Renderer::Blend::MODULATE);
+  r1.draw_lines({ Vector(0, 0), Vector(1, 1) }, Color(1, 1, 1),
+                Renderer::Blend::NONE);
+  r1.end_draw();
+
+  RecordingRenderer::replay(r1.get_buffer().data(), r1.get_buffer().size(), r2,
+                            {}, r1.get_fonts());
+
+  EXPECT_EQ(r1.get_buffer(), r2.get_buffer());
+  EXPECT_EQ(r1.dump(), r2.dump());
+
+  // Truncated buffers are rejected
+  ASSERT_THROW(RecordingRenderer::replay(r1.get_buffer().data(), 10, r2, {},
+                                         {}),
+               std::runtime_error);
+
+  // Point counts larger than the buffer are rejected before allocating
+  RecordingRenderer r3;
+  r3.draw_lines({ Vector(0, 0) }, Color(1, 1, 1), Renderer::Blend::NONE);
+  std::vector<uint8_t> lines = r3.get_buffer();
+  const uint32_t count = 0xFFFFFFFF;
+  std::memcpy(lines.data() + 1, &count, sizeof(count));
+  ASSERT_THROW(RecordingRenderer::replay(lines.data(), lines.size(), r2, {},
+                                         {}),
+               std::runtime_error);
+
+  // Blend modes and alignments outside of their enumerations are rejected
+  RecordingRenderer r4;
+  r4.draw_filled_rect(Rect(), Color(1, 1, 1), Renderer::Blend::NONE);
+  std::vector<uint8_t> rect = r4.get_buffer();
+  const int32_t blend = 3;
+  std::memcpy(rect.data() + 1 + 16 + 16, &blend, sizeof(blend));
+  ASSERT_THROW(RecordingRenderer::replay(rect.data(), rect.size(), r2, {},
+                                         {}),
+               std::runtime_error);
+
+  RecordingRenderer r5;
+  r5.draw_text("Hi", Vector(), Rect(), Renderer::TextAlign::TOP_LEFT,
+               Font::get_handle("font.ttf", 12), Color(1, 1, 1),
+               Renderer::Blend::NONE);
+  std::vector<uint8_t> text = r5.get_buffer();
+  text[1 + (4 + 2) + 8 + 16] = 9;
+  ASSERT_THROW(RecordingRenderer::replay(text.data(), text.size(), r2, {},
+                                         r5.get_fonts()),
+               std::runtime_error);
+}
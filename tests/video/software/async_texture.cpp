@@ -0,0 +1,131 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "SDL.h"
+
+#include "util/log.hpp"
+#include "util/thread_pool.hpp"
+#include "video/async_texture.hpp"
+
+#define private public
+
+#include "video/software/software_window.hpp"
+
+#undef private
+
+namespace {
+
+void
+save_image(const std::string& file, int w, int h)
+{
+  SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32,
+                                                  SDL_PIXELFORMAT_RGBA32);
+  SDL_SaveBMP(s, file.c_str());
+  SDL_FreeSurface(s);
+}
+
+} // namespace
+
+TEST(Video_AsyncTexture, shared_per_file)
+{
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+
+  auto a = w.load_texture_async("missing_file.png");
+  auto b = w.load_texture_async("missing_file.png");
+  auto c = w.load_texture_async("other_missing_file.png");
+
+  ASSERT_EQ(a, b);
+  ASSERT_NE(a, c);
+  ASSERT_EQ(a->get_file(), "missing_file.png");
+  ASSERT_EQ(w.get_loading_count(), 2u);
+}
+
+TEST(Video_AsyncTexture, failure)
+{
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+
+  auto t = w.load_texture_async("missing_file.png");
+  ASSERT_FALSE(t->is_ready());
+  ASSERT_FALSE(t->has_failed());
+  ASSERT_EQ(t->get(), nullptr);
+
+  w.upload_textures();
+  ASSERT_FALSE(t->is_ready());
+  ASSERT_TRUE(t->has_failed());
+  ASSERT_EQ(t->get(), nullptr);
+  ASSERT_EQ(w.get_loading_count(), 0u);
+}
+
+TEST(Video_AsyncTexture, success)
+{
+  save_image("async_texture_test.bmp", 4, 2);
+  save_image("async_texture_placeholder.bmp", 1, 1);
+
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+  w.set_placeholder_texture("async_texture_placeholder.bmp");
+
+  auto t = w.load_texture_async("async_texture_test.bmp");
+  auto placeholder = t->get();
+  ASSERT_FALSE(t->is_ready());
+  ASSERT_NE(placeholder, nullptr);
+  ASSERT_EQ(placeholder->get_size(), Size(1, 1));
+
+  w.upload_textures();
+  ASSERT_TRUE(t->is_ready());
+  ASSERT_FALSE(t->has_failed());
+  ASSERT_NE(t->get(), placeholder);
+  ASSERT_EQ(t->get()->get_size(), Size(4, 2));
+  ASSERT_EQ(w.get_loading_count(), 0u);
+
+  std::remove("async_texture_test.bmp");
+  std::remove("async_texture_placeholder.bmp");
+}
+
+TEST(Video_AsyncTexture, prune)
+{
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+
+  std::ostream* old_log = Log::s_log;
+  std::stringstream ss;
+  Log::s_log = &ss;
+
+  auto kept = w.load_texture_async("kept_missing_file.png");
+
+  // Each handle expires once its load has failed and it was dropped
+  for (int i = 0; i < 1000; i++)
+  {
+    w.load_texture_async("missing_file_" + std::to_string(i) + ".png");
+    w.upload_textures();
+  }
+
+  Log::s_log = old_log;
+
+  ASSERT_LE(w.m_async_textures.size(), 32u);
+  ASSERT_EQ(w.load_texture_async("kept_missing_file.png"), kept);
+}
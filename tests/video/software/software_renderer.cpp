@@ -0,0 +1,193 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "util/color.hpp"
+#include "util/rect.hpp"
+#include "util/vector.hpp"
+#include "video/software/software_blend.hpp"
+#include "video/software/software_texture.hpp"
+#include "video/software/software_window.hpp"
+
+namespace {
+
+void
+expect_pixel(const SoftwareTexture& t, int x, int y, uint8_t r, uint8_t g,
+             uint8_t b, uint8_t a)
+{
+  uint8_t pr, pg, pb, pa;
+  SoftwareBlend::unpack(t.get_pixel(x, y), pr, pg, pb, pa);
+  EXPECT_EQ(pr, r) << "at " << x << ", " << y;
+  EXPECT_EQ(pg, g) << "at " << x << ", " << y;
+  EXPECT_EQ(pb, b) << "at " << x << ", " << y;
+  EXPECT_EQ(pa, a) << "at " << x << ", " << y;
+}
+
+} // namespace
+
+TEST(Video_Software_SoftwareRenderer, is_drawing)
+{
+  SoftwareWindow w(Size(8, 8));
+  auto& r = w.get_renderer();
+
+  ASSERT_EQ(r.is_drawing(), false);
+  ASSERT_THROW(r.end_draw(), std::runtime_error);
+  r.start_draw();
+  ASSERT_EQ(r.is_drawing(), true);
+  ASSERT_THROW(r.start_draw(), std::runtime_error);
+  r.end_draw();
+  ASSERT_EQ(r.is_drawing(), false);
+  ASSERT_THROW(r.draw_filled_rect(Rect(0, 0, 1, 1), Color(1, 1, 1),
+                                  Renderer::Blend::NONE), std::runtime_error);
+}
+
+TEST(Video_Software_SoftwareRenderer, draw_filled_rect)
+{
+  SoftwareWindow w(Size(8, 8));
+  auto& r = w.get_renderer();
+
+  r.start_draw();
+  r.draw_filled_rect(Rect(2, 2, 6, 6), Color(1, 0, 0), Renderer::Blend::NONE);
+  // Partially off-screen rectangles are clipped
+  r.draw_filled_rect(Rect(-4, -4, 1, 1), Color(0, 0, 1), Renderer::Blend::NONE);
+  r.end_draw();
+
+  const auto& frame = w.get_frame();
+  expect_pixel(frame, 2, 2, 255, 0, 0, 255);
+  expect_pixel(frame, 5, 5, 255, 0, 0, 255);
+  expect_pixel(frame, 6, 6, 0, 0, 0, 0);
+  expect_pixel(frame, 1, 1, 0, 0, 0, 0);
+  expect_pixel(frame, 0, 0, 0, 0, 255, 255);
+
+  // Presenting starts the next frame from a cleared back buffer
+  expect_pixel(w.get_back_buffer(), 2, 2, 0, 0, 0, 0);
+}
+
+TEST(Video_Software_SoftwareRenderer, blend_modes)
+{
+  SoftwareWindow w(Size(8, 1));
+  auto& r = w.get_renderer();
+
+  r.start_draw();
+  r.draw_filled_rect(Rect(0, 0, 8, 1), Color(.2f, .4f, .6f),
+                     Renderer::Blend::NONE);
+  r.draw_filled_rect(Rect(0, 0, 2, 1), Color(1, 1, 1, .5f),
+                     Renderer::Blend::BLEND);
+  r.draw_filled_rect(Rect(2, 0, 4, 1), Color(1, 1, 1, .5f),
+                     Renderer::Blend::ADD);
+  r.draw_filled_rect(Rect(4, 0, 6, 1), Color(.5f, .5f, .5f, 0),
+                     Renderer::Blend::MODULATE);
+  r.draw_filled_rect(Rect(6, 0, 8, 1), Color(1, 1, 1, 0),
+                     Renderer::Blend::NONE);
+  r.end_draw();
+
+  const auto& frame = w.get_frame();
+  expect_pixel(frame, 0, 0, 153, 178, 204, 255);
+  expect_pixel(frame, 2, 0, 178, 229, 255, 255);
+  expect_pixel(frame, 4, 0, 25, 51, 76, 255);
+  expect_pixel(frame, 6, 0, 255, 255, 255, 0);
+}
+
+TEST(Video_Software_SoftwareRenderer, simd_matches_scalar)
+{
+  std::vector<uint32_t> src, dst;
+  for (int i = 0; i < 37; i++)
+  {
+    src.push_back(SoftwareBlend::pack(static_cast<uint8_t>(i * 7),
+                                      static_cast<uint8_t>(255 - i * 3),
+                                      static_cast<uint8_t>(i * 11),
+                                      static_cast<uint8_t>(i * 13)));
+    dst.push_back(SoftwareBlend::pack(static_cast<uint8_t>(255 - i * 5),
+                                      static_cast<uint8_t>(i * 2),
+                                      static_cast<uint8_t>(128),
+                                      static_cast<uint8_t>(i * 6)));
+  }
+
+  const Renderer::Blend modes[] = { Renderer::Blend::NONE,
+                                    Renderer::Blend::BLEND,
+                                    Renderer::Blend::ADD,
+                                    Renderer::Blend::MODULATE };
+  const uint32_t mod = SoftwareBlend::pack(200, 100, 255, 128);
+
+  for (auto mode : modes)
+  {
+    auto simd = dst, scalar = dst;
+    SoftwareBlend::span(simd.data(), src.data(), src.size(), mod, mode);
+    SoftwareBlend::span_scalar(scalar.data(), src.data(), src.size(), 1, mod,
+                               mode);
+    EXPECT_EQ(simd, scalar);
+  }
+}
+
+TEST(Video_Software_SoftwareRenderer, draw_texture)
+{
+  SoftwareWindow w(Size(8, 8));
+  auto& r = w.get_renderer();
+  auto canvas = w.create_texture(Size(2, 2));
+
+  r.start_draw(canvas.get());
+  r.draw_filled_rect(Rect(0, 0, 1, 2), Color(0, 1, 0), Renderer::Blend::NONE);
+  r.end_draw();
+
+  r.start_draw();
+  // Scaled up 2x, then at 1x with the color and alpha modulated
+  r.draw_texture(*canvas, Rect(0, 0, 2, 2), Rect(0, 0, 4, 4), 0.f,
+                 Color(1, 1, 1), Renderer::Blend::BLEND);
+  r.draw_texture(*canvas, Rect(0, 0, 2, 2), Rect(4, 4, 6, 6), 0.f,
+                 Color(1, .5f, 1, 1), Renderer::Blend::NONE);
+  // A half turn swaps the columns
+  r.draw_texture(*canvas, Rect(0, 0, 2, 2), Rect(6, 0, 8, 2), 180.f,
+                 Color(1, 1, 1), Renderer::Blend::NONE);
+  r.end_draw();
+
+  const auto& frame = w.get_frame();
+  expect_pixel(frame, 0, 0, 0, 255, 0, 255);
+  expect_pixel(frame, 1, 3, 0, 255, 0, 255);
+  expect_pixel(frame, 2, 0, 0, 0, 0, 0);
+  expect_pixel(frame, 4, 4, 0, 127, 0, 255);
+  expect_pixel(frame, 5, 5, 0, 0, 0, 0);
+  expect_pixel(frame, 6, 0, 0, 0, 0, 0);
+  expect_pixel(frame, 7, 1, 0, 255, 0, 255);
+}
+
+TEST(Video_Software_SoftwareRenderer, draw_lines)
+{
+  SoftwareWindow w(Size(8, 8));
+  auto& r = w.get_renderer();
+
+  r.start_draw();
+  r.draw_line(Vector(0, 0), Vector(7, 7), Color(1, 1, 1),
+              Renderer::Blend::NONE);
+  r.draw_lines({ Vector(0, 7), Vector(3, 7), Vector(-100, 5), Vector(100, 5) },
+               Color(1, 0, 0), Renderer::Blend::NONE);
+  // Entirely off-screen
+  r.draw_line(Vector(20, 20), Vector(30, 40), Color(0, 0, 1),
+              Renderer::Blend::NONE);
+  r.end_draw();
+
+  const auto& frame = w.get_frame();
+  for (int i = 0; i < 8; i++)
+  {
+    if (i != 5)
+      expect_pixel(frame, i, i, 255, 255, 255, 255);
+    expect_pixel(frame, i, 5, 255, 0, 0, 255);
+  }
+  expect_pixel(frame, 3, 7, 255, 0, 0, 255);
+  expect_pixel(frame, 4, 7, 0, 0, 0, 0);
+}
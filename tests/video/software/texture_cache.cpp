@@ -0,0 +1,142 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <string>
+
+#include "SDL.h"
+
+#include "util/thread_pool.hpp"
+#include "video/software/software_window.hpp"
+
+namespace {
+
+/** Writes a blank image of the given size, removed when going out of scope. */
+class TempImage final
+{
+public:
+  TempImage(const std::string& file, int w, int h) :
+    m_file(file)
+  {
+    SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32,
+                                                    SDL_PIXELFORMAT_RGBA32);
+    SDL_SaveBMP(s, m_file.c_str());
+    SDL_FreeSurface(s);
+  }
+
+  ~TempImage()
+  {
+    std::remove(m_file.c_str());
+  }
+
+  const std::string&
+  get_file() const
+  {
+    return m_file;
+  }
+
+private:
+  std::string m_file;
+
+private:
+  TempImage(const TempImage&) = delete;
+  TempImage& operator=(const TempImage&) = delete;
+};
+
+} // namespace
+
+TEST(Video_TextureCache, shared)
+{
+  TempImage image("texture_cache_a.bmp", 4, 2);
+  SoftwareWindow w(Size(8, 8));
+
+  auto a = w.load_texture(image.get_file());
+  auto b = w.load_texture(image.get_file());
+
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(a->get_memory_size(), 4u * 2u * 4u);
+  ASSERT_EQ(w.get_texture_memory(), a->get_memory_size());
+  ASSERT_EQ(w.get_cached_texture_count(), 1u);
+
+  // Textures in use survive flushes, and are still shared afterwards
+  w.flush_texture_cache();
+  ASSERT_EQ(w.get_cached_texture_count(), 1u);
+  ASSERT_EQ(w.load_texture(image.get_file()), a);
+
+  a.reset();
+  b.reset();
+  w.flush_texture_cache();
+  ASSERT_EQ(w.get_cached_texture_count(), 0u);
+  ASSERT_EQ(w.get_texture_memory(), 0u);
+}
+
+TEST(Video_TextureCache, budget)
+{
+  TempImage image_a("texture_cache_a.bmp", 4, 4);
+  TempImage image_b("texture_cache_b.bmp", 4, 4);
+  TempImage image_c("texture_cache_c.bmp", 4, 4);
+  SoftwareWindow w(Size(8, 8));
+  w.set_texture_budget(2 * 4 * 4 * 4);
+
+  auto a = w.load_texture(image_a.get_file());
+  w.load_texture(image_b.get_file());
+  w.load_texture(image_c.get_file());
+
+  // b was the least recently used unreferenced texture; a is still in use
+  ASSERT_EQ(w.get_cached_texture_count(), 2u);
+  ASSERT_EQ(w.get_texture_memory(), 2u * 4u * 4u * 4u);
+  ASSERT_EQ(w.load_texture(image_a.get_file()), a);
+
+  // Over budget while in use, then evicted once released
+  auto b = w.load_texture(image_b.get_file());
+  auto c = w.load_texture(image_c.get_file());
+  w.set_texture_budget(0);
+  ASSERT_EQ(w.get_cached_texture_count(), 3u);
+
+  a.reset();
+  w.set_texture_budget(2 * 4 * 4 * 4);
+  ASSERT_EQ(w.get_cached_texture_count(), 2u);
+  w.set_texture_budget(0);
+  ASSERT_EQ(w.get_cached_texture_count(), 2u);
+  b.reset();
+  c.reset();
+  w.set_texture_budget(0);
+  ASSERT_EQ(w.get_cached_texture_count(), 0u);
+}
+
+TEST(Video_TextureCache, reload)
+{
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+
+  TempImage image("texture_cache_a.bmp", 4, 2);
+  auto texture = w.load_texture(image.get_file());
+  ASSERT_FALSE(w.reload_texture("texture_cache_b.bmp"));
+
+  TempImage changed("texture_cache_a.bmp", 8, 4);
+  ASSERT_TRUE(w.reload_texture(image.get_file()));
+  ASSERT_EQ(w.get_loading_count(), 1u);
+  ASSERT_EQ(texture->get_size(), Size(4, 2));
+
+  // Swapped in place: the handle given out earlier sees the new version
+  w.upload_textures();
+  ASSERT_EQ(w.get_loading_count(), 0u);
+  ASSERT_EQ(texture->get_size(), Size(8, 4));
+  ASSERT_EQ(w.load_texture(image.get_file()), texture);
+  ASSERT_EQ(w.get_texture_memory(), 8u * 4u * 4u);
+}
@@ -0,0 +1,136 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "util/thread_pool.hpp"
+#include "video/software/software_blend.hpp"
+#include "video/software/software_texture.hpp"
+#include "video/software/software_window.hpp"
+#include "video/texture_file.hpp"
+
+TEST(Video_TextureFile, is_texture_file)
+{
+  EXPECT_TRUE(TextureFile::is_texture_file("images/a.htex"));
+  EXPECT_FALSE(TextureFile::is_texture_file("images/a.png"));
+  EXPECT_FALSE(TextureFile::is_texture_file("images/a.htex.png"));
+  EXPECT_FALSE(TextureFile::is_texture_file(".htex"));
+}
+
+TEST(Video_TextureFile, save_and_load)
+{
+  // 3x2, with a padded pitch, then 1x1
+  std::vector<uint8_t> full = {
+     1,  2,  3,  4,    5,  6,  7,  8,    9, 10, 11, 12,  0, 0, 0, 0,
+    13, 14, 15, 16,   17, 18, 19, 20,   21, 22, 23, 24,  0, 0, 0, 0
+  };
+  std::vector<uint8_t> mip = { 25, 26, 27, 28 };
+
+  std::vector<TextureFile::Level> levels = {
+    { 3, 2, 16, full.data() },
+    { 1, 1, 4, mip.data() }
+  };
+  TextureFile::save("texture_file_test.htex", TextureFile::Format::RGBA32,
+                    levels);
+
+  {
+    TextureFile image("texture_file_test.htex");
+    ASSERT_EQ(image.get_format(), TextureFile::Format::RGBA32);
+    ASSERT_EQ(image.get_levels().size(), 2u);
+
+    const auto& l0 = image.get_levels()[0];
+    ASSERT_EQ(l0.width, 3u);
+    ASSERT_EQ(l0.height, 2u);
+    ASSERT_EQ(l0.pitch % TextureFile::ROW_ALIGNMENT, 0u);
+    EXPECT_EQ(l0.pixels[0], 1);
+    EXPECT_EQ(l0.pixels[11], 12);
+    EXPECT_EQ(l0.pixels[l0.pitch], 13);
+    EXPECT_EQ(l0.pixels[l0.pitch + 11], 24);
+
+    const auto& l1 = image.get_levels()[1];
+    ASSERT_EQ(l1.width, 1u);
+    ASSERT_EQ(l1.height, 1u);
+    EXPECT_EQ(l1.pixels[3], 28);
+  }
+
+  {
+    SoftwareWindow w(Size(8, 8));
+    auto texture = w.load_texture("texture_file_test.htex");
+    ASSERT_EQ(texture->get_size(), Size(3, 2));
+
+    uint8_t r, g, b, a;
+    const auto& software = static_cast<const SoftwareTexture&>(*texture);
+    SoftwareBlend::unpack(software.get_pixel(2, 1), r, g, b, a);
+    EXPECT_EQ(r, 21);
+    EXPECT_EQ(a, 24);
+  }
+
+  std::remove("texture_file_test.htex");
+}
+
+TEST(Video_TextureFile, reload)
+{
+  std::vector<uint8_t> small(4, 1);
+  std::vector<uint8_t> large(2 * 2 * 4, 2);
+
+  TextureFile::save("texture_file_reload.htex", TextureFile::Format::RGBA32,
+                    { { 1, 1, 4, small.data() } });
+
+  ThreadPool pool(0);
+  SoftwareWindow w(Size(8, 8));
+  w.set_loader(pool);
+
+  auto texture = w.load_texture("texture_file_reload.htex");
+  ASSERT_EQ(texture->get_size(), Size(1, 1));
+
+  TextureFile::save("texture_file_reload.htex", TextureFile::Format::RGBA32,
+                    { { 2, 2, 8, large.data() } });
+
+  // Swapped in place by upload_textures(), without decoding
+  ASSERT_TRUE(w.reload_texture("texture_file_reload.htex"));
+  ASSERT_EQ(texture->get_size(), Size(1, 1));
+  w.upload_textures();
+  ASSERT_EQ(texture->get_size(), Size(2, 2));
+  ASSERT_EQ(w.get_texture_memory(), 2u * 2u * 4u);
+  ASSERT_EQ(w.get_loading_count(), 0u);
+
+  std::remove("texture_file_reload.htex");
+}
+
+TEST(Video_TextureFile, invalid)
+{
+  ASSERT_THROW(TextureFile("texture_file_missing.htex"), std::runtime_error);
+  ASSERT_THROW(TextureFile::save("texture_file_test.htex",
+                                 TextureFile::Format::RGBA32, {}),
+               std::runtime_error);
+
+  // A level pointing past the end of the file
+  std::vector<uint8_t> pixels(16 * 16 * 4, 0);
+  TextureFile::save("texture_file_test.htex", TextureFile::Format::RGBA32,
+                    { { 16, 16, 64, pixels.data() } });
+
+  std::FILE* f = std::fopen("texture_file_test.htex", "r+b");
+  std::fseek(f, 20, SEEK_SET);
+  uint32_t height = 17;
+  std::fwrite(&height, sizeof(height), 1, f);
+  std::fclose(f);
+
+  ASSERT_THROW(TextureFile("texture_file_test.htex"), std::runtime_error);
+  std::remove("texture_file_test.htex");
+}
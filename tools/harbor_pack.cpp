@@ -0,0 +1,96 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// Packs a directory into an asset archive (see Archive), which the engine
+// mounts in place of that directory.
+//
+// Usage: harbor_pack <directory> <archive file>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "util/archive.hpp"
+
+namespace {
+
+void
+list_files(const std::string& dir, const std::string& prefix,
+           std::map<std::string, std::string>& files)
+{
+  DIR* handle = opendir(dir.c_str());
+
+  if (!handle)
+    throw std::runtime_error("Could not open directory: " + dir);
+
+  while (struct dirent* entry = readdir(handle))
+  {
+    std::string name = entry->d_name;
+
+    if (name == "." || name == "..")
+      continue;
+
+    std::string path = dir + "/" + name;
+    struct stat info;
+
+    if (stat(path.c_str(), &info) != 0)
+      continue;
+
+    if (S_ISDIR(info.st_mode))
+      list_files(path, prefix + name + "/", files);
+    else if (S_ISREG(info.st_mode))
+      files[prefix + name] = path;
+  }
+
+  closedir(handle);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <directory> <archive file>"
+              << std::endl;
+    return 1;
+  }
+
+  std::string dir = argv[1];
+  while (dir.size() > 1 && dir.back() == '/')
+    dir.pop_back();
+
+  try
+  {
+    std::map<std::string, std::string> files;
+    list_files(dir, "", files);
+    Archive::create(argv[2], files);
+
+    std::cout << "Packed " << files.size() << " files into " << argv[2]
+              << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,207 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Plays a frame capture (see FrameCapture) back on a renderer, repeatedly, and
+// prints how long each frame took to draw.
+//
+// Usage: harbor_replay <capture file> [-r sdl|gl|software] [-n iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_ttf.h"
+
+#include "util/log.hpp"
+#include "video/font.hpp"
+#include "video/frame_capture.hpp"
+#include "video/window.hpp"
+
+namespace {
+
+void
+print_usage(const char* program)
+{
+  std::cerr << "Usage: " << program << " <capture file> [-r sdl|gl|software]"
+            << " [-n iterations]" << std::endl;
+}
+
+bool
+parse_video_system(const std::string& name, Window::VideoSystem& vs)
+{
+#if HARBOR_USE_VIDEO_SDL
+  if (name == "sdl")
+  {
+    vs = Window::VideoSystem::SDL;
+    return true;
+  }
+#endif
+#if HARBOR_USE_VIDEO_OPENGL
+  if (name == "gl")
+  {
+    vs = Window::VideoSystem::GL;
+    return true;
+  }
+#endif
+#if HARBOR_USE_VIDEO_SOFTWARE
+  if (name == "software")
+  {
+    vs = Window::VideoSystem::SOFTWARE;
+    return true;
+  }
+#endif
+  return false;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  std::string capture_file = argv[1];
+  std::string video_system = "sdl";
+  int iterations = 100;
+
+  for (int i = 2; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "-r") && i + 1 < argc)
+    {
+      video_system = argv[++i];
+    }
+    else if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+    {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    }
+    else
+    {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Window::VideoSystem vs;
+  if (!parse_video_system(video_system, vs))
+  {
+    std::cerr << "Unknown or disabled renderer: " << video_system << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    FrameCapture capture(capture_file);
+
+    SDL_Init(SDL_INIT_VIDEO);
+    IMG_Init(IMG_INIT_PNG);
+    TTF_Init();
+
+    auto window = Window::create_window(vs);
+    window->set_title("Replay: " + capture_file);
+
+    // Textures are resolved once, up front, so that loading them doesn't
+    // count towards the frame times.
+    std::vector<std::shared_ptr<Texture>> canvases;
+    std::vector<Texture*> textures;
+
+    for (const auto& info : capture.get_textures())
+    {
+      if (!info.file.empty())
+      {
+        try
+        {
+          canvases.push_back(window->load_texture(info.file));
+          textures.push_back(canvases.back().get());
+          continue;
+        }
+        catch (std::exception& e)
+        {
+          log_warn << "Replacing texture " << info.file << " with a blank one: "
+                   << e.what() << std::endl;
+        }
+      }
+
+      canvases.push_back(window->create_texture(info.size));
+      textures.push_back(canvases.back().get());
+    }
+
+    for (const auto& font : capture.get_fonts())
+      Font::get_font(Font::get_handle(font.file, font.size, font.sdf));
+
+    const size_t frames = capture.get_frame_count();
+    std::vector<double> min_ms(frames, HUGE_VAL), max_ms(frames, 0.),
+                        total_ms(frames, 0.);
+
+    // The first pass warms up the caches (text surfaces, GPU uploads...)
+    for (size_t f = 0; f < frames; f++)
+      capture.replay(f, window->get_renderer(), textures);
+
+    for (int i = 0; i < iterations; i++)
+    {
+      for (size_t f = 0; f < frames; f++)
+      {
+        auto start = std::chrono::steady_clock::now();
+        capture.replay(f, window->get_renderer(), textures);
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start)
+                                                                      .count();
+        min_ms[f] = std::min(min_ms[f], ms);
+        max_ms[f] = std::max(max_ms[f], ms);
+        total_ms[f] += ms;
+      }
+    }
+
+    double sum = 0.;
+    std::cout << std::fixed << std::setprecision(3)
+              << "frame\tmin ms\tavg ms\tmax ms" << std::endl;
+    for (size_t f = 0; f < frames; f++)
+    {
+      std::cout << f << '\t' << min_ms[f] << '\t' << total_ms[f] / iterations
+                << '\t' << max_ms[f] << std::endl;
+      sum += total_ms[f];
+    }
+    std::cout << "total\t\t" << sum / iterations << std::endl;
+
+    canvases.clear();
+    window.reset();
+    Font::flush_fonts();
+  }
+  catch (std::exception& e)
+  {
+    log_fatal << "Replay failed: " << e.what() << std::endl;
+    return 1;
+  }
+
+  TTF_Quit();
+  IMG_Quit();
+  SDL_Quit();
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+//  Harbor - A portable and highly customisable game engine
+//  Copyright (C) 2021 Semphris <semphris@protonmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// Converts an image to a pre-decoded texture file (see TextureFile), which the
+// engine uploads without decoding nor converting it.
+//
+// Usage: harbor_texconv <image> <texture file> [--mipmaps]
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_image.h"
+
+#include "video/texture_file.hpp"
+
+namespace {
+
+/** Halves @p src with a box filter; odd edges are clamped. */
+std::vector<uint8_t>
+downsample(const std::vector<uint8_t>& src, uint32_t w, uint32_t h,
+           uint32_t& out_w, uint32_t& out_h)
+{
+  out_w = std::max(1u, w / 2);
+  out_h = std::max(1u, h / 2);
+  std::vector<uint8_t> dst(static_cast<size_t>(out_w) * out_h * 4);
+
+  for (uint32_t y = 0; y < out_h; y++)
+  {
+    for (uint32_t x = 0; x < out_w; x++)
+    {
+      uint32_t x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+      uint32_t y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+
+      for (int c = 0; c < 4; c++)
+      {
+        unsigned sum = src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c]
+                     + src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+        dst[(y * out_w + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+      }
+    }
+  }
+
+  return dst;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 3 || argc > 4 || (argc == 4 && std::strcmp(argv[3], "--mipmaps")))
+  {
+    std::cerr << "Usage: " << argv[0] << " <image> <texture file> [--mipmaps]"
+              << std::endl;
+    return 1;
+  }
+
+  const bool mipmaps = argc == 4;
+
+  SDL_Surface* image = IMG_Load(argv[1]);
+  if (!image)
+  {
+    std::cerr << "Could not load " << argv[1] << ": " << IMG_GetError()
+              << std::endl;
+    return 1;
+  }
+
+  SDL_Surface* converted = SDL_ConvertSurfaceFormat(image,
+                                                    SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(image);
+
+  if (!converted)
+  {
+    std::cerr << "Could not convert " << argv[1] << ": " << SDL_GetError()
+              << std::endl;
+    return 1;
+  }
+
+  // Tightly packed copies of every level
+  std::vector<std::vector<uint8_t>> pixels(1);
+  std::vector<TextureFile::Level> levels(1);
+  levels[0].width = static_cast<uint32_t>(converted->w);
+  levels[0].height = static_cast<uint32_t>(converted->h);
+  levels[0].pitch = levels[0].width * 4;
+
+  SDL_LockSurface(converted);
+  pixels[0].resize(static_cast<size_t>(levels[0].pitch) * levels[0].height);
+  for (uint32_t y = 0; y < levels[0].height; y++)
+  {
+    std::memcpy(pixels[0].data() + y * levels[0].pitch,
+                static_cast<const uint8_t*>(converted->pixels)
+                  + y * converted->pitch, levels[0].pitch);
+  }
+  SDL_UnlockSurface(converted);
+  SDL_FreeSurface(converted);
+
+  while (mipmaps && (levels.back().width > 1 || levels.back().height > 1))
+  {
+    TextureFile::Level level;
+    pixels.push_back(downsample(pixels.back(), levels.back().width,
+                                levels.back().height, level.width,
+                                level.height));
+    level.pitch = level.width * 4;
+    levels.push_back(level);
+  }
+
+  for (size_t i = 0; i < levels.size(); i++)
+    levels[i].pixels = pixels[i].data();
+
+  try
+  {
+    TextureFile::save(argv[2], TextureFile::Format::RGBA32, levels);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "Wrote " << argv[2] << " (" << levels[0].width << "x"
+            << levels[0].height << ", " << levels.size() << " levels)"
+            << std::endl;
+  return 0;
+}